@@ -1,4 +1,5 @@
 #include "MFRC522.h"
+#include "piccpolicy.h"
 #include <wiringPi.h>
 #include <wiringPiSPI.h>
 #include <stdint.h>
@@ -14,7 +15,12 @@ using namespace std;
  * Constructor.
  * Initializes WiringPi and prepares the output pins.
  */
-MFRC522::MFRC522() {
+MFRC522::MFRC522()
+    : timerPrescaler(0)
+    , timerReload(0)
+    , hardwareCRC(false)
+    , bitRate(PICC_BITRATE_106)
+{
     if (wiringPiSetup() < 0) {
         fprintf(stderr, "WiringPi setup failed: %s\n", strerror(errno));
         exit(1);
@@ -44,12 +50,51 @@ void MFRC522::setSPIConfig() {
  */
 void MFRC522::PCD_WriteRegister(rfid_byte reg, rfid_byte value) {
     int spiChannel = 0;
-    rfid_byte data[2] = {reg & 0x7E, value};
+    rfid_byte data[2] = {static_cast<rfid_byte>((reg << 1) & 0x7E), value};
     wiringPiSPIDataRW(spiChannel, data, 2);
 }
 
 /**
  * Writes multiple bytes to the specified register in the MFRC522 chip.
+ * One SPI transfer: the address once, then every byte goes to the same register (the FIFO).
+ */
+void MFRC522::PCD_WriteRegister(rfid_byte reg, rfid_byte count, const rfid_byte *values) {
+    if (count == 0) {
+        return;
+    }
+
+    int spiChannel = 0;
+    rfid_byte buffer[256];
+    buffer[0] = (reg << 1) & 0x7E;
+    memcpy(buffer + 1, values, count);
+    wiringPiSPIDataRW(spiChannel, buffer, count + 1);
+}
+
+/**
+ * Sets the bits given in mask in register reg.
+ */
+void MFRC522::PCD_SetRegisterBitMask(rfid_byte reg, rfid_byte mask) {
+    rfid_byte value = PCD_ReadRegister(reg);
+    PCD_WriteRegister(reg, value | mask);
+}
+
+/**
+ * Clears the bits given in mask from register reg.
+ */
+void MFRC522::PCD_ClearRegisterBitMask(rfid_byte reg, rfid_byte mask) {
+    rfid_byte value = PCD_ReadRegister(reg);
+    PCD_WriteRegister(reg, value & ~mask);
+}
+
+/**
+ * Flushes the FIFO and clears its overflow flag.
+ */
+void MFRC522::PCD_ResetFIFO() {
+    PCD_WriteRegister(FIFOLevelReg, 0x80);
+}
+
+/**
+ * Instructs a PICC in state ACTIVE to go to state HALT.
  */
 rfid_byte MFRC522::PICC_HaltA() {
     rfid_byte result;
@@ -84,13 +129,16 @@ rfid_byte MFRC522::PICC_HaltA() {
  */
 rfid_byte MFRC522::PCD_ReadRegister(rfid_byte reg) {
     int spiChannel = 0;
-    rfid_byte data[2] = {static_cast<rfid_byte>(0x80 | (reg & 0x7E)), 0x00};
+    rfid_byte data[2] = {static_cast<rfid_byte>(0x80 | ((reg << 1) & 0x7E)), 0x00};
     wiringPiSPIDataRW(spiChannel, data, 2);
     return data[1];
 }
 
 /**
  * Reads multiple bytes from the specified register in the MFRC522 chip.
+ * One SPI transfer: the chip answers each address byte with the next value, so the address is
+ * repeated count times and a 0 ends the read. Only the bits from rxAlign upwards of values[0]
+ * are replaced, the rest belong to a previous partial byte.
  */
 void MFRC522::PCD_ReadRegister(rfid_byte reg, rfid_byte count, rfid_byte *values, rfid_byte rxAlign) {
     if (count == 0) {
@@ -98,14 +146,19 @@ void MFRC522::PCD_ReadRegister(rfid_byte reg, rfid_byte count, rfid_byte *values
     }
 
     int spiChannel = 0;
-    rfid_byte buffer[count + 1];
-    buffer[0] = 0x80 | (reg & 0x7E);
+    rfid_byte buffer[256];
+    memset(buffer, 0x80 | ((reg << 1) & 0x7E), count);
+    buffer[count] = 0;
 
     wiringPiSPIDataRW(spiChannel, buffer, count + 1);
 
-    for (int i = 0; i < count; i++) {
-        values[i] = buffer[i + 1];
+    int first = 0;
+    if (rxAlign) {
+        rfid_byte mask = (0xFF << rxAlign) & 0xFF;
+        values[0] = (values[0] & ~mask) | (buffer[1] & mask);
+        first = 1;
     }
+    memcpy(values + first, buffer + 1 + first, count - first);
 }
 
 /**
@@ -113,9 +166,18 @@ void MFRC522::PCD_ReadRegister(rfid_byte reg, rfid_byte count, rfid_byte *values
  */
 void MFRC522::PCD_Reset() {
     digitalWrite(RSTPIN, LOW);
-    delay(50); // Wait 50ms
+    delayMicroseconds(10); // Datasheet asks for 100 ns; a fixed 50 ms was pure startup latency
     digitalWrite(RSTPIN, HIGH);
-    delay(50); // Wait 50ms for the chip to stabilize
+
+    delayMicroseconds(PCD_OSC_STARTUP_US);
+    // Then PowerDown clears; 0x00 or 0xFF is a bus that is not answering yet, not a ready chip
+    for (int waited = 0; waited < 50; ++waited) {
+        rfid_byte value = PCD_ReadRegister(CommandReg);
+        if (value != 0x00 && value != 0xFF && !(value & (1 << 4))) {
+            break;
+        }
+        delay(1);
+    }
 }
 
 /**
@@ -142,17 +204,162 @@ void MFRC522::PCD_AntennaOff() {
 void MFRC522::PCD_Init() {
     PCD_Reset();
 
-    // Set timer for communication timeout
-    PCD_WriteRegister(TModeReg, 0x80); // TAuto=1
-    PCD_WriteRegister(TPrescalerReg, 0xA9); // TPreScaler = 169
-    PCD_WriteRegister(TReloadRegH, 0x03);
-    PCD_WriteRegister(TReloadRegL, 0xE8);
+    // Set timer for communication timeout; the reload is programmed per command
+    timerPrescaler = 0xFFFF; // The reset cleared the registers, force them to be written
+    timerReload = 0;
+    hardwareCRC = false;
+    bitRate = PICC_BITRATE_106;
+    PCD_SetTimeoutUs(25000);
 
     PCD_WriteRegister(TxASKReg, 0x40); // 100% ASK modulation
     PCD_WriteRegister(ModeReg, 0x3D); // CRC preset
     PCD_AntennaOn(); // Turn the antenna on
 }
 
+/**
+ * Programs the timer to fire timeoutUs after the end of transmission. Timeouts up to ~650 ms
+ * use ~10 us ticks; longer ones (ISO-DEP frame wait times reach 4.9 s) a coarser prescaler.
+ * Registers are only written when they change.
+ */
+void MFRC522::PCD_SetTimeoutUs(uint32_t timeoutUs) {
+    uint16_t prescaler = PICC_TIMER_PRESCALER;
+    uint16_t reload = piccTimerReload(timeoutUs);
+    uint64_t cycles = uint64_t(timeoutUs) * 13560 / 1000; // 13.56 MHz
+    if (cycles / (2 * PICC_TIMER_PRESCALER + 1) > 0xFFFF) {
+        uint64_t needed = (cycles / 0xFFFF + 1) / 2 + 1;
+        prescaler = needed > 0xFFF ? 0xFFF : uint16_t(needed);
+        uint64_t ticks = cycles / (2 * prescaler + 1) + 1;
+        reload = ticks > 0xFFFF ? 0xFFFF : uint16_t(ticks);
+    }
+    if (prescaler != timerPrescaler) {
+        PCD_WriteRegister(TModeReg, PICC_TIMER_MODE | (prescaler >> 8)); // TAuto=1
+        PCD_WriteRegister(TPrescalerReg, prescaler & 0xFF);
+        timerPrescaler = prescaler;
+    }
+    if (reload != timerReload) {
+        PCD_WriteRegister(TReloadRegH, reload >> 8);
+        PCD_WriteRegister(TReloadRegL, reload & 0xFF);
+        timerReload = reload;
+    }
+}
+
+/**
+ * Lets the chip append CRC_A to transmitted frames and check it on received ones.
+ */
+void MFRC522::PCD_SetHardwareCRC(bool enabled) {
+    if (enabled == hardwareCRC) {
+        return;
+    }
+    rfid_byte speed = bitRate << 4;
+    PCD_WriteRegister(TxModeReg, (enabled ? 0x80 : 0x00) | speed);
+    PCD_WriteRegister(RxModeReg, (enabled ? 0x80 : 0x00) | speed);
+    hardwareCRC = enabled;
+}
+
+/**
+ * Switches transmit and receive to 106, 212, 424 or 848 kbit/s, after a PPS agreed on it.
+ * The modulation pulse is narrower at higher rates (ModWidthReg, datasheet table 9.3.3.4).
+ */
+void MFRC522::PCD_SetBitRate(rfid_byte rate) {
+    static const rfid_byte modWidth[4] = {0x26, 0x15, 0x0A, 0x05};
+    rate &= 0x03;
+    rfid_byte crc = hardwareCRC ? 0x80 : 0x00;
+    PCD_WriteRegister(TxModeReg, crc | (rate << 4));
+    PCD_WriteRegister(RxModeReg, crc | (rate << 4));
+    PCD_WriteRegister(ModWidthReg, modWidth[rate]);
+    bitRate = rate;
+}
+
+/**
+ * Transceives one frame of any length with the CRC handled by the chip. The first 64 bytes
+ * go out as one burst; the rest is written whenever the FIFO has drained, while the RF side
+ * keeps sending. The reply is drained the same way as it arrives, so frames of up to 256 bytes
+ * (ISO-DEP FSD) need no more SPI transfers than their bytes divided by the FIFO size.
+ */
+rfid_byte MFRC522::PCD_TransceiveFrame(const rfid_byte *sendData, int sendLen, rfid_byte *backData, int *backLen,
+                                       uint32_t timeoutUs) {
+    const int fifoSize = 64;
+    PCD_SetHardwareCRC(true);
+    PCD_SetTimeoutUs(timeoutUs);
+
+    PCD_WriteRegister(CommandReg, PCD_Idle);
+    PCD_WriteRegister(ComIrqReg, 0x7F);
+    PCD_ResetFIFO();
+    int written = sendLen < fifoSize ? sendLen : fifoSize;
+    PCD_WriteRegister(FIFODataReg, written, sendData);
+    PCD_WriteRegister(BitFramingReg, 0x00);
+    PCD_WriteRegister(CommandReg, PCD_Transceive);
+    PCD_WriteRegister(BitFramingReg, 0x80); // StartSend
+
+    // Keep the FIFO from running dry: an empty FIFO ends the transmitted frame. A 64 byte FIFO
+    // lasts ~5 ms at 106 kbit/s, so the budget only runs out on a chip that stopped sending.
+    unsigned int polls = 100000;
+    while (written < sendLen) {
+        rfid_byte irq = PCD_ReadRegister(ComIrqReg);
+        if (irq & 0x40) { // TxIRq before the last byte: the FIFO ran dry and the frame went out short
+            return STATUS_ERROR;
+        }
+        if (irq & 0x02) { // ErrIRq
+            return STATUS_ERROR;
+        }
+        if ((irq & 0x01) || --polls == 0) {
+            return STATUS_TIMEOUT;
+        }
+        int space = fifoSize - (PCD_ReadRegister(FIFOLevelReg) & 0x7F);
+        if (space >= 16 || space >= sendLen - written) {
+            int chunk = sendLen - written < space ? sendLen - written : space;
+            PCD_WriteRegister(FIFODataReg, chunk, sendData + written);
+            written += chunk;
+        }
+    }
+
+    // Until TxIRq the FIFO still holds bytes being sent; draining earlier would read them back
+    // as the answer
+    polls = 100000;
+    while (true) {
+        rfid_byte irq = PCD_ReadRegister(ComIrqReg);
+        if (irq & 0x40) {
+            break;
+        }
+        if (irq & 0x02) {
+            return STATUS_ERROR;
+        }
+        if ((irq & 0x01) || --polls == 0) {
+            return STATUS_TIMEOUT;
+        }
+    }
+
+    int received = 0;
+    polls = 100000; // The timer ends a silent exchange; this only guards a dead chip
+    while (true) {
+        rfid_byte irq = PCD_ReadRegister(ComIrqReg);
+        int level = PCD_ReadRegister(FIFOLevelReg) & 0x7F;
+        if (level > 0) {
+            if (received + level > *backLen) {
+                return STATUS_NO_ROOM;
+            }
+            PCD_ReadRegister(FIFODataReg, level, backData + received);
+            received += level;
+        }
+        if (irq & 0x20) { // RxIRq: the frame is complete and was drained above
+            break;
+        }
+        if (irq & 0x01) {
+            return STATUS_TIMEOUT;
+        }
+        if (--polls == 0) {
+            return STATUS_TIMEOUT;
+        }
+    }
+    *backLen = received;
+
+    rfid_byte errorReg = PCD_ReadRegister(ErrorReg);
+    if (errorReg & 0x13) return STATUS_ERROR;
+    if (errorReg & 0x08) return STATUS_COLLISION;
+    if (errorReg & 0x04) return STATUS_CRC_WRONG;
+    return STATUS_OK;
+}
+
 /**
  * Calculates a CRC_A.
  */
@@ -175,13 +382,448 @@ rfid_byte MFRC522::PCD_CalculateCRC(rfid_byte *data, rfid_byte length, rfid_byte
     return STATUS_TIMEOUT;
 }
 
+/**
+ * CRC_A (ISO/IEC 14443-3) in software. Cheaper than the coprocessor for received frames: those
+ * would have to go back through the FIFO, a dozen SPI transfers plus polling for a 60 byte read.
+ */
+void MFRC522::crcA(const rfid_byte *data, int length, rfid_byte *result) {
+    uint16_t crc = 0x6363;
+    for (int i = 0; i < length; i++) {
+        rfid_byte b = data[i] ^ (crc & 0xFF);
+        b ^= b << 4;
+        crc = (crc >> 8) ^ (uint16_t(b) << 8) ^ (uint16_t(b) << 3) ^ (b >> 4);
+    }
+    result[0] = crc & 0xFF;
+    result[1] = crc >> 8;
+}
+
+/**
+ * Sends REQA or WUPA (a 7-bit short frame) and reads the 2 byte ATQA.
+ */
+rfid_byte MFRC522::PICC_REQA_or_WUPA(rfid_byte command, rfid_byte *bufferATQA, rfid_byte *bufferSize) {
+    if (bufferATQA == NULL || *bufferSize < 2) {
+        return STATUS_NO_ROOM;
+    }
+    PCD_ClearRegisterBitMask(CollReg, 0x80); // ValuesAfterColl: bits received after a collision are cleared
+    rfid_byte validBits = 7;
+    rfid_byte status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, &command, 1, bufferATQA, bufferSize, &validBits, 0, false);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (*bufferSize != 2 || validBits != 0) {
+        return STATUS_ERROR;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * Transmits REQA: PICCs in state IDLE go to READY.
+ */
+rfid_byte MFRC522::PICC_RequestA(rfid_byte *bufferATQA, rfid_byte *bufferSize) {
+    return PICC_REQA_or_WUPA(PICC_CMD_REQA, bufferATQA, bufferSize);
+}
+
+/**
+ * Selects the single PICC in the field and reads its UID, one cascade level at a time.
+ * Bit-level anticollision is not done: with two tags in the field this returns STATUS_COLLISION
+ * and the caller polls again. validBits must be 0 (no known UID prefix).
+ */
+rfid_byte MFRC522::PICC_Select(Uid *uid, rfid_byte validBits) {
+    if (validBits != 0) {
+        return STATUS_INVALID;
+    }
+    static const rfid_byte selectCommands[3] = {PICC_CMD_SEL_CL1, PICC_CMD_SEL_CL2, PICC_CMD_SEL_CL3};
+    PCD_ClearRegisterBitMask(CollReg, 0x80);
+
+    rfid_byte uidSize = 0;
+    for (int level = 0; level < 3; level++) {
+        // Anticollision: NVB 0x20 asks for the 4 UID bytes (or CT + 3) and the BCC
+        rfid_byte buffer[9] = {selectCommands[level], 0x20};
+        rfid_byte received[5];
+        rfid_byte receivedSize = sizeof(received);
+        rfid_byte txBits = 0;
+        rfid_byte status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, buffer, 2, received, &receivedSize, &txBits, 0, false);
+        if (status != STATUS_OK) {
+            return status;
+        }
+        if (receivedSize != 5 || (received[0] ^ received[1] ^ received[2] ^ received[3]) != received[4]) {
+            return STATUS_ERROR; // BCC mismatch
+        }
+
+        // Select: NVB 0x70, all 40 bits, with CRC; the answer is the SAK
+        buffer[1] = 0x70;
+        memcpy(buffer + 2, received, 5);
+        crcA(buffer, 7, buffer + 7);
+        rfid_byte sak[3];
+        rfid_byte sakSize = sizeof(sak);
+        status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, buffer, 9, sak, &sakSize, NULL, 0, true);
+        if (status != STATUS_OK) {
+            return status;
+        }
+        if (sakSize != 3) {
+            return STATUS_ERROR;
+        }
+
+        bool cascade = sak[0] & 0x04; // UID not complete
+        if (received[0] == PICC_CMD_CT) {
+            memcpy(uid->uidbyte + uidSize, received + 1, 3);
+            uidSize += 3;
+        } else {
+            memcpy(uid->uidbyte + uidSize, received, 4);
+            uidSize += 4;
+        }
+        if (!cascade) {
+            uid->size = uidSize;
+            uid->sak = sak[0];
+            return STATUS_OK;
+        }
+    }
+    return STATUS_INTERNAL_ERROR;
+}
+
+/**
+ * Sends a command with CRC_A and expects the 4-bit ACK (MIFARE write phases, Ultralight write).
+ * With acceptTimeout silence is success: the second phase of a value operation only answers
+ * with a NAK.
+ */
+rfid_byte MFRC522::PCD_MIFARE_Transceive(rfid_byte *sendData, rfid_byte sendLen, bool acceptTimeout) {
+    if (sendLen > 16) {
+        return STATUS_INVALID;
+    }
+    rfid_byte buffer[18];
+    memcpy(buffer, sendData, sendLen);
+    crcA(buffer, sendLen, buffer + sendLen);
+    // Data phases carry no command byte to pick the timeout from; they are EEPROM writes
+    uint32_t timeoutUs = acceptTimeout ? 1000 : piccTimeoutUs(PICC_CMD_MF_WRITE);
+    return PCD_SendFrame(buffer, sendLen + 2, acceptTimeout, timeoutUs);
+}
+
+/**
+ * Sends a frame that already ends in its CRC_A and checks the 4-bit ACK.
+ */
+rfid_byte MFRC522::PCD_SendFrame(const rfid_byte *frame, rfid_byte frameLen, bool acceptTimeout, uint32_t timeoutUs) {
+    rfid_byte ack[1];
+    rfid_byte ackSize = sizeof(ack);
+    rfid_byte validBits = 0;
+    rfid_byte status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, const_cast<rfid_byte *>(frame), frameLen, ack,
+                                               &ackSize, &validBits, 0, false, timeoutUs);
+    if (status == STATUS_TIMEOUT && acceptTimeout) {
+        return STATUS_OK;
+    }
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (ackSize != 1 || validBits != 4) {
+        return STATUS_ERROR;
+    }
+    if ((ack[0] & 0x0F) != 0x0A) {
+        return STATUS_MIFARE_NACK;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * Reads 16 bytes from a MIFARE Classic block (after authentication) or four Ultralight/NTAG
+ * pages starting at blockAddr. buffer must hold 18 bytes: the data and its CRC_A.
+ */
+rfid_byte MFRC522::MIFARE_Read(rfid_byte blockAddr, rfid_byte *buffer, rfid_byte *bufferSize) {
+    if (buffer == NULL || *bufferSize < 18) {
+        return STATUS_NO_ROOM;
+    }
+    rfid_byte command[4] = {PICC_CMD_MF_READ, blockAddr};
+    crcA(command, 2, command + 2);
+    return PCD_CommunicateWithPICC(PCD_Transceive, 0x30, command, 4, buffer, bufferSize, NULL, 0, true);
+}
+
+/**
+ * Writes 16 bytes to a MIFARE Classic block (after authentication): two phases, each acknowledged.
+ */
+rfid_byte MFRC522::MIFARE_Write(rfid_byte blockAddr, rfid_byte *buffer, rfid_byte bufferSize) {
+    if (buffer == NULL || bufferSize < 16) {
+        return STATUS_INVALID;
+    }
+    rfid_byte command[2] = {PICC_CMD_MF_WRITE, blockAddr};
+    rfid_byte status = PCD_MIFARE_Transceive(command, 2);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    return PCD_MIFARE_Transceive(buffer, 16);
+}
+
+/**
+ * Three-pass MIFARE Classic authentication of the sector holding blockAddr with key A
+ * (PICC_CMD_MF_AUTH_KEY_A) or B. On success the chip encrypts everything until PCD_StopCrypto1.
+ */
+rfid_byte MFRC522::PCD_Authenticate(rfid_byte command, rfid_byte blockAddr, const MIFARE_Key *key, const Uid *uid) {
+    if (uid->size < 4) {
+        return STATUS_INVALID;
+    }
+    rfid_byte data[12];
+    data[0] = command;
+    data[1] = blockAddr;
+    memcpy(data + 2, key->keybyte, MF_KEY_SIZE);
+    memcpy(data + 8, uid->uidbyte + uid->size - 4, 4); // The last four UID bytes
+    rfid_byte status = PCD_CommunicateWithPICC(PCD_MFAuthent, 0x10, data, sizeof(data), NULL, NULL, NULL, 0, false);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    return (PCD_ReadRegister(Status2Reg) & 0x08) ? STATUS_OK : STATUS_ERROR; // MFCrypto1On
+}
+
+/**
+ * Leaves the authenticated state; needed before talking to another PICC.
+ */
+void MFRC522::PCD_StopCrypto1() {
+    PCD_ClearRegisterBitMask(Status2Reg, 0x08);
+}
+
+/**
+ * Checks the redundant value block layout and extracts value and address byte.
+ */
+bool MFRC522::MIFARE_ParseValueBlock(const rfid_byte *block, int32_t *value, rfid_byte *address) {
+    for (int i = 0; i < 4; i++) {
+        if (block[i] != block[i + 8] || rfid_byte(~block[i]) != block[i + 4]) {
+            return false;
+        }
+    }
+    if (block[12] != block[14] || block[13] != block[15] || rfid_byte(~block[12]) != block[13]) {
+        return false;
+    }
+    uint32_t raw = uint32_t(block[0]) | (uint32_t(block[1]) << 8) | (uint32_t(block[2]) << 16) | (uint32_t(block[3]) << 24);
+    *value = int32_t(raw);
+    if (address) {
+        *address = block[12];
+    }
+    return true;
+}
+
+void MFRC522::MIFARE_FormatValueBlock(int32_t value, rfid_byte address, rfid_byte *block) {
+    uint32_t raw = uint32_t(value);
+    for (int i = 0; i < 4; i++) {
+        rfid_byte b = (raw >> (8 * i)) & 0xFF;
+        block[i] = b;
+        block[i + 4] = ~b;
+        block[i + 8] = b;
+    }
+    block[12] = address;
+    block[13] = ~address;
+    block[14] = address;
+    block[15] = ~address;
+}
+
+rfid_byte MFRC522::MIFARE_GetValue(rfid_byte blockAddr, int32_t *value, rfid_byte *address) {
+    rfid_byte buffer[18];
+    rfid_byte size = sizeof(buffer);
+    rfid_byte status = MIFARE_Read(blockAddr, buffer, &size);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    return MIFARE_ParseValueBlock(buffer, value, address) ? STATUS_OK : STATUS_VALUE_FORMAT;
+}
+
+rfid_byte MFRC522::MIFARE_SetValue(rfid_byte blockAddr, int32_t value, rfid_byte address) {
+    rfid_byte block[16];
+    MIFARE_FormatValueBlock(value, address, block);
+    return MIFARE_Write(blockAddr, block, sizeof(block));
+}
+
+/**
+ * Increment, decrement or restore into the card's internal transfer buffer. Phase one is
+ * acknowledged; phase two (the operand) is only answered when it fails.
+ */
+rfid_byte MFRC522::MIFARE_ValueOperation(rfid_byte command, rfid_byte blockAddr, int32_t delta) {
+    rfid_byte request[2] = {command, blockAddr};
+    rfid_byte status = PCD_MIFARE_Transceive(request, 2);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    uint32_t raw = uint32_t(delta);
+    rfid_byte operand[4] = {rfid_byte(raw), rfid_byte(raw >> 8), rfid_byte(raw >> 16), rfid_byte(raw >> 24)};
+    return PCD_MIFARE_Transceive(operand, 4, true);
+}
+
+rfid_byte MFRC522::MIFARE_Increment(rfid_byte blockAddr, int32_t delta) {
+    return MIFARE_ValueOperation(PICC_CMD_MF_INCREMENT, blockAddr, delta);
+}
+
+rfid_byte MFRC522::MIFARE_Decrement(rfid_byte blockAddr, int32_t delta) {
+    return MIFARE_ValueOperation(PICC_CMD_MF_DECREMENT, blockAddr, delta);
+}
+
+rfid_byte MFRC522::MIFARE_Restore(rfid_byte blockAddr) {
+    return MIFARE_ValueOperation(PICC_CMD_MF_RESTORE, blockAddr, 0);
+}
+
+/**
+ * Writes the transfer buffer (result of the last value operation) to blockAddr.
+ */
+rfid_byte MFRC522::MIFARE_Transfer(rfid_byte blockAddr) {
+    rfid_byte request[2] = {PICC_CMD_MF_TRANSFER, blockAddr};
+    return PCD_MIFARE_Transceive(request, 2);
+}
+
+/**
+ * One fare deduction inside an authenticated session. All frames and their CRCs are
+ * built before the first one is sent, so the exchanges follow each other with nothing but SPI
+ * traffic in between. The read-back proves the transfer reached the EEPROM; a card pulled
+ * away between transfer and read-back may have been charged although this reports an error.
+ */
+rfid_byte MFRC522::MIFARE_DecrementTransfer(rfid_byte blockAddr, int32_t delta, int32_t *newValue) {
+    rfid_byte read[4] = {PICC_CMD_MF_READ, blockAddr};
+    rfid_byte decrement[4] = {PICC_CMD_MF_DECREMENT, blockAddr};
+    rfid_byte operand[6];
+    rfid_byte transfer[4] = {PICC_CMD_MF_TRANSFER, blockAddr};
+    uint32_t raw = uint32_t(delta);
+    for (int i = 0; i < 4; i++) {
+        operand[i] = rfid_byte(raw >> (8 * i));
+    }
+    crcA(read, 2, read + 2);
+    crcA(decrement, 2, decrement + 2);
+    crcA(operand, 4, operand + 4);
+    crcA(transfer, 2, transfer + 2);
+
+    rfid_byte block[18];
+    rfid_byte size = sizeof(block);
+    int32_t before;
+    rfid_byte status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, read, 4, block, &size, NULL, 0, true);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (!MIFARE_ParseValueBlock(block, &before, NULL)) {
+        return STATUS_VALUE_FORMAT;
+    }
+    if (before < delta) {
+        *newValue = before;
+        return STATUS_INSUFFICIENT;
+    }
+
+    status = PCD_SendFrame(decrement, 4, false, piccTimeoutUs(PICC_CMD_MF_DECREMENT));
+    if (status == STATUS_OK) {
+        status = PCD_SendFrame(operand, 6, true, 1000);
+    }
+    if (status == STATUS_OK) {
+        status = PCD_SendFrame(transfer, 4, false, piccTimeoutUs(PICC_CMD_MF_TRANSFER));
+    }
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    size = sizeof(block);
+    status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, read, 4, block, &size, NULL, 0, true);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (!MIFARE_ParseValueBlock(block, newValue, NULL)) {
+        return STATUS_VALUE_FORMAT;
+    }
+    return *newValue == before - delta ? STATUS_OK : STATUS_ERROR;
+}
+
+/**
+ * Asks an NTAG21x / Ultralight EV1 for its product version and derives the memory layout.
+ * An original Ultralight does not know GET_VERSION and NAKs or stays silent; it is then back
+ * in IDLE and has to be woken (WUPA) and selected again before anything else is sent.
+ */
+rfid_byte MFRC522::PICC_GetVersion(NtagInfo *info) {
+    rfid_byte command[3] = {PICC_CMD_UL_GET_VERSION};
+    crcA(command, 1, command + 1);
+    rfid_byte buffer[10];
+    rfid_byte bufferSize = sizeof(buffer);
+    rfid_byte status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, command, 3, buffer, &bufferSize, NULL, 0, true);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (bufferSize != 10 || buffer[1] != 0x04) { // Vendor NXP
+        return STATUS_ERROR;
+    }
+    memcpy(info->version, buffer, 8);
+
+    // Storage size byte, then pages including configuration and the last user page
+    switch (buffer[6]) {
+    case 0x0B: info->type = NTAG_TYPE_UL_EV1_11; info->pages = 20; info->userPages = 12; break;
+    case 0x0E: info->type = NTAG_TYPE_UL_EV1_21; info->pages = 41; info->userPages = 32; break;
+    case 0x0F: info->type = NTAG_TYPE_NTAG213; info->pages = 45; info->userPages = 36; break;
+    case 0x11: info->type = NTAG_TYPE_NTAG215; info->pages = 135; info->userPages = 126; break;
+    case 0x13: info->type = NTAG_TYPE_NTAG216; info->pages = 231; info->userPages = 222; break;
+    default: return STATUS_ERROR;
+    }
+    return STATUS_OK;
+}
+
+/**
+ * FAST_READ of pages startPage..endPage (inclusive) in one frame. The reply and its CRC_A must
+ * fit the 64 byte FIFO, so at most NTAG_FAST_READ_PAGES pages; buffer needs 4 * pages + 2 bytes.
+ */
+rfid_byte MFRC522::NTAG_FastRead(rfid_byte startPage, rfid_byte endPage, rfid_byte *buffer, rfid_byte *bufferSize) {
+    if (endPage < startPage || endPage - startPage + 1 > NTAG_FAST_READ_PAGES) {
+        return STATUS_INVALID;
+    }
+    rfid_byte expected = 4 * (endPage - startPage + 1) + 2;
+    if (buffer == NULL || *bufferSize < expected) {
+        return STATUS_NO_ROOM;
+    }
+    rfid_byte command[5] = {PICC_CMD_UL_FAST_READ, startPage, endPage};
+    crcA(command, 3, command + 3);
+    rfid_byte status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, command, 5, buffer, bufferSize, NULL, 0, true);
+    if (status == STATUS_OK && *bufferSize != expected) {
+        return STATUS_ERROR;
+    }
+    return status;
+}
+
+/**
+ * Reads pageCount pages from startPage into buffer (4 * pageCount bytes, no CRC), with FAST_READ
+ * in FIFO-sized chunks or, for comparison and for tags without FAST_READ, 4 pages per READ.
+ * The chunks land in place; only the 2 CRC bytes after each chunk are saved and restored.
+ */
+rfid_byte MFRC522::NTAG_ReadPages(rfid_byte startPage, int pageCount, rfid_byte *buffer, bool fast) {
+    int chunkPages = fast ? NTAG_FAST_READ_PAGES : 4;
+    int done = 0;
+    while (done < pageCount) {
+        int pages = pageCount - done < chunkPages ? pageCount - done : chunkPages;
+        rfid_byte *target = buffer + 4 * done;
+        rfid_byte scratch[4 * NTAG_FAST_READ_PAGES + 2];
+        rfid_byte status;
+        if (fast) {
+            // The reply is 4 * pages + 2 bytes; keep what the CRC overwrites past this chunk
+            rfid_byte *tail = target + 4 * pages;
+            rfid_byte saved[2];
+            bool last = done + pages == pageCount;
+            if (!last) {
+                memcpy(saved, tail, 2);
+            }
+            rfid_byte size = 4 * pages + 2;
+            status = NTAG_FastRead(startPage + done, startPage + done + pages - 1, last ? scratch : target, &size);
+            if (status == STATUS_OK) {
+                if (last) {
+                    memcpy(target, scratch, 4 * pages);
+                } else {
+                    memcpy(tail, saved, 2);
+                }
+            }
+        } else {
+            // READ always returns 4 pages (wrapping at the end of memory), use what was asked for
+            rfid_byte size = sizeof(scratch);
+            status = MIFARE_Read(startPage + done, scratch, &size);
+            if (status == STATUS_OK) {
+                memcpy(target, scratch, 4 * pages);
+            }
+        }
+        if (status != STATUS_OK) {
+            return status;
+        }
+        done += pages;
+    }
+    return STATUS_OK;
+}
+
 /**
  * Checks if a new card is present.
  */
 bool MFRC522::PICC_IsNewCardPresent() {
     rfid_byte bufferATQA[2];
     rfid_byte bufferSize = sizeof(bufferATQA);
-    rfid_byte result = PICC_REQA_or_WUPA(0x26, bufferATQA, &bufferSize); // REQA command
+    rfid_byte result = PICC_RequestA(bufferATQA, &bufferSize);
     return (result == STATUS_OK || result == STATUS_COLLISION);
 }
 
@@ -202,31 +844,63 @@ rfid_byte MFRC522::PCD_CommunicateWithPICC(
     rfid_byte* backLen,
     rfid_byte* validBits,
     rfid_byte rxAlign,
-    bool checkCRC
+    bool checkCRC,
+    uint32_t timeoutUs
     ) {
+    // Frame wait time for the PICC command being sent, instead of one timeout for everything
+    if (timeoutUs) {
+        PCD_SetTimeoutUs(timeoutUs);
+    } else if (sendData && sendLen > 0) {
+        PCD_SetTimeoutUs(piccTimeoutUs(sendData[0]));
+    }
+    PCD_SetHardwareCRC(false); // CRC_A is added and checked in software on this path
+
+    rfid_byte txLastBits = validBits ? *validBits : 0;
+
     // Ensure the FIFO buffer is reset before communication
-    PCD_ClearRegisterBitMask(FIFOLevelReg, 0x80);
+    PCD_WriteRegister(CommandReg, PCD_Idle);
+    PCD_WriteRegister(ComIrqReg, 0x7F); // Clear all interrupt request bits
+    PCD_ResetFIFO();
     PCD_WriteRegister(FIFODataReg, sendLen, sendData);
-    PCD_WriteRegister(BitFramingReg, (rxAlign << 4));
+    PCD_WriteRegister(BitFramingReg, (rxAlign << 4) | txLastBits);
     PCD_WriteRegister(CommandReg, command);
+    if (command == PCD_Transceive) {
+        PCD_SetRegisterBitMask(BitFramingReg, 0x80); // StartSend
+    }
 
-    // Wait for the command to complete
-    unsigned int i = 2000; // Timeout loop
-    while (i--) {
+    // Wait for the command to complete; the timer ends it, the loop only guards a dead chip
+    unsigned int i = 2000;
+    while (true) {
         rfid_byte n = PCD_ReadRegister(ComIrqReg);
         if (n & waitIRq) break;
         if (n & 0x01) return STATUS_TIMEOUT; // Timer expired
+        if (--i == 0) return STATUS_TIMEOUT;
     }
 
     // Handle errors and retrieve results
     rfid_byte errorReg = PCD_ReadRegister(ErrorReg);
     if (errorReg & 0x13) return STATUS_ERROR;
 
+    rfid_byte rxLastBits = 0;
     if (backData && backLen) {
         rfid_byte length = PCD_ReadRegister(FIFOLevelReg);
         if (length > *backLen) return STATUS_NO_ROOM;
         *backLen = length;
         PCD_ReadRegister(FIFODataReg, length, backData, rxAlign);
+        rxLastBits = PCD_ReadRegister(ControlReg) & 0x07;
+        if (validBits) {
+            *validBits = rxLastBits;
+        }
+    }
+
+    if (errorReg & 0x08) return STATUS_COLLISION;
+
+    if (backData && backLen && checkCRC) {
+        if (*backLen == 1 && rxLastBits == 4) return STATUS_MIFARE_NACK;
+        if (*backLen < 2 || rxLastBits != 0) return STATUS_CRC_WRONG;
+        rfid_byte crc[2];
+        crcA(backData, *backLen - 2, crc);
+        if (backData[*backLen - 2] != crc[0] || backData[*backLen - 1] != crc[1]) return STATUS_CRC_WRONG;
     }
 
     return STATUS_OK;
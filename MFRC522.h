@@ -1,7 +1,9 @@
 #ifndef MFRC522_H
 #define MFRC522_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include "rc522timing.h"
 
 #define MF_KEY_SIZE 6 // Key size for MIFARE cards
 
@@ -15,6 +17,9 @@
 #define STATUS_INVALID       6
 #define STATUS_CRC_WRONG     7
 #define STATUS_MIFARE_NACK   8
+#define STATUS_VALUE_FORMAT  9 // Block is not a valid value block
+#define STATUS_INSUFFICIENT  10 // Value below the requested decrement
+#define STATUS_LOG_FAILED    11 // Charged but the event log write failed; the ride is not granted
 
 // PICC Commands
 #define PICC_CMD_REQA        0x26
@@ -33,6 +38,26 @@
 #define PICC_CMD_MF_RESTORE  0xC2
 #define PICC_CMD_MF_TRANSFER 0xB0
 #define PICC_CMD_HLTA        0x50
+#define PICC_CMD_UL_GET_VERSION 0x60 // NTAG21x / Ultralight EV1, same code as MF_AUTH_KEY_A
+#define PICC_CMD_UL_FAST_READ 0x3A
+
+// FAST_READ reply (4 bytes per page + CRC_A) has to fit the 64 byte FIFO
+#define NTAG_FAST_READ_PAGES 15
+#define NTAG_PAGE_SIZE       4
+#define NTAG_USER_START_PAGE 4
+
+#define NTAG_TYPE_UNKNOWN    0
+#define NTAG_TYPE_UL_EV1_11  1
+#define NTAG_TYPE_UL_EV1_21  2
+#define NTAG_TYPE_NTAG213    3
+#define NTAG_TYPE_NTAG215    4
+#define NTAG_TYPE_NTAG216    5
+
+// Bit rates for PCD_SetBitRate, the DS/DR codes of ISO/IEC 14443-4 PPS
+#define PICC_BITRATE_106     0
+#define PICC_BITRATE_212     1
+#define PICC_BITRATE_424     2
+#define PICC_BITRATE_848     3
 
 // MFRC522 Registers
 #define CommandReg           0x01
@@ -46,9 +71,12 @@
 #define FIFODataReg          0x09
 #define FIFOLevelReg         0x0A
 #define ControlReg           0x0C
+#define WaterLevelReg        0x0B
 #define BitFramingReg        0x0D
 #define CollReg              0x0E
 #define ModeReg              0x11
+#define TxModeReg            0x12
+#define RxModeReg            0x13
 #define TxControlReg         0x14
 #define TxASKReg             0x15
 #define TModeReg             0x2A
@@ -57,6 +85,7 @@
 #define TReloadRegL          0x2D
 #define CRCResultRegH        0x21
 #define CRCResultRegL        0x22
+#define ModWidthReg          0x24
 #define AutoTestReg          0x36
 #define VersionReg           0x37
 
@@ -69,6 +98,14 @@ typedef struct {
     rfid_byte sak;                // The SAK byte (Select Acknowledge)
 } Uid;
 
+// NTAG21x / Ultralight EV1 product and memory layout from GET_VERSION
+typedef struct {
+    rfid_byte version[8];         // GET_VERSION reply without CRC
+    rfid_byte type;               // NTAG_TYPE_*
+    rfid_byte pages;              // Pages in memory, including UID, lock and configuration pages
+    rfid_byte userPages;          // User memory from NTAG_USER_START_PAGE
+} NtagInfo;
+
 // Key structure
 typedef struct {
     rfid_byte keybyte[MF_KEY_SIZE];
@@ -83,7 +120,7 @@ public:
     void PCD_Init(); // Initializes the MFRC522 chip
     void PCD_Reset(); // Resets the MFRC522 chip
     void PCD_WriteRegister(rfid_byte reg, rfid_byte value);
-    void PCD_WriteRegister(rfid_byte reg, rfid_byte count, rfid_byte *values);
+    void PCD_WriteRegister(rfid_byte reg, rfid_byte count, const rfid_byte *values);
     rfid_byte PCD_ReadRegister(rfid_byte reg);
     void PCD_ReadRegister(rfid_byte reg, rfid_byte count, rfid_byte *values, rfid_byte rxAlign = 0);
     void PCD_SetRegisterBitMask(rfid_byte reg, rfid_byte mask);
@@ -91,6 +128,9 @@ public:
     void PCD_AntennaOn();
     void PCD_AntennaOff();
     void setSPIConfig();
+    void PCD_SetTimeoutUs(uint32_t timeoutUs); // Timer prescaler and reload for one frame wait time
+    void PCD_SetHardwareCRC(bool enabled);     // CRC_A appended and checked by the chip (ISO-DEP)
+    void PCD_SetBitRate(rfid_byte rate);       // PICC_BITRATE_*, both directions
     rfid_byte PICC_Select(Uid *uid, rfid_byte validBits = 0);
 
     // Functions for communicating with PICCs
@@ -102,10 +142,33 @@ public:
     rfid_byte MIFARE_Read(rfid_byte blockAddr, rfid_byte *buffer, rfid_byte *bufferSize);
     rfid_byte MIFARE_Write(rfid_byte blockAddr, rfid_byte *buffer, rfid_byte bufferSize);
 
+    // MIFARE Classic authentication and value blocks (value, ~value, value, then address,
+    // ~address, address, ~address); blocks must be formatted with MIFARE_SetValue first
+    rfid_byte PCD_Authenticate(rfid_byte command, rfid_byte blockAddr, const MIFARE_Key *key, const Uid *uid);
+    void PCD_StopCrypto1();
+    rfid_byte MIFARE_GetValue(rfid_byte blockAddr, int32_t *value, rfid_byte *address = NULL);
+    rfid_byte MIFARE_SetValue(rfid_byte blockAddr, int32_t value, rfid_byte address);
+    rfid_byte MIFARE_Increment(rfid_byte blockAddr, int32_t delta);
+    rfid_byte MIFARE_Decrement(rfid_byte blockAddr, int32_t delta);
+    rfid_byte MIFARE_Restore(rfid_byte blockAddr);
+    rfid_byte MIFARE_Transfer(rfid_byte blockAddr);
+    // Read, refuse below delta, decrement, transfer and read back, all frames prepared up front
+    rfid_byte MIFARE_DecrementTransfer(rfid_byte blockAddr, int32_t delta, int32_t *newValue);
+    static bool MIFARE_ParseValueBlock(const rfid_byte *block, int32_t *value, rfid_byte *address);
+    static void MIFARE_FormatValueBlock(int32_t value, rfid_byte address, rfid_byte *block);
+
+    // Functions for NTAG21x / Ultralight PICCs
+    rfid_byte PICC_GetVersion(NtagInfo *info);
+    rfid_byte NTAG_FastRead(rfid_byte startPage, rfid_byte endPage, rfid_byte *buffer, rfid_byte *bufferSize);
+    rfid_byte NTAG_ReadPages(rfid_byte startPage, int pageCount, rfid_byte *buffer, bool fast = true);
+
     // Functions causing errors
     rfid_byte PICC_REQA_or_WUPA(rfid_byte command, rfid_byte *bufferATQA, rfid_byte *bufferSize);
     rfid_byte PICC_HaltA();
     rfid_byte PCD_CalculateCRC(rfid_byte *data, rfid_byte length, rfid_byte *result);
+    // One frame of any length with hardware CRC, streamed through the 64 byte FIFO both ways
+    rfid_byte PCD_TransceiveFrame(const rfid_byte *sendData, int sendLen, rfid_byte *backData, int *backLen,
+                                  uint32_t timeoutUs);
     rfid_byte PCD_CommunicateWithPICC(
         rfid_byte command,
         rfid_byte waitIRq,
@@ -115,7 +178,8 @@ public:
         rfid_byte* backLen,
         rfid_byte* validBits,
         rfid_byte rxAlign,
-        bool checkCRC
+        bool checkCRC,
+        uint32_t timeoutUs = 0 // 0: by the PICC command in sendData[0]
         );
 
 
@@ -137,6 +201,15 @@ public:
 
 private:
     void PCD_ResetFIFO(); // Helper to reset FIFO buffer
+    rfid_byte PCD_MIFARE_Transceive(rfid_byte *sendData, rfid_byte sendLen, bool acceptTimeout = false); // Adds CRC_A, expects ACK
+    rfid_byte PCD_SendFrame(const rfid_byte *frame, rfid_byte frameLen, bool acceptTimeout, uint32_t timeoutUs); // CRC included
+    rfid_byte MIFARE_ValueOperation(rfid_byte command, rfid_byte blockAddr, int32_t delta);
+    static void crcA(const rfid_byte *data, int length, rfid_byte *result);
+
+    uint16_t timerPrescaler; // Cached so per-command timeouts only rewrite the reload
+    uint16_t timerReload;
+    bool hardwareCRC;
+    rfid_byte bitRate;
     };
 
 #endif // MFRC522_H
@@ -1,12 +1,15 @@
 QT       += core gui
 QT       += sql #should add sql
 QT       += mqtt #should add mqtt
+QT       += network # metrics endpoint
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 LIBS += -lwiringPi
 LIBS += -lbcm2835
+LIBS += -lsqlite3 # online backup API, must match the SQLite the QSQLITE driver uses
+LIBS += -lrt # shm_open for the scan rings
 
 
 # You can make your code fail to compile if it uses deprecated APIs.
@@ -14,15 +17,61 @@ LIBS += -lbcm2835
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    accesscontrol.cpp \
+    appoptions.cpp \
+    credentialprovisioner.cpp \
+    databasebackup.cpp \
     databasedialog.cpp \
+    databasemanager.cpp \
+    doorcontroller.cpp \
+    latencyhistogram.cpp \
+    logger.cpp \
     main.cpp \
     mainwindow.cpp \
-    mqttmanager.cpp
+    metrics.cpp \
+    metricsserver.cpp \
+    mqttmanager.cpp \
+    payloadcodec.cpp \
+    readertrace.cpp \
+    scanaggregator.cpp \
+    scanfeedmodel.cpp \
+    scaningestwriter.cpp \
+    scanpublisher.cpp \
+    scanring.cpp \
+    scanringreceiver.cpp \
+    scantracer.cpp \
+    segmentlog.cpp \
+    startuporchestrator.cpp \
+    topicrouter.cpp \
+    uidfilter.cpp
 
 HEADERS += \
+    accesscontrol.h \
+    appoptions.h \
+    credentialprovisioner.h \
+    databasebackup.h \
     databasedialog.h \
+    databasemanager.h \
+    doorcontroller.h \
+    latencyhistogram.h \
+    logger.h \
     mainwindow.h \
-    mqttmanager.h
+    metrics.h \
+    metricsserver.h \
+    mqttmanager.h \
+    payloadcodec.h \
+    readertrace.h \
+    scanaggregator.h \
+    scanfeedmodel.h \
+    scaningestwriter.h \
+    scanpublisher.h \
+    scanring.h \
+    scanringreceiver.h \
+    scantracer.h \
+    segmentlog.h \
+    startuporchestrator.h \
+    topicrouter.h \
+    uidfilter.h
 
 FORMS += \
     databasedialog.ui \
@@ -35,4 +84,5 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 DISTFILES += \
     MFRC522.py \
-    RFIDScan.py
+    RFIDScan.py \
+    scanring.py
@@ -27,8 +27,10 @@
 #
 
 import MFRC522
+import scanring
 import signal
 import sys
+import time
 
 sys.stdout.reconfigure(line_buffering=True)
 continue_reading = True
@@ -50,15 +52,23 @@ signal.signal(signal.SIGTERM, end_read)
 
 # Create an object of the class MFRC522
 MIFAREReader = MFRC522.MFRC522()
+
+# Binary records over shared memory when the app provides a ring, text on stdout otherwise
+ring = scanring.attach_from_environment()
 #print("RFID Scanner Ready. Press Ctrl-C to stop.") #Removed as no need from
 
 # Main loop
 while continue_reading:
     status, TagType = MIFAREReader.MFRC522_Request(MIFAREReader.PICC_REQIDL)
     if status == MIFAREReader.MI_OK:
+        reqa = time.monotonic_ns()  # Same clock as CLOCK_MONOTONIC in the Qt app
         status, uid = MIFAREReader.MFRC522_SelectTagSN()
         if status == MIFAREReader.MI_OK:
-            print(f"Card detected with UID: {uidToString(uid)}")
+            selected = time.monotonic_ns()
+            if ring:
+                ring.push(uid, reqa, selected)
+            else:
+                print(f"Card detected with UID: {uidToString(uid)} reqa={reqa} select={selected}")
         else:
             print("Failed to read UID.")
 
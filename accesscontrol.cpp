@@ -0,0 +1,363 @@
+#include "accesscontrol.h"
+#include "uidfilter.h"
+#include <QSaveFile>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+// Header of the snapshot file, followed by `count` UidRecords in ascending key order
+struct SnapshotHeader {
+    char magic[4];       // "UIDS"
+    quint32 version;
+    quint32 stride;      // sizeof(UidRecord)
+    quint32 count;
+    qint64 generation;   // Export time in ms since epoch
+    quint64 reserved;
+};
+static_assert(sizeof(SnapshotHeader) == 32, "Snapshot header must keep records 16 byte aligned");
+
+static const quint32 SNAPSHOT_VERSION = 1;
+
+UidKey UidKey::fromBytes(const quint8 *bytes, int length) {
+    quint8 padded[10] = {0};
+    length = qBound(0, length, 10);
+    std::memcpy(padded, bytes, length);
+
+    UidKey key;
+    key.hi = static_cast<quint64>(length) << 56;
+    for (int i = 0; i < 7; ++i) {
+        key.hi |= static_cast<quint64>(padded[i]) << (48 - 8 * i);
+    }
+    key.lo = (static_cast<quint32>(padded[7]) << 16) | (static_cast<quint32>(padded[8]) << 8) | padded[9];
+    return key;
+}
+
+UidKey UidKey::fromBytes(const QByteArray &uid) {
+    return fromBytes(reinterpret_cast<const quint8 *>(uid.constData()), uid.size());
+}
+
+static inline bool keyLess(const UidRecord &record, const UidKey &key) {
+    // Bitwise operators on purpose: no short-circuit branch on the hot path
+    return (record.hi < key.hi) | ((record.hi == key.hi) & (record.lo < key.lo));
+}
+
+static inline bool recordLess(const UidRecord &a, const UidRecord &b) {
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+AccessSet::~AccessSet() = default;
+
+std::shared_ptr<const AccessSet> AccessSet::fromRecords(std::vector<UidRecord> records) {
+    std::sort(records.begin(), records.end(), recordLess);
+
+    std::shared_ptr<AccessSet> set(new AccessSet());
+    set->owned = std::move(records);
+    set->records = set->owned.data();
+    set->count = static_cast<quint32>(set->owned.size());
+    return set;
+}
+
+std::shared_ptr<const AccessSet> AccessSet::fromDatabase(QSqlDatabase db) {
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT uid, flags FROM credentials")) {
+        qDebug() << "Unable to load credentials:" << query.lastError().text();
+        return nullptr;
+    }
+
+    std::vector<UidRecord> records;
+    while (query.next()) {
+        UidKey key = UidKey::fromBytes(query.value(0).toByteArray());
+        records.push_back({key.hi, key.lo, query.value(1).toUInt()});
+    }
+    return fromRecords(std::move(records));
+}
+
+std::shared_ptr<const AccessSet> AccessSet::fromSnapshot(const QString &path) {
+    std::unique_ptr<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < static_cast<qint64>(sizeof(SnapshotHeader))) {
+        return nullptr;
+    }
+
+    uchar *data = file->map(0, file->size());
+    if (!data) {
+        qDebug() << "Unable to map access snapshot" << path << file->errorString();
+        return nullptr;
+    }
+
+    const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(data);
+    qint64 expectedSize = sizeof(SnapshotHeader) + static_cast<qint64>(header->count) * sizeof(UidRecord);
+    if (std::memcmp(header->magic, "UIDS", 4) != 0 || header->version != SNAPSHOT_VERSION
+        || header->stride != sizeof(UidRecord) || file->size() != expectedSize) {
+        qDebug() << "Ignoring invalid access snapshot" << path;
+        return nullptr;
+    }
+
+    std::shared_ptr<AccessSet> set(new AccessSet());
+    set->records = reinterpret_cast<const UidRecord *>(data + sizeof(SnapshotHeader));
+    set->count = header->count;
+    set->file = std::move(file);
+    return set;
+}
+
+bool AccessSet::lookup(const UidKey &key, quint32 *flags) const {
+    if (count == 0) {
+        return false;
+    }
+
+    // Branch-free lower bound: the loop trip count depends only on `count`, and the
+    // conditional advance compiles to a conditional move instead of a mispredicted jump
+    const UidRecord *base = records;
+    quint32 n = count;
+    while (n > 1) {
+        quint32 half = n / 2;
+        base = keyLess(base[half], key) ? base + half : base;
+        n -= half;
+    }
+    base += keyLess(*base, key);
+
+    if (base == end() || base->hi != key.hi || base->lo != key.lo) {
+        return false;
+    }
+    if (flags) {
+        *flags = base->flags;
+    }
+    return true;
+}
+
+bool AccessSet::sameContents(const AccessSet &other) const {
+    return count == other.count && std::memcmp(records, other.records, count * sizeof(UidRecord)) == 0;
+}
+
+bool AccessSet::writeSnapshot(const QString &path) const {
+    SnapshotHeader header;
+    std::memcpy(header.magic, "UIDS", 4);
+    header.version = SNAPSHOT_VERSION;
+    header.stride = sizeof(UidRecord);
+    header.count = count;
+    header.generation = QDateTime::currentMSecsSinceEpoch();
+    header.reserved = 0;
+
+    // QSaveFile writes to a temporary file and renames it, so a reader never maps a torn snapshot
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qDebug() << "Unable to write access snapshot" << path << out.errorString();
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records), static_cast<qint64>(count) * sizeof(UidRecord));
+    return out.commit();
+}
+
+AccessControl::AccessControl(const QString &path, QObject *parent)
+    : QObject(parent)
+    , snapshotPath(path)
+    , accessSet(AccessSet::fromRecords({}))
+    , setGeneration(0)
+    , filterRate(0.01)
+    , staleKeys(0)
+    , exportTimer(new QTimer(this))
+    , firstDecisionLogged(false)
+{
+    bootTimer.start();
+    connect(exportTimer, &QTimer::timeout, this, &AccessControl::rebuildFromDatabase);
+}
+
+std::shared_ptr<const AccessSet> AccessControl::currentSet() const {
+    return std::atomic_load(&accessSet);
+}
+
+quint64 FilterStats::savedNs() const {
+    if (rejected == 0 || timedLookups == 0 || timedFullLookups == 0) {
+        return 0;
+    }
+    quint64 perFullLookup = fullLookupNs / timedFullLookups;
+    quint64 perFilterCheck = filterNs / timedLookups;
+    return perFullLookup > perFilterCheck ? rejected * (perFullLookup - perFilterCheck) : 0;
+}
+
+void AccessControl::setFilterFalsePositiveRate(double rate) {
+    filterRate = UidFilter::clampRate(rate); // Else an out-of-range option rebuilds on every swap
+}
+
+void AccessControl::updateFilter(const AccessSet &previous, const AccessSet &next) {
+    // Walk both sorted sets once to find what was added and removed
+    std::vector<UidKey> added;
+    quint32 removed = 0;
+    const UidRecord *a = previous.begin();
+    const UidRecord *b = next.begin();
+    while (a != previous.end() || b != next.end()) {
+        if (b == next.end() || (a != previous.end() && recordLess(*a, *b))) {
+            ++removed;
+            ++a;
+        } else if (a == previous.end() || recordLess(*b, *a)) {
+            added.push_back({b->hi, b->lo});
+            ++b;
+        } else {
+            ++a;
+            ++b;
+        }
+    }
+
+    std::shared_ptr<const UidFilter> current = std::atomic_load(&filter);
+    bool full = !current
+                || current->insertedKeys() + added.size() > current->capacity()
+                || staleKeys + removed > current->capacity() / 4
+                || current->falsePositiveRate() != filterRate;
+
+    std::shared_ptr<UidFilter> updated;
+    if (full) {
+        // Size for growth so the next few changes stay incremental
+        updated = std::make_shared<UidFilter>(qMax<quint32>(next.size() + next.size() / 4, 1024), filterRate);
+        for (const UidRecord &record : next) {
+            updated->insert({record.hi, record.lo});
+        }
+        staleKeys = 0;
+    } else {
+        // Copy-on-write keeps concurrent readers on a consistent filter; removals just go stale
+        updated = std::make_shared<UidFilter>(*current);
+        for (const UidKey &key : added) {
+            updated->insert(key);
+        }
+        staleKeys += removed;
+    }
+    std::atomic_store(&filter, std::shared_ptr<const UidFilter>(std::move(updated)));
+}
+
+void AccessControl::swapSet(std::shared_ptr<const AccessSet> set) {
+    quint32 count = set->size();
+    // The filter must admit every new key before the set starts answering for it
+    updateFilter(*currentSet(), *set);
+    std::atomic_store(&accessSet, std::move(set));
+    ++setGeneration;
+    emit accessSetChanged(count);
+}
+
+bool AccessControl::loadSnapshot() {
+    QElapsedTimer timer;
+    timer.start();
+
+    std::shared_ptr<const AccessSet> set = AccessSet::fromSnapshot(snapshotPath);
+    if (!set) {
+        qDebug() << "No access snapshot at" << snapshotPath << "- decisions wait for the database.";
+        return false;
+    }
+
+    swapSet(set);
+    qDebug() << "Mapped access snapshot with" << set->size() << "UIDs in" << timer.nsecsElapsed() / 1000 << "us";
+    return true;
+}
+
+bool AccessControl::rebuildFromDatabase() {
+    QElapsedTimer timer;
+    timer.start();
+
+    std::shared_ptr<const AccessSet> set = AccessSet::fromDatabase(QSqlDatabase::database());
+    if (!set) {
+        return false;
+    }
+    qDebug() << "Loaded" << set->size() << "UIDs from the database in" << timer.nsecsElapsed() / 1000 << "us";
+
+    if (stats.lookups > 0) {
+        qDebug() << "UID filter rejected" << stats.rejected << "of" << stats.lookups << "lookups ("
+                 << qRound(stats.rejectionRate() * 100) << "%), saving about" << stats.savedNs() / 1000 << "us";
+    }
+
+    std::shared_ptr<const AccessSet> previous = currentSet();
+    if (previous->isMapped() || !previous->sameContents(*set)) {
+        // Export first: the mapped set may point into the file that is about to be replaced,
+        // but QSaveFile renames a new inode over it so the existing mapping stays valid
+        if (!previous->sameContents(*set)) {
+            set->writeSnapshot(snapshotPath);
+        }
+        swapSet(set);
+    }
+    return true;
+}
+
+void AccessControl::replaceSet(std::shared_ptr<const AccessSet> set) {
+    set->writeSnapshot(snapshotPath);
+    swapSet(std::move(set));
+}
+
+void AccessControl::startPeriodicExport(int intervalMs) {
+    exportTimer->start(intervalMs);
+}
+
+bool AccessControl::isAuthorized(const QByteArray &uid, quint32 *flags) {
+    UidKey key = UidKey::fromBytes(uid);
+    quint32 recordFlags = 0;
+    bool found = false;
+
+    // Unknown cards are the common case in public spaces: reject them before the real lookup.
+    // Only one lookup in TIMING_SAMPLE is timed; two clock reads would cost more than the filter.
+    bool timed = (stats.lookups % FilterStats::TIMING_SAMPLE) == 0;
+    QElapsedTimer timer;
+    if (timed) {
+        timer.start();
+    }
+    std::shared_ptr<const UidFilter> currentFilter = std::atomic_load(&filter);
+    bool candidate = !currentFilter || currentFilter->mayContain(key);
+    if (timed) {
+        stats.filterNs += timer.nsecsElapsed();
+        ++stats.timedLookups;
+    }
+    ++stats.lookups;
+
+    if (!candidate) {
+        ++stats.rejected;
+    } else {
+        if (timed) {
+            timer.restart();
+        }
+        found = currentSet()->lookup(key, &recordFlags);
+        if (timed) {
+            stats.fullLookupNs += timer.nsecsElapsed();
+            ++stats.timedFullLookups;
+        }
+        ++stats.fullLookups;
+        if (!found && currentFilter) {
+            ++stats.falsePositives;
+        }
+    }
+    bool granted = found && (recordFlags & AccessGranted);
+
+    if (!firstDecisionLogged) {
+        firstDecisionLogged = true;
+        qDebug() << "Boot to first access decision:" << bootTimer.elapsed() << "ms (served from"
+                 << (currentSet()->isMapped() ? "snapshot)" : "database)");
+    }
+
+    if (flags) {
+        *flags = recordFlags;
+    }
+    return granted;
+}
+
+bool AccessControl::enroll(const QByteArray &uid, quint32 flags, qint64 personId) {
+    QSqlQuery query;
+    query.prepare("INSERT OR REPLACE INTO credentials (uid, person_id, flags) VALUES (:uid, :person, :flags)");
+    query.bindValue(":uid", uid);
+    query.bindValue(":person", personId >= 0 ? QVariant(personId) : QVariant());
+    query.bindValue(":flags", flags);
+    if (uid.isEmpty() || !query.exec()) {
+        qDebug() << "Unable to enroll UID" << uid.toHex() << query.lastError().text();
+        return false;
+    }
+    return rebuildFromDatabase();
+}
+
+bool AccessControl::revoke(const QByteArray &uid) {
+    QSqlQuery query;
+    query.prepare("DELETE FROM credentials WHERE uid = :uid");
+    query.bindValue(":uid", uid);
+    if (!query.exec()) {
+        qDebug() << "Unable to revoke UID" << uid.toHex() << query.lastError().text();
+        return false;
+    }
+    return rebuildFromDatabase();
+}
@@ -0,0 +1,123 @@
+#ifndef ACCESSCONTROL_H
+#define ACCESSCONTROL_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QString>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+// Access flags stored next to every authorized UID
+enum AccessFlag : quint32 {
+    AccessGranted = 0x01,
+    AccessAdmin   = 0x02
+};
+
+// UID (4, 7 or 10 bytes) packed into two integers so keys compare without memcmp
+struct UidKey {
+    quint64 hi; // length in the top byte, then UID bytes 0..6
+    quint32 lo; // UID bytes 7..9
+
+    static UidKey fromBytes(const quint8 *bytes, int length);
+    static UidKey fromBytes(const QByteArray &uid);
+};
+
+// One fixed-stride (16 byte) entry of the snapshot file and of the in-memory set
+struct UidRecord {
+    quint64 hi;
+    quint32 lo;
+    quint32 flags;
+};
+static_assert(sizeof(UidRecord) == 16, "Snapshot records must stay 16 bytes");
+
+// Immutable, sorted set of authorized UIDs, either built in memory or mapped from a snapshot file
+class AccessSet {
+public:
+    static std::shared_ptr<const AccessSet> fromRecords(std::vector<UidRecord> records); // Sorts the records
+    static std::shared_ptr<const AccessSet> fromSnapshot(const QString &path);          // nullptr if missing or invalid
+    static std::shared_ptr<const AccessSet> fromDatabase(QSqlDatabase db);              // Any thread owning db
+
+    bool lookup(const UidKey &key, quint32 *flags = nullptr) const; // Branch-free lower bound
+    quint32 size() const { return count; }
+    const UidRecord *begin() const { return records; }
+    const UidRecord *end() const { return records + count; }
+    bool isMapped() const { return file != nullptr; }
+
+    bool writeSnapshot(const QString &path) const;
+    bool sameContents(const AccessSet &other) const;
+
+    ~AccessSet();
+
+private:
+    AccessSet() = default;
+
+    const UidRecord *records = nullptr;
+    quint32 count = 0;
+    std::vector<UidRecord> owned;   // Storage when built in memory
+    std::unique_ptr<QFile> file;    // Storage when mapped from a snapshot
+};
+
+class UidFilter;
+
+// Counters describing how much work the negative-lookup filter saved
+struct FilterStats {
+    quint64 lookups = 0;        // Decisions requested
+    quint64 rejected = 0;       // Answered "unknown" by the filter alone
+    quint64 falsePositives = 0; // Passed the filter but were not enrolled
+    quint64 fullLookups = 0;
+
+    // Timing is sampled: one lookup in TIMING_SAMPLE is measured
+    static constexpr quint64 TIMING_SAMPLE = 64;
+    quint64 timedLookups = 0;
+    quint64 timedFullLookups = 0;
+    quint64 filterNs = 0;       // Time spent in the filter by timed lookups
+    quint64 fullLookupNs = 0;   // Time spent in access set lookups by timed lookups
+
+    double rejectionRate() const { return lookups ? double(rejected) / lookups : 0.0; }
+    quint64 savedNs() const;    // Estimated full-lookup time avoided by rejections
+};
+
+class AccessControl : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AccessControl(const QString &snapshotPath, QObject *parent = nullptr);
+
+    bool loadSnapshot();                    // Serves lookups from the mapped snapshot until the database is ready
+    bool rebuildFromDatabase();             // Reloads credentials and re-exports the snapshot if they changed
+    void startPeriodicExport(int intervalMs = 5 * 60 * 1000);
+    void setFilterFalsePositiveRate(double rate); // Takes effect on the next full filter rebuild
+    const FilterStats &filterStats() const { return stats; }
+
+    bool isAuthorized(const QByteArray &uid, quint32 *flags = nullptr);
+    bool enroll(const QByteArray &uid, quint32 flags, qint64 personId = -1);
+    bool revoke(const QByteArray &uid);
+    std::shared_ptr<const AccessSet> currentSet() const;
+    void swapSet(std::shared_ptr<const AccessSet> set); // Atomic for concurrent readers
+    void replaceSet(std::shared_ptr<const AccessSet> set); // Exports the snapshot, then swaps
+    quint64 generation() const { return setGeneration; } // Bumped by every swap, to spot stale off-thread builds
+
+signals:
+    void accessSetChanged(quint32 count);
+
+private:
+    void updateFilter(const AccessSet &previous, const AccessSet &next);
+
+    QString snapshotPath;
+    std::shared_ptr<const AccessSet> accessSet;
+    std::shared_ptr<const UidFilter> filter;
+    quint64 setGeneration;
+    double filterRate;
+    quint32 staleKeys;          // Removed UIDs whose bits are still set in the filter
+    FilterStats stats;
+    QTimer *exportTimer;
+    QElapsedTimer bootTimer;
+    bool firstDecisionLogged;
+};
+
+#endif // ACCESSCONTROL_H
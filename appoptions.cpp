@@ -0,0 +1,102 @@
+#include "appoptions.h"
+#include "accesscontrol.h"
+#include "databasemanager.h"
+#include "doorcontroller.h"
+#include "metricsserver.h"
+#include "mqttmanager.h"
+#include "payloadcodec.h"
+#include "scanaggregator.h"
+#include <QCoreApplication>
+#include <QThread>
+
+AppOptions::AppOptions(QCommandLineParser &commandLine)
+    : parser(commandLine)
+    , profileOption("db-profile", "SQLite tuning profile: " + DatabaseProfile::names().join(", ") + ".",
+                    "name", "sd-card-edge")
+    , filterRateOption("filter-fpr", "False positive rate of the unknown-tag filter.", "rate", "0.01")
+    , backupDirOption("backup-dir", "Write scheduled online backups of test.db into this directory.", "directory")
+    , backupIntervalOption("backup-interval", "Minutes between scheduled backups.", "minutes", "1440")
+    , backupCompressOption("backup-compress", "Store scheduled backups as chunked .qz files instead of plain .db copies.")
+    , payloadFormatOption("payload-format", "MQTT payload format: text or binary.", "format", "text")
+    , mqtt5Option("mqtt5", "Connect with MQTT 5, so every publish carries the content type of its payload.")
+    , brokerOption("broker", "MQTT broker host, for the door controller and --aggregate alike.", "host", "localhost")
+    , aggregateOption("aggregate", "Collect site/+/scans from every reader into test.db instead of scanning.")
+    , decodeThreadsOption("decode-threads", "Worker threads decoding scans in --aggregate.",
+                          "count", QString::number(QThread::idealThreadCount()))
+    , metricsPortOption("metrics-port", "Serve Prometheus metrics on this TCP port (0 = off).", "port", "0")
+    , metricsBindOption("metrics-bind", "Address the metrics endpoint listens on.", "address", "127.0.0.1")
+    , metricsIntervalOption("metrics-interval", "Seconds between metrics snapshots on rfid/<host>/metrics (0 = off).",
+                            "seconds", "60")
+    , captureOption("capture", "Record every scanned UID with its timing to a reader trace.", "file")
+    , replayOption("replay", "Feed a reader trace through the pipeline instead of running the scanner.", "file")
+    , replaySpeedOption("replay-speed", "Replay speed: 1 as recorded, N times faster, 0 as fast as possible.",
+                        "factor", "1")
+    , scanRingOption("scan-ring", "Receive scans over a shared-memory ring with this name (repeatable); "
+                     "the first one is passed to the scanner process.", "name")
+{
+    parser.addOption(profileOption);
+    parser.addOption(filterRateOption);
+    parser.addOption(backupDirOption);
+    parser.addOption(backupIntervalOption);
+    parser.addOption(backupCompressOption);
+    parser.addOption(payloadFormatOption);
+    parser.addOption(mqtt5Option);
+    parser.addOption(brokerOption);
+    parser.addOption(aggregateOption);
+    parser.addOption(decodeThreadsOption);
+    parser.addOption(metricsPortOption);
+    parser.addOption(metricsBindOption);
+    parser.addOption(metricsIntervalOption);
+    parser.addOption(captureOption);
+    parser.addOption(replayOption);
+    parser.addOption(replaySpeedOption);
+    parser.addOption(scanRingOption);
+}
+
+void AppOptions::configureMqtt(MqttManager *mqttManager) const {
+    mqttManager->getClient()->setHostname(parser.value(brokerOption));
+    mqttManager->setPayloadFormat(PayloadCodec::formatFromName(parser.value(payloadFormatOption)));
+    if (parser.isSet(mqtt5Option)) {
+        mqttManager->getClient()->setProtocolVersion(QMqttClient::MQTT_5_0);
+    }
+}
+
+void AppOptions::configureController(DoorController *controller) const {
+    controller->getAccessControl()->setFilterFalsePositiveRate(parser.value(filterRateOption).toDouble());
+    configureMqtt(controller->getMqttManager());
+    controller->enableMetrics(QHostAddress(parser.value(metricsBindOption)), parser.value(metricsPortOption).toUShort(),
+                              parser.value(metricsIntervalOption).toInt());
+    if (parser.isSet(scanRingOption)) {
+        controller->enableScanRings(parser.values(scanRingOption));
+    }
+    if (parser.isSet(captureOption)) {
+        controller->startCapture(parser.value(captureOption));
+    }
+}
+
+bool AppOptions::startReplay(DoorController *controller) const {
+    return !parser.isSet(replayOption)
+           || controller->setReplay(parser.value(replayOption), parser.value(replaySpeedOption).toDouble());
+}
+
+int AppOptions::runAggregator(const std::function<void()> &ready) const {
+    DatabaseManager databaseManager;
+    if (!databaseManager.open("test.db", DatabaseProfile::byName(parser.value(profileOption)))) {
+        return 1;
+    }
+    MqttManager mqttManager(parser.value(brokerOption), 1883);
+    configureMqtt(&mqttManager);
+    mqttManager.setPublishPeople(false);
+    ScanAggregator aggregator(&mqttManager, "test.db");
+    aggregator.setDecodeThreads(parser.value(decodeThreadsOption).toInt());
+    aggregator.start();
+    MetricsServer metricsServer;
+    if (parser.value(metricsPortOption).toUShort() > 0) {
+        metricsServer.listen(QHostAddress(parser.value(metricsBindOption)), parser.value(metricsPortOption).toUShort());
+    }
+    mqttManager.connectToBroker();
+    if (ready) {
+        ready();
+    }
+    return QCoreApplication::exec();
+}
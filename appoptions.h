@@ -0,0 +1,54 @@
+#ifndef APPOPTIONS_H
+#define APPOPTIONS_H
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <functional>
+
+class DoorController;
+class MqttManager;
+
+// Command line shared by the GUI and the headless daemon. Each binary adds its own extras to the
+// same parser before process(); everything below means the same in both.
+class AppOptions
+{
+public:
+    explicit AppOptions(QCommandLineParser &parser); // Registers the shared options
+
+    void configureMqtt(MqttManager *mqttManager) const; // Broker, payload format, MQTT 5; before connecting
+    void configureController(DoorController *controller) const; // Filter, metrics, rings, capture
+    bool startReplay(DoorController *controller) const; // false if --replay names an unreadable trace
+    bool replaying() const { return parser.isSet(replayOption); }
+
+    bool aggregate() const { return parser.isSet(aggregateOption); }
+    // Runs the event loop as a scan aggregator; ready is called once it is collecting
+    int runAggregator(const std::function<void()> &ready = {}) const;
+
+    QString databaseProfile() const { return parser.value(profileOption); }
+    bool backups() const { return parser.isSet(backupDirOption); }
+    QString backupDirectory() const { return parser.value(backupDirOption); }
+    int backupIntervalMinutes() const { return parser.value(backupIntervalOption).toInt(); }
+    bool compressBackups() const { return parser.isSet(backupCompressOption); }
+
+private:
+    QCommandLineParser &parser;
+    QCommandLineOption profileOption;
+    QCommandLineOption filterRateOption;
+    QCommandLineOption backupDirOption;
+    QCommandLineOption backupIntervalOption;
+    QCommandLineOption backupCompressOption;
+    QCommandLineOption payloadFormatOption;
+    QCommandLineOption mqtt5Option;
+    QCommandLineOption brokerOption;
+    QCommandLineOption aggregateOption;
+    QCommandLineOption decodeThreadsOption;
+    QCommandLineOption metricsPortOption;
+    QCommandLineOption metricsBindOption;
+    QCommandLineOption metricsIntervalOption;
+    QCommandLineOption captureOption;
+    QCommandLineOption replayOption;
+    QCommandLineOption replaySpeedOption;
+    QCommandLineOption scanRingOption;
+};
+
+#endif // APPOPTIONS_H
@@ -0,0 +1,23 @@
+# ISO/IEC 14443-4 throughput on the reader hardware: activation and APDU exchange latency.
+# Build with qmake from this directory on the Pi; needs a DESFire or other T=CL card on the antenna.
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = isodepbench
+
+INCLUDEPATH += ../..
+LIBS += -lwiringPi
+
+SOURCES += \
+    main.cpp \
+    ../../MFRC522.cpp \
+    ../../isodep.cpp \
+    ../../piccpolicy.cpp
+
+HEADERS += \
+    ../../MFRC522.h \
+    ../../isodep.h \
+    ../../piccpolicy.h \
+    ../../rc522timing.h
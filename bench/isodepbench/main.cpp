@@ -0,0 +1,146 @@
+#include "isodep.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Activates the ISO/IEC 14443-4 card on the antenna and exchanges one APDU over and over,
+ * reporting activation and APDU latency and the T=CL throughput (APDU plus response bytes).
+ *
+ *   isodepbench --apdu 9060000000 --iterations 200 --bitrate 2
+ *
+ * The default APDU is DESFire GetVersion in ISO 7816 wrapping. An APDU or response longer than
+ * the frame sizes exercises chaining and the streamed FIFO; --reactivate deselects and
+ * activates again before every APDU, the way a door sees a fresh tap.
+ */
+
+static double percentile(const std::vector<qint64> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[index] / 1000.0; // us
+}
+
+static void report(const char *name, std::vector<qint64> &samples) {
+    std::sort(samples.begin(), samples.end());
+    qDebug().nospace() << name << ": p50 " << percentile(samples, 0.50) << " us, p99 "
+                       << percentile(samples, 0.99) << " us, max " << samples.back() / 1000.0 << " us";
+}
+
+static bool selectCard(MFRC522 &reader) {
+    rfid_byte atqa[2];
+    rfid_byte atqaSize = sizeof(atqa);
+    if (reader.PICC_REQA_or_WUPA(PICC_CMD_WUPA, atqa, &atqaSize) != STATUS_OK) {
+        return false;
+    }
+    return reader.PICC_Select(&reader.uid) == STATUS_OK;
+}
+
+// WUPA, select and RATS/PPS; the time spent is appended to activationNs
+static rfid_byte activate(MFRC522 &reader, IsoDep &card, rfid_byte maxBitRate, std::vector<qint64> &activationNs) {
+    QElapsedTimer timer;
+    timer.start();
+    if (!selectCard(reader)) {
+        return STATUS_TIMEOUT;
+    }
+    if (!(reader.uid.sak & 0x20)) {
+        return STATUS_INVALID; // Not ISO/IEC 14443-4 compliant
+    }
+    rfid_byte status = card.activate(maxBitRate);
+    if (status == STATUS_OK) {
+        activationNs.push_back(timer.nsecsElapsed());
+    }
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"apdu", "Command APDU, hex", "hex", "9060000000"});
+    parser.addOption({"iterations", "APDU exchanges", "count", "100"});
+    parser.addOption({"bitrate", "Highest PPS bit rate: 0=106, 1=212, 2=424, 3=848 kbit/s", "code", "2"});
+    parser.addOption({"reactivate", "Deselect and activate again before every APDU"});
+    parser.process(app);
+
+    QByteArray apdu = QByteArray::fromHex(parser.value("apdu").toLatin1());
+    if (apdu.isEmpty()) {
+        qDebug() << "The APDU needs at least one byte";
+        return 1;
+    }
+    int iterations = parser.value("iterations").toInt();
+    rfid_byte maxBitRate = rfid_byte(parser.value("bitrate").toInt());
+    bool reactivate = parser.isSet("reactivate");
+
+    MFRC522 reader;
+    reader.PCD_Init();
+    IsoDep card(&reader);
+
+    qDebug() << "Waiting for a card...";
+    std::vector<qint64> activationNs;
+    rfid_byte status;
+    while ((status = activate(reader, card, maxBitRate, activationNs)) != STATUS_OK) {
+        if (status == STATUS_INVALID) {
+            qDebug() << "Card does not support ISO/IEC 14443-4, SAK" << Qt::hex << int(reader.uid.sak);
+            return 1;
+        }
+        QThread::msleep(100);
+    }
+    int atsLength;
+    const rfid_byte *ats = card.ats(&atsLength);
+    qDebug() << "ATS" << QByteArray(reinterpret_cast<const char *>(ats), atsLength).toHex(' ')
+             << "FSC" << card.cardFrameSize() << "FWT" << card.frameWaitUs() << "us";
+
+    std::vector<rfid_byte> response(4096);
+    std::vector<qint64> apduNs;
+    qint64 bytes = 0;
+    qint64 apduTotalNs = 0;
+    int failures = 0;
+    QByteArray lastResponse;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        if (reactivate || !card.isActive()) {
+            if (card.isActive()) {
+                card.deselect();
+            }
+            if (activate(reader, card, maxBitRate, activationNs) != STATUS_OK) {
+                ++failures;
+                continue;
+            }
+        }
+        int responseLen = int(response.size());
+        timer.start();
+        status = card.transceive(reinterpret_cast<const rfid_byte *>(apdu.constData()), apdu.size(),
+                                 response.data(), &responseLen);
+        qint64 elapsed = timer.nsecsElapsed();
+        if (status != STATUS_OK) {
+            ++failures;
+            continue;
+        }
+        apduNs.push_back(elapsed);
+        apduTotalNs += elapsed;
+        bytes += apdu.size() + responseLen;
+        lastResponse = QByteArray(reinterpret_cast<const char *>(response.data()), responseLen);
+    }
+    if (card.isActive()) {
+        card.deselect();
+    }
+
+    if (apduNs.empty()) {
+        qDebug() << "No APDU was answered, is the card still on the antenna?";
+        return 1;
+    }
+    qDebug() << "Last response" << lastResponse.toHex(' ');
+    report("Activation", activationNs);
+    report("APDU      ", apduNs);
+    qDebug().nospace() << apduNs.size() << " APDUs, " << bytes << " bytes: "
+                       << bytes * 1e6 / qMax<qint64>(apduTotalNs, 1) << " KB/s";
+    qDebug() << "Failed:" << failures;
+    return 0;
+}
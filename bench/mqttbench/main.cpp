@@ -0,0 +1,206 @@
+#include "mqttmanager.h"
+#include "payloadcodec.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Publishes synthetic scan events through MqttManager at a fixed rate, receives them back on the
+ * same client and reports throughput, latency percentiles and resident memory growth.
+ *
+ *   mqttbench --rate 5000 --size 256 --duration 30 --qos 0
+ *
+ * Unless --no-broker is given a private mosquitto is started on 127.0.0.1:<port>, so the whole
+ * run stays on loopback. Latency is measured with one monotonic clock: every message carries its
+ * sequence number and the send time is looked up when it comes back.
+ */
+
+static qint64 residentKiB() {
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return 0;
+}
+
+static bool waitForPort(quint16 port, int timeoutMs) {
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < timeoutMs) {
+        QTcpSocket socket;
+        socket.connectToHost("127.0.0.1", port);
+        if (socket.waitForConnected(100)) {
+            return true;
+        }
+        QThread::msleep(50);
+    }
+    return false;
+}
+
+static double percentile(const std::vector<qint64> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[index] / 1000.0; // us
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption rateOption("rate", "Messages per second.", "count", "1000");
+    QCommandLineOption sizeOption("size", "Payload size in bytes (rounded to whole scan events).", "bytes", "32");
+    QCommandLineOption durationOption("duration", "Seconds of publishing.", "seconds", "10");
+    QCommandLineOption qosOption("qos", "QoS of the published messages.", "level", "0");
+    QCommandLineOption portOption("port", "Broker port on 127.0.0.1.", "port", "18830");
+    QCommandLineOption brokerOption("broker-bin", "Broker executable to start.", "path", "mosquitto");
+    QCommandLineOption noBrokerOption("no-broker", "Use a broker that is already listening on --port.");
+    QCommandLineOption topicOption("topic", "Topic to publish on, e.g. site/bench/scans to feed an aggregator.",
+                                   "topic", QString("bench/%1/scans").arg(QCoreApplication::applicationPid()));
+    parser.addOption(rateOption);
+    parser.addOption(sizeOption);
+    parser.addOption(durationOption);
+    parser.addOption(qosOption);
+    parser.addOption(portOption);
+    parser.addOption(brokerOption);
+    parser.addOption(noBrokerOption);
+    parser.addOption(topicOption);
+    parser.process(app);
+
+    const int rate = qMax(1, parser.value(rateOption).toInt());
+    const int eventsPerMessage = qMax(1, (parser.value(sizeOption).toInt() - PayloadCodec::HEADER_BYTES)
+                                             / PayloadCodec::SCAN_EVENT_BYTES);
+    const qint64 durationMs = parser.value(durationOption).toLongLong() * 1000;
+    const quint8 qos = static_cast<quint8>(parser.value(qosOption).toInt());
+    const quint16 port = static_cast<quint16>(parser.value(portOption).toUInt());
+
+    QProcess broker;
+    if (!parser.isSet(noBrokerOption)) {
+        broker.start(parser.value(brokerOption), {"-p", QString::number(port)});
+        if (!broker.waitForStarted() || !waitForPort(port, 5000)) {
+            qDebug() << "Unable to start" << parser.value(brokerOption) << "on port" << port;
+            return 1;
+        }
+    }
+
+    MqttManager mqtt("127.0.0.1", port);
+    mqtt.setPublishPeople(false); // No database here, only the scan traffic is measured
+
+    const QString topic = parser.value(topicOption);
+    const qint64 expected = rate * durationMs / 1000;
+    std::vector<qint64> sentNs(expected, -1);
+    std::vector<qint64> latencyNs;
+    latencyNs.reserve(expected);
+    qint64 received = 0;
+    qint64 receivedBytes = 0;
+    QElapsedTimer clock;
+
+    mqtt.addRoute(topic, [&](const QByteArray &payload, const QMqttTopicName &) {
+        qint64 now = clock.nsecsElapsed();
+        ScanEventReader reader(payload);
+        if (!reader.isValid() || reader.count() == 0) {
+            return;
+        }
+        quint32 sequence = reader.at(0).sequence;
+        if (sequence < sentNs.size() && sentNs[sequence] >= 0) {
+            latencyNs.push_back(now - sentNs[sequence]);
+            sentNs[sequence] = -1; // A duplicate delivery is not measured twice
+        }
+        ++received;
+        receivedBytes += payload.size();
+    });
+
+    std::vector<ScanEvent> events(eventsPerMessage);
+    for (int i = 0; i < eventsPerMessage; ++i) {
+        ScanEvent &event = events[i];
+        event = {};
+        event.uidLength = 4;
+        event.uid[0] = 0x04;
+        event.uid[1] = static_cast<quint8>(i);
+        event.decision = 1;
+    }
+    QByteArray payload;
+    qint64 sent = 0;
+    qint64 refused = 0;
+    qint64 rssBefore = 0;
+    qint64 rssPeak = 0;
+    qint64 sendEndNs = 0;
+
+    QTimer pacer;
+    pacer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&pacer, &QTimer::timeout, [&]() {
+        qint64 elapsedMs = clock.elapsed();
+        qint64 due = qMin(expected, rate * qMin(elapsedMs, durationMs) / 1000);
+        while (sent < due) {
+            qint64 now = clock.nsecsElapsed();
+            events[0].timestampMs = now / 1000000;
+            events[0].sequence = static_cast<quint32>(sent);
+            PayloadCodec::encodeScanEvents(events.data(), eventsPerMessage, payload);
+            sentNs[sent] = now;
+            if (mqtt.publish(topic, payload, qos) < 0) {
+                sentNs[sent] = -1;
+                ++refused;
+            }
+            ++sent;
+        }
+        rssPeak = qMax(rssPeak, residentKiB());
+        if (sent >= expected) {
+            pacer.stop();
+            sendEndNs = clock.nsecsElapsed();
+            QTimer::singleShot(2000, &app, &QCoreApplication::quit); // Drain what is still in flight
+        }
+    });
+
+    QObject::connect(mqtt.getClient(), &QMqttClient::connected, [&]() {
+        // Give the subscription a moment to reach the broker before the clock starts
+        QTimer::singleShot(200, [&]() {
+            rssBefore = residentKiB();
+            clock.start();
+            pacer.start(1);
+        });
+    });
+    QTimer::singleShot(durationMs + 30000, &app, [&]() {
+        qDebug() << "Benchmark timed out";
+        QCoreApplication::exit(2);
+    });
+
+    mqtt.connectToBroker();
+    int status = app.exec();
+
+    std::sort(latencyNs.begin(), latencyNs.end());
+    double sendSeconds = qMax<qint64>(sendEndNs, 1) / 1e9;
+    qDebug().nospace() << "Published " << sent << " messages (" << eventsPerMessage << " events, "
+                       << payload.size() << " bytes each) at QoS " << qos << ", " << refused << " refused";
+    qDebug().nospace() << "Throughput: " << qRound(sent / sendSeconds) << " msg/s sent, "
+                       << qRound(received / sendSeconds) << " msg/s received, "
+                       << qRound(receivedBytes / sendSeconds / 1024) << " KiB/s";
+    qDebug().nospace() << "Lost: " << (sent - refused - static_cast<qint64>(latencyNs.size()));
+    qDebug().nospace() << "Latency us: p50 " << percentile(latencyNs, 0.50) << ", p99 "
+                       << percentile(latencyNs, 0.99) << ", p999 " << percentile(latencyNs, 0.999) << ", max "
+                       << (latencyNs.empty() ? 0 : latencyNs.back() / 1000.0);
+    qDebug().nospace() << "Resident memory: " << rssBefore << " KiB before, " << rssPeak << " KiB peak, "
+                       << residentKiB() << " KiB after (" << (residentKiB() - rssBefore) << " KiB growth)";
+
+    if (broker.state() == QProcess::Running) {
+        broker.terminate();
+        broker.waitForFinished(2000);
+    }
+    return status;
+}
@@ -0,0 +1,31 @@
+# End-to-end MQTT benchmark: drives MqttManager against a local broker process.
+# Build with qmake from this directory; no window, no database, no network beyond loopback.
+QT       += core sql mqtt
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = mqttbench
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../latencyhistogram.cpp \
+    ../../logger.cpp \
+    ../../metrics.cpp \
+    ../../mqttmanager.cpp \
+    ../../payloadcodec.cpp \
+    ../../scanpublisher.cpp \
+    ../../segmentlog.cpp \
+    ../../topicrouter.cpp
+
+HEADERS += \
+    ../../latencyhistogram.h \
+    ../../logger.h \
+    ../../metrics.h \
+    ../../mqttmanager.h \
+    ../../payloadcodec.h \
+    ../../scanpublisher.h \
+    ../../segmentlog.h \
+    ../../topicrouter.h
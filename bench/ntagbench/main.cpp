@@ -0,0 +1,226 @@
+#include "MFRC522.h"
+#include "cardcache.h"
+#include "metrics.h"
+#include "ndef.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/**
+ * Reads the whole tag on the antenna over and over, alternating FAST_READ in FIFO-sized chunks
+ * with the 4-page READ the driver used before, and reports per-read latency for both. A third
+ * pass goes through CardCache: a probe read first, the full dump only on a miss.
+ *
+ *   ntagbench --iterations 200 [--probe-page 40]
+ *
+ * All methods must return identical memory; the NDEF message found in it is printed once so
+ * the parse of a real visitor pass can be checked by eye.
+ *
+ * The probe has to change whenever the content does, or the cache hands out stale memory. By
+ * default it is the whole NDEF TLV, read up to the end of the message. --probe-page names 4 pages
+ * the issuer rewrites on every update (a counter or update block) and probes only those.
+ */
+
+static double percentile(const std::vector<qint64> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[index] / 1000.0; // us
+}
+
+// Pages from NTAG_USER_START_PAGE up to the end of the first NDEF TLV, found in the first 4 user
+// pages; all user pages when the TLV starts later or its length is not in those 16 bytes
+static int ndefProbePages(const rfid_byte *head, int userPages) {
+    const int headBytes = 4 * NTAG_PAGE_SIZE;
+    int offset = 0;
+    while (offset < headBytes) {
+        rfid_byte tag = head[offset++];
+        if (tag == 0x00) {
+            continue; // NULL TLV
+        }
+        if (tag == 0xFE || offset >= headBytes) { // Terminator TLV, or the length is past the head
+            break;
+        }
+        int length = head[offset++];
+        if (length == 0xFF) {
+            if (offset + 2 > headBytes) {
+                break;
+            }
+            length = (head[offset] << 8) | head[offset + 1];
+            offset += 2;
+        }
+        if (tag == 0x03) { // NDEF message TLV
+            int pages = (offset + length + NTAG_PAGE_SIZE - 1) / NTAG_PAGE_SIZE;
+            return std::min(std::max(pages, 4), userPages);
+        }
+        offset += length;
+    }
+    return userPages;
+}
+
+static bool selectTag(MFRC522 &reader) {
+    rfid_byte atqa[2];
+    rfid_byte atqaSize = sizeof(atqa);
+    // WUPA also wakes a tag that was halted or fell back to IDLE after a NAK
+    if (reader.PICC_REQA_or_WUPA(PICC_CMD_WUPA, atqa, &atqaSize) != STATUS_OK) {
+        return false;
+    }
+    return reader.PICC_Select(&reader.uid) == STATUS_OK;
+}
+
+static void report(const char *name, std::vector<qint64> &samples, int bytes) {
+    std::sort(samples.begin(), samples.end());
+    double median = percentile(samples, 0.50);
+    qDebug().nospace() << name << ": p50 " << median << " us, p99 " << percentile(samples, 0.99)
+                       << " us, max " << samples.back() / 1000.0 << " us, "
+                       << (median > 0 ? bytes / median * 1000.0 : 0) << " KB/s";
+}
+
+static void printNdef(const rfid_byte *memory, int bytes) {
+    NdefBytes message;
+    NdefBytes user(memory + NTAG_USER_START_PAGE * NTAG_PAGE_SIZE, bytes - NTAG_USER_START_PAGE * NTAG_PAGE_SIZE);
+    if (!ndefFindMessage(user, &message)) {
+        qDebug() << "No NDEF message on the tag";
+        return;
+    }
+    NdefRecordReader records(message);
+    NdefRecord record;
+    while (records.next(&record)) {
+        const char *prefix;
+        NdefBytes text;
+        NdefBytes language;
+        if (ndefUriRecord(record, &prefix, &text)) {
+            qDebug().nospace() << "URI " << prefix << QByteArray::fromRawData(reinterpret_cast<const char *>(text.data), int(text.size));
+        } else if (ndefTextRecord(record, &language, &text)) {
+            qDebug().nospace() << "Text (" << QByteArray::fromRawData(reinterpret_cast<const char *>(language.data), int(language.size))
+                               << ") " << QByteArray::fromRawData(reinterpret_cast<const char *>(text.data), int(text.size));
+        } else {
+            qDebug() << "Record TNF" << record.tnf << "payload" << record.payload.size << "bytes";
+        }
+    }
+    if (records.failed()) {
+        qDebug() << "Malformed NDEF record";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"iterations", "Full-tag reads per method", "count", "100"});
+    parser.addOption({"probe-page", "Probe only the 4 pages from this one; the issuer must rewrite them on "
+                                    "every update (counter or update block). Default: the whole NDEF message", "page"});
+    parser.process(app);
+    int iterations = parser.value("iterations").toInt();
+    bool probeNdef = !parser.isSet("probe-page");
+    rfid_byte probePage = rfid_byte(parser.value("probe-page").toInt());
+
+    MFRC522 reader;
+    reader.PCD_Init();
+
+    qDebug() << "Waiting for a tag...";
+    while (!selectTag(reader)) {
+        QThread::msleep(100);
+    }
+
+    NtagInfo info;
+    if (reader.PICC_GetVersion(&info) != STATUS_OK) {
+        qDebug() << "Tag does not answer GET_VERSION; not an NTAG21x or Ultralight EV1";
+        return 1;
+    }
+    int bytes = info.pages * NTAG_PAGE_SIZE;
+    qDebug() << "Tag type" << info.type << "with" << info.pages << "pages," << bytes << "bytes";
+
+    std::vector<rfid_byte> fast(bytes);
+    std::vector<rfid_byte> paged(bytes);
+    std::vector<qint64> fastNs;
+    std::vector<qint64> pagedNs;
+    std::vector<qint64> cachedNs;
+    CardCache cache("ntagbench", 64 * 1024);
+    std::shared_ptr<const std::vector<uint8_t>> cached;
+    CardCache::CardRead probe = [&](std::vector<uint8_t> *out) {
+        out->resize(4 * NTAG_PAGE_SIZE);
+        if (!probeNdef) {
+            return reader.NTAG_ReadPages(probePage, 4, out->data(), false) == STATUS_OK;
+        }
+        if (reader.NTAG_ReadPages(NTAG_USER_START_PAGE, 4, out->data(), false) != STATUS_OK) {
+            return false;
+        }
+        int pages = ndefProbePages(out->data(), info.userPages);
+        if (pages > 4) {
+            out->resize(pages * NTAG_PAGE_SIZE);
+            return reader.NTAG_ReadPages(NTAG_USER_START_PAGE + 4, pages - 4, out->data() + 4 * NTAG_PAGE_SIZE, true)
+                   == STATUS_OK;
+        }
+        return true;
+    };
+    CardCache::CardRead dump = [&](std::vector<uint8_t> *out) {
+        out->resize(bytes);
+        return reader.NTAG_ReadPages(0, info.pages, out->data(), true) == STATUS_OK;
+    };
+    int failures = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        rfid_byte status = reader.NTAG_ReadPages(0, info.pages, fast.data(), true);
+        qint64 elapsed = timer.nsecsElapsed();
+        if (status == STATUS_OK) {
+            fastNs.push_back(elapsed);
+        } else {
+            ++failures;
+            selectTag(reader);
+        }
+
+        timer.start();
+        status = reader.NTAG_ReadPages(0, info.pages, paged.data(), false);
+        elapsed = timer.nsecsElapsed();
+        if (status == STATUS_OK) {
+            pagedNs.push_back(elapsed);
+        } else {
+            ++failures;
+            selectTag(reader);
+        }
+
+        timer.start();
+        std::shared_ptr<const std::vector<uint8_t>> content = cache.fetch(reader.uid.uidbyte, reader.uid.size, probe, dump);
+        elapsed = timer.nsecsElapsed();
+        if (content) {
+            cachedNs.push_back(elapsed);
+            cached = content;
+        } else {
+            ++failures;
+            selectTag(reader);
+        }
+    }
+
+    if (fastNs.empty() || pagedNs.empty() || cachedNs.empty()) {
+        qDebug() << "No successful reads, is the tag still on the antenna?";
+        return 1;
+    }
+    if (memcmp(fast.data(), paged.data(), bytes) != 0) {
+        qDebug() << "FAST_READ and READ returned different memory";
+        return 1;
+    }
+    if (cached->size() != size_t(bytes) || memcmp(fast.data(), cached->data(), bytes) != 0) {
+        qDebug() << "The cache returned different memory than FAST_READ";
+        return 1;
+    }
+    report("FAST_READ", fastNs, bytes);
+    report("READ     ", pagedNs, bytes);
+    report("CACHED   ", cachedNs, bytes);
+    qDebug() << "Failed reads:" << failures;
+    for (const QByteArray &line : MetricsRegistry::instance().prometheusText().split('\n')) {
+        if (line.startsWith("rfid_card_cache_")) {
+            qDebug().noquote() << line;
+        }
+    }
+    printNdef(fast.data(), bytes);
+    return 0;
+}
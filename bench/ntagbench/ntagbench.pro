@@ -0,0 +1,31 @@
+# Full-tag read benchmark on the reader hardware: FAST_READ chunks against 4-page READ.
+# Build with qmake from this directory on the Pi; needs an NTAG21x or Ultralight EV1 on the antenna.
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = ntagbench
+
+INCLUDEPATH += ../..
+LIBS += -lwiringPi
+
+SOURCES += \
+    main.cpp \
+    ../../MFRC522.cpp \
+    ../../cardcache.cpp \
+    ../../latencyhistogram.cpp \
+    ../../metrics.cpp \
+    ../../ndef.cpp \
+    ../../piccpolicy.cpp \
+    ../../readertrace.cpp
+
+HEADERS += \
+    ../../MFRC522.h \
+    ../../cardcache.h \
+    ../../latencyhistogram.h \
+    ../../metrics.h \
+    ../../ndef.h \
+    ../../piccpolicy.h \
+    ../../rc522timing.h \
+    ../../readertrace.h
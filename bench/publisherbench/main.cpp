@@ -0,0 +1,203 @@
+#include "scanpublisher.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QtEndian>
+#include <QDebug>
+
+/**
+ * Drives ScanPublisher through broker outages and refused publishes against a stand-in broker
+ * and checks the store-and-forward contract: every message arrives, new messages arrive in
+ * enqueue order (redeliveries after a reconnect may repeat older ones) and nothing is left
+ * queued, spilled or in flight at the end.
+ *
+ *   publisherbench --messages 20000 --rate 2000 --outage-every 1500 --outage-length 400
+ *
+ * Exits 1 when the contract is broken, 2 when the run times out.
+ */
+
+// Accepts publishes while "connected", refuses every refuseEvery-th one like a full client
+// buffer, and acknowledges QoS 1 packet ids after ackDelayMs unless the session dropped first.
+class StandInBroker : public QObject, public PublishTransport {
+public:
+    StandInBroker(int refuseEvery, int ackDelayMs)
+        : publisher(nullptr), connected(false), session(0), nextId(1), attempts(0)
+        , refuseEvery(refuseEvery), ackDelayMs(ackDelayMs), received(0), duplicates(0), outOfOrder(0)
+        , nextSequence(0) {}
+
+    bool isConnected() const override { return connected; }
+
+    qint32 publish(const QString &, const QByteArray &payload, quint8 qos) override {
+        if (!connected || (refuseEvery > 0 && ++attempts % refuseEvery == 0)) {
+            return -1;
+        }
+        record(payload);
+        if (qos == 0) {
+            return 0;
+        }
+
+        qint32 id = nextId++;
+        int sessionAtSend = session;
+        QTimer::singleShot(ackDelayMs, this, [this, id, sessionAtSend]() {
+            if (connected && session == sessionAtSend) {
+                publisher->acknowledge(id);
+            }
+        });
+        return id;
+    }
+
+    void setConnected(bool up) {
+        if (up == connected) {
+            return;
+        }
+        connected = up;
+        if (up) {
+            ++session; // Acknowledgements of the old session are lost with it
+        }
+        publisher->connectionChanged(up);
+    }
+
+    ScanPublisher *publisher;
+    bool connected;
+    int session;
+    qint32 nextId;
+    quint64 attempts;
+    int refuseEvery;
+    int ackDelayMs;
+    quint64 received;
+    quint64 duplicates;
+    quint64 outOfOrder;
+    quint32 nextSequence; // Lowest sequence never seen
+
+private:
+    void record(const QByteArray &payload) {
+        ++received;
+        quint32 sequence = qFromLittleEndian<quint32>(payload.constData());
+        if (sequence < nextSequence) {
+            ++duplicates; // Redelivery of something already here, allowed at-least-once
+        } else if (sequence == nextSequence) {
+            ++nextSequence;
+        } else {
+            ++outOfOrder; // A newer message overtook an older one
+            nextSequence = sequence + 1;
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption messagesOption("messages", "Messages to enqueue.", "count", "20000");
+    QCommandLineOption rateOption("rate", "Messages enqueued per second.", "count", "2000");
+    QCommandLineOption sizeOption("size", "Payload size in bytes.", "bytes", "32");
+    QCommandLineOption qosOption("qos", "QoS of the messages.", "level", "1");
+    QCommandLineOption queueOption("max-queued", "ScanPublisher memory queue limit.", "messages", "1000");
+    QCommandLineOption outageEveryOption("outage-every", "Milliseconds between broker outages, 0 for none.", "ms",
+                                         "1500");
+    QCommandLineOption outageLengthOption("outage-length", "Milliseconds each outage lasts.", "ms", "400");
+    QCommandLineOption refuseOption("refuse-every", "Refuse every n-th publish, 0 for never.", "n", "50");
+    QCommandLineOption ackOption("ack-delay", "Milliseconds until a QoS 1 message is acknowledged.", "ms", "5");
+    parser.addOption(messagesOption);
+    parser.addOption(rateOption);
+    parser.addOption(sizeOption);
+    parser.addOption(qosOption);
+    parser.addOption(queueOption);
+    parser.addOption(outageEveryOption);
+    parser.addOption(outageLengthOption);
+    parser.addOption(refuseOption);
+    parser.addOption(ackOption);
+    parser.process(app);
+
+    const quint32 messages = parser.value(messagesOption).toUInt();
+    const int rate = qMax(1, parser.value(rateOption).toInt());
+    const int size = qMax(4, parser.value(sizeOption).toInt());
+    const quint8 qos = static_cast<quint8>(parser.value(qosOption).toInt());
+    const int outageEvery = parser.value(outageEveryOption).toInt();
+    const int outageLength = parser.value(outageLengthOption).toInt();
+
+    QTemporaryDir spool;
+    if (!spool.isValid()) {
+        qDebug() << "Unable to create a spill directory";
+        return 1;
+    }
+
+    StandInBroker broker(parser.value(refuseOption).toInt(), parser.value(ackOption).toInt());
+    ScanPublisher publisher(&broker, spool.path());
+    publisher.setMaxQueued(parser.value(queueOption).toInt());
+    broker.publisher = &publisher;
+    broker.setConnected(true);
+
+    QElapsedTimer clock;
+    quint32 enqueued = 0;
+    quint64 peakQueued = 0;
+    quint64 peakSpilled = 0;
+    int outages = 0;
+    QByteArray payload(size, '\0');
+
+    QTimer pacer;
+    pacer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&pacer, &QTimer::timeout, [&]() {
+        quint32 due = qMin<quint64>(messages, quint64(rate) * clock.elapsed() / 1000);
+        while (enqueued < due) {
+            qToLittleEndian<quint32>(enqueued, payload.data());
+            publisher.enqueue("bench/publisher", payload, qos);
+            ++enqueued;
+        }
+
+        PublisherStats stats = publisher.stats();
+        peakQueued = qMax(peakQueued, stats.queued);
+        peakSpilled = qMax(peakSpilled, stats.spilled);
+        if (enqueued == messages && broker.connected && stats.queued == 0 && stats.spilled == 0
+            && stats.inFlight == 0) {
+            app.quit();
+        }
+    });
+
+    QTimer outage;
+    QObject::connect(&outage, &QTimer::timeout, [&]() {
+        if (enqueued == messages) {
+            outage.stop(); // Let the backlog drain
+            return;
+        }
+        ++outages;
+        broker.setConnected(false);
+        QTimer::singleShot(outageLength, &broker, [&]() { broker.setConnected(true); });
+    });
+
+    QTimer::singleShot(qint64(messages) * 1000 / rate + 60000, &app, [&]() {
+        qDebug() << "Benchmark timed out";
+        QCoreApplication::exit(2);
+    });
+
+    clock.start();
+    pacer.start(1);
+    if (outageEvery > 0) {
+        outage.start(outageEvery);
+    }
+    int status = app.exec();
+    double seconds = qMax<qint64>(clock.elapsed(), 1) / 1000.0;
+
+    PublisherStats stats = publisher.stats();
+    qDebug().nospace() << "Enqueued " << enqueued << " messages of " << size << " bytes at QoS " << qos
+                       << " through " << outages << " outages in " << seconds << " s";
+    qDebug().nospace() << "Broker received " << broker.received << " (" << broker.duplicates << " redelivered), "
+                       << qRound(broker.received / seconds) << " msg/s";
+    qDebug().nospace() << "Spilled " << stats.totalSpilled << " messages in total, peak " << peakSpilled
+                       << " on disk and " << peakQueued << " in memory, " << stats.dropped << " dropped";
+    qDebug().nospace() << "Latency ms: last " << stats.lastLatencyMs << ", max " << stats.maxLatencyMs;
+
+    bool ok = status == 0 && broker.nextSequence == messages && broker.outOfOrder == 0 && stats.dropped == 0;
+    if (!ok) {
+        qDebug().nospace() << "FAILED: " << broker.nextSequence << " of " << messages << " delivered in order, "
+                           << broker.outOfOrder << " out of order";
+        return status != 0 ? status : 1;
+    }
+    qDebug() << "OK";
+    return 0;
+}
@@ -0,0 +1,19 @@
+# Store-and-forward check for ScanPublisher against an in-process stand-in broker.
+# Build with qmake from this directory; no broker, no network, spill files in a temporary directory.
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = publisherbench
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../scanpublisher.cpp \
+    ../../segmentlog.cpp
+
+HEADERS += \
+    ../../scanpublisher.h \
+    ../../segmentlog.h
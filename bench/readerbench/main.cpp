@@ -0,0 +1,118 @@
+#include "rfidreader.h"
+#include "readerwatchdog.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+#include <vector>
+
+/**
+ * Runs each reader on its own thread with a ReaderWatchdog next to it, the way a multi-reader
+ * door does, and reports tags seen, faults and recoveries per reader. Pull a reader's power or
+ * MISO wire during the run to exercise the recovery ladder.
+ *
+ *   readerbench --reader 0:25 --reader 1:24 --seconds 120 --interval 1000
+ *
+ * Each --reader is SPI channel:RST pin (BCM). The rfid_reader_* metrics are printed at the end.
+ */
+
+struct ReaderRun {
+    QString name;
+    QThread *thread;
+    RFIDReader *reader;
+    ReaderWatchdog *watchdog;
+    int tags = 0;
+    int failures = 0;
+    int recoveries = 0;
+    qint64 downMs = 0;
+};
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"reader", "Reader as SPI channel:RST pin, repeatable", "channel:pin"});
+    parser.addOption({"seconds", "How long to run", "seconds", "60"});
+    parser.addOption({"interval", "Health check interval", "ms", "1000"});
+    parser.process(app);
+
+    QStringList specs = parser.values("reader");
+    if (specs.isEmpty()) {
+        specs << "0:25";
+    }
+    int intervalMs = parser.value("interval").toInt();
+
+    std::vector<ReaderRun> runs(specs.size());
+    for (int i = 0; i < specs.size(); ++i) {
+        QStringList parts = specs[i].split(':');
+        bool channelOk = false;
+        bool pinOk = false;
+        int channel = parts.value(0).toInt(&channelOk);
+        int pin = parts.value(1).toInt(&pinOk);
+        if (parts.size() != 2 || !channelOk || !pinOk) {
+            qDebug() << "Bad --reader" << specs[i] << "- expected channel:pin";
+            return 1;
+        }
+
+        ReaderRun &run = runs[i];
+        run.name = QString("spi%1").arg(channel);
+        run.thread = new QThread(&app);
+        run.reader = new RFIDReader(channel, pin);
+        run.watchdog = new ReaderWatchdog(run.reader, run.name);
+        run.reader->moveToThread(run.thread);
+        run.watchdog->moveToThread(run.thread);
+        QObject::connect(run.thread, &QThread::finished, run.watchdog, &QObject::deleteLater);
+        QObject::connect(run.thread, &QThread::finished, run.reader, &QObject::deleteLater);
+
+        // Counted on the main thread; the signals arrive queued from the reader thread
+        QObject::connect(run.reader, &RFIDReader::tagDetected, &app, [&run](const QString &) { ++run.tags; });
+        QObject::connect(run.watchdog, &ReaderWatchdog::readerFailed, &app,
+                         [&run](const QString &name, quint32 faults) {
+                             ++run.failures;
+                             qDebug() << name << "failed, faults" << Qt::hex << faults;
+                         });
+        QObject::connect(run.watchdog, &ReaderWatchdog::readerRecovered, &app,
+                         [&run](const QString &name, qint64 downMs) {
+                             ++run.recoveries;
+                             run.downMs += downMs;
+                             qDebug() << name << "recovered after" << downMs << "ms";
+                         });
+
+        run.thread->start();
+        // Initialization, polling and health checks all run on the reader's thread
+        QMetaObject::invokeMethod(run.watchdog, [&run, intervalMs] {
+            run.reader->initialize();
+            run.reader->startPolling();
+            run.watchdog->start(intervalMs);
+        }, Qt::QueuedConnection);
+    }
+
+    QElapsedTimer wall;
+    wall.start();
+    QTimer::singleShot(parser.value("seconds").toInt() * 1000, &app, &QCoreApplication::quit);
+    app.exec();
+
+    for (ReaderRun &run : runs) {
+        run.thread->quit();
+        run.thread->wait();
+    }
+
+    qint64 elapsedMs = wall.elapsed();
+    for (const ReaderRun &run : runs) {
+        qDebug().nospace() << run.name << ": " << run.tags << " tags in " << elapsedMs << " ms, "
+                           << run.failures << " failures, " << run.recoveries << " recoveries, "
+                           << run.downMs << " ms down";
+    }
+    for (const QByteArray &line : MetricsRegistry::instance().prometheusText().split('\n')) {
+        if (line.startsWith("rfid_reader_")) {
+            qDebug().noquote() << line;
+        }
+    }
+    Logger::instance().flush();
+    return 0;
+}
@@ -0,0 +1,33 @@
+# Reader health on the hardware: one thread per RC522 with its watchdog, faults and recoveries.
+# Build with qmake from this directory on the Pi.
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = readerbench
+
+INCLUDEPATH += ../..
+LIBS += -lwiringPi
+
+SOURCES += \
+    main.cpp \
+    ../../latencyhistogram.cpp \
+    ../../logger.cpp \
+    ../../metrics.cpp \
+    ../../piccpolicy.cpp \
+    ../../readertrace.cpp \
+    ../../readerwatchdog.cpp \
+    ../../rfidreader.cpp \
+    ../../spitransport.cpp
+
+HEADERS += \
+    ../../latencyhistogram.h \
+    ../../logger.h \
+    ../../metrics.h \
+    ../../piccpolicy.h \
+    ../../rc522timing.h \
+    ../../readertrace.h \
+    ../../readerwatchdog.h \
+    ../../rfidreader.h \
+    ../../spitransport.h
@@ -0,0 +1,122 @@
+#include "ridecounter.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Charges the card on the antenna again and again the way the turnstile does (select,
+ * authenticate, decrement, transfer, read back, log, halt) and reports taps per second and
+ * per-tap latency. The card is woken with WUPA after each halt instead of being lifted off.
+ *
+ *   tapbench --block 4 --taps 500 --load 100000 --log /tmp/rides.trace
+ *
+ * --load formats the block as a value block holding that many rides before the run; the
+ * sector must still use the transport key FF FF FF FF FF FF unless --key says otherwise.
+ */
+
+static double percentile(const std::vector<qint64> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[index] / 1000.0; // us
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"block", "Value block holding the ride count", "block", "4"});
+    parser.addOption({"taps", "Rides to deduct", "count", "200"});
+    parser.addOption({"load", "Format the block with this many rides first", "rides"});
+    parser.addOption({"key", "Key A of the sector, 12 hex digits", "hex", "FFFFFFFFFFFF"});
+    parser.addOption({"log", "Event log the taps are written to", "path", "/tmp/tapbench.trace"});
+    parser.process(app);
+
+    rfid_byte block = rfid_byte(parser.value("block").toInt());
+    int taps = parser.value("taps").toInt();
+    QByteArray keyBytes = QByteArray::fromHex(parser.value("key").toLatin1());
+    if (keyBytes.size() != MF_KEY_SIZE) {
+        qDebug() << "The key needs 6 bytes";
+        return 1;
+    }
+    MIFARE_Key key;
+    memcpy(key.keybyte, keyBytes.constData(), MF_KEY_SIZE);
+
+    TraceWriter log;
+    if (!log.open(parser.value("log").toLocal8Bit().constData())) {
+        qDebug() << "Cannot open" << parser.value("log");
+        return 1;
+    }
+
+    MFRC522 reader;
+    reader.PCD_Init();
+
+    qDebug() << "Waiting for a card...";
+    rfid_byte atqa[2];
+    rfid_byte atqaSize = sizeof(atqa);
+    while (reader.PICC_RequestA(atqa, &atqaSize) != STATUS_OK || reader.PICC_Select(&reader.uid) != STATUS_OK) {
+        atqaSize = sizeof(atqa);
+        QThread::msleep(100);
+    }
+    if (parser.isSet("load")) {
+        rfid_byte status = reader.PCD_Authenticate(PICC_CMD_MF_AUTH_KEY_A, block, &key, &reader.uid);
+        if (status == STATUS_OK) {
+            status = reader.MIFARE_SetValue(block, parser.value("load").toInt(), block);
+        }
+        if (status != STATUS_OK) {
+            qDebug() << "Could not format block" << block << "status" << status;
+            return 1;
+        }
+    }
+    reader.PICC_HaltA();
+    reader.PCD_StopCrypto1();
+
+    RideCounter counter(&reader, &log, block, key);
+    std::vector<qint64> latencyNs;
+    int failed = 0;
+    int missed = 0;
+    int32_t remaining = 0;
+    QElapsedTimer wall;
+    wall.start();
+    for (int i = 0; i < taps; ++i) {
+        RideTap tap;
+        if (!counter.tap(&tap, true)) {
+            ++missed;
+            continue;
+        }
+        if (tap.status == STATUS_INSUFFICIENT) {
+            qDebug() << "Card is out of rides after" << i << "taps";
+            break;
+        }
+        if (tap.status == STATUS_LOG_FAILED) {
+            qDebug() << "Writing the event log failed after" << i << "taps";
+            break;
+        }
+        if (tap.status != STATUS_OK) {
+            ++failed;
+            continue;
+        }
+        latencyNs.push_back(qint64(tap.elapsedNs));
+        remaining = tap.remaining;
+    }
+    qint64 elapsedMs = wall.elapsed();
+
+    if (latencyNs.empty()) {
+        qDebug() << "No ride was deducted";
+        return 1;
+    }
+    std::sort(latencyNs.begin(), latencyNs.end());
+    qDebug().nospace() << latencyNs.size() << " taps in " << elapsedMs << " ms: "
+                       << latencyNs.size() * 1000.0 / qMax<qint64>(elapsedMs, 1) << " taps/s";
+    qDebug().nospace() << "Tap latency us: p50 " << percentile(latencyNs, 0.50) << ", p99 "
+                       << percentile(latencyNs, 0.99) << ", max " << latencyNs.back() / 1000.0;
+    qDebug() << "Failed:" << failed << "no answer:" << missed << "rides left:" << remaining
+             << "logged:" << log.records();
+    return 0;
+}
@@ -0,0 +1,25 @@
+# Turnstile throughput on the reader hardware: repeated ride deductions on one MIFARE Classic card.
+# Build with qmake from this directory on the Pi.
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = tapbench
+
+INCLUDEPATH += ../..
+LIBS += -lwiringPi
+
+SOURCES += \
+    main.cpp \
+    ../../MFRC522.cpp \
+    ../../piccpolicy.cpp \
+    ../../readertrace.cpp \
+    ../../ridecounter.cpp
+
+HEADERS += \
+    ../../MFRC522.h \
+    ../../piccpolicy.h \
+    ../../rc522timing.h \
+    ../../readertrace.h \
+    ../../ridecounter.h
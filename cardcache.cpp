@@ -0,0 +1,144 @@
+#include "cardcache.h"
+#include "metrics.h"
+#include "readertrace.h"
+#include <cstring>
+#include <iterator>
+
+static const size_t ENTRY_OVERHEAD = 96; // List node, index node, shared buffer control block
+
+bool CardCache::Key::operator==(const Key &other) const {
+    return length == other.length && memcmp(uid, other.uid, length) == 0;
+}
+
+size_t CardCache::KeyHash::operator()(const Key &key) const {
+    return size_t(hashBytes(key.uid, key.length));
+}
+
+CardCache::CardCache(const QString &name, size_t maxBytes)
+    : maxBytes(maxBytes)
+    , usedBytes(0)
+    , hitCount(0)
+    , lookupCount(0)
+    , savedNs(0)
+{
+    MetricsRegistry &metrics = MetricsRegistry::instance();
+    QString label = QString("{reader=\"%1\"}").arg(name);
+    hits = metrics.counter("rfid_card_cache_hits_total" + label, "Card reads answered by a probe and the cache");
+    misses = metrics.counter("rfid_card_cache_misses_total" + label, "Card reads that dumped the card");
+    stale = metrics.counter("rfid_card_cache_stale_total" + label, "Misses on a cached card whose probe changed");
+    evictions = metrics.counter("rfid_card_cache_evictions_total" + label, "Entries dropped to stay within the byte budget");
+    cachedBytes = metrics.gauge("rfid_card_cache_bytes" + label, "Cached card contents including overhead");
+    metrics.addCallback("rfid_card_cache_hit_ratio" + label, "Hits over lookups since start", MetricsRegistry::Gauge,
+                        [this]() {
+                            uint64_t lookups = lookupCount.load(std::memory_order_relaxed);
+                            return lookups ? double(hitCount.load(std::memory_order_relaxed)) / lookups : 0.0;
+                        }, this);
+    metrics.addCallback("rfid_card_cache_rf_saved_seconds_total" + label, "Full-read RF time minus probe time on hits",
+                        MetricsRegistry::Counter, [this]() { return savedNs.load(std::memory_order_relaxed) / 1e9; }, this);
+}
+
+CardCache::~CardCache() {
+    MetricsRegistry::instance().removeOwner(this);
+}
+
+CardCache::Key CardCache::makeKey(const uint8_t *uid, int uidLength) {
+    Key key;
+    memset(&key, 0, sizeof(key));
+    key.length = uint8_t(uidLength < 0 ? 0 : uidLength > 10 ? 10 : uidLength);
+    memcpy(key.uid, uid, key.length);
+    return key;
+}
+
+uint64_t CardCache::hashBytes(const uint8_t *data, size_t length) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t CardCache::entryBytes(const Entry &entry) {
+    return entry.content->size() + ENTRY_OVERHEAD;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> CardCache::fetch(const uint8_t *uid, int uidLength, const CardRead &probe,
+                                                             const CardRead &dump) {
+    Key key = makeKey(uid, uidLength);
+    lookupCount.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<uint8_t> probeBytes;
+    uint64_t probeStart = traceClockNs();
+    if (!probe(&probeBytes)) {
+        return nullptr;
+    }
+    uint64_t probeNs = traceClockNs() - probeStart;
+    uint64_t probeHash = hashBytes(probeBytes.data(), probeBytes.size());
+
+    auto found = index.find(key);
+    if (found != index.end()) {
+        std::list<Entry>::iterator entry = found->second;
+        if (entry->probeHash == probeHash) {
+            lru.splice(lru.begin(), lru, entry);
+            hitCount.fetch_add(1, std::memory_order_relaxed);
+            hits->inc();
+            if (entry->dumpNs > probeNs) {
+                savedNs.fetch_add(entry->dumpNs - probeNs, std::memory_order_relaxed);
+            }
+            return entry->content;
+        }
+        stale->inc();
+        erase(entry);
+    }
+    misses->inc();
+
+    std::vector<uint8_t> *content = new std::vector<uint8_t>;
+    std::shared_ptr<const std::vector<uint8_t>> shared(content);
+    uint64_t dumpStart = traceClockNs();
+    if (!dump(content)) {
+        cachedBytes->set(qint64(usedBytes)); // A stale entry may have been erased above
+        return nullptr;
+    }
+    // The probe was read first, so a write between probe and dump only costs a later miss
+
+    Entry entry;
+    entry.key = key;
+    entry.probeHash = probeHash;
+    entry.dumpNs = traceClockNs() - dumpStart;
+    entry.content = shared;
+    if (entryBytes(entry) <= maxBytes) {
+        lru.push_front(entry);
+        index[key] = lru.begin();
+        usedBytes += entryBytes(entry);
+        evict();
+    }
+    cachedBytes->set(qint64(usedBytes));
+    return shared;
+}
+
+void CardCache::invalidate(const uint8_t *uid, int uidLength) {
+    auto found = index.find(makeKey(uid, uidLength));
+    if (found != index.end()) {
+        erase(found->second);
+        cachedBytes->set(qint64(usedBytes));
+    }
+}
+
+void CardCache::clear() {
+    index.clear();
+    lru.clear();
+    usedBytes = 0;
+    cachedBytes->set(0);
+}
+
+void CardCache::erase(std::list<Entry>::iterator entry) {
+    usedBytes -= entryBytes(*entry);
+    index.erase(entry->key);
+    lru.erase(entry);
+}
+
+void CardCache::evict() {
+    while (usedBytes > maxBytes && !lru.empty()) {
+        erase(std::prev(lru.end()));
+        evictions->inc();
+    }
+}
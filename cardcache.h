@@ -0,0 +1,84 @@
+#ifndef CARDCACHE_H
+#define CARDCACHE_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class MetricCounter;
+class MetricGauge;
+
+/**
+ * Contents of recently read cards, keyed by UID, so a known card costs one probe read instead
+ * of authenticating and dumping every sector again. The probe is whatever changes whenever the
+ * content does: the ride counter's value block, an NTAG's NFC counter, or one block the issuer
+ * rewrites on every update. Only a 64-bit hash of it is kept.
+ *
+ *   auto content = cache.fetch(uid.uidbyte, uid.size,
+ *                              [&](std::vector<uint8_t> *probe) { ...read the probe block... },
+ *                              [&](std::vector<uint8_t> *dump) { ...authenticate, read all sectors... });
+ *
+ * The cache trusts UID plus probe exactly as far as the reader already trusts the UID.
+ * Bounded in bytes (content plus per-entry overhead), least recently used entries go first.
+ * One cache per reader thread: it is not locked.
+ */
+class CardCache {
+public:
+    typedef std::function<bool(std::vector<uint8_t> *)> CardRead; // false when the card did not answer
+
+    CardCache(const QString &name, size_t maxBytes);
+    ~CardCache();
+
+    // The card's content, from the cache when the probe still matches; nullptr if a read failed.
+    // The returned buffer stays valid after the entry is evicted or replaced.
+    std::shared_ptr<const std::vector<uint8_t>> fetch(const uint8_t *uid, int uidLength, const CardRead &probe,
+                                                      const CardRead &dump);
+    void invalidate(const uint8_t *uid, int uidLength); // After this reader wrote to the card
+    void clear();
+
+    size_t bytes() const { return usedBytes; }
+    size_t entries() const { return lru.size(); }
+
+private:
+    struct Key {
+        uint8_t length;
+        uint8_t uid[10];
+        bool operator==(const Key &other) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+    struct Entry {
+        Key key;
+        uint64_t probeHash;
+        uint64_t dumpNs;  // What the full read cost, credited as saved on every hit
+        std::shared_ptr<const std::vector<uint8_t>> content;
+    };
+
+    static Key makeKey(const uint8_t *uid, int uidLength);
+    static uint64_t hashBytes(const uint8_t *data, size_t length); // FNV-1a, for UIDs and probes
+    static size_t entryBytes(const Entry &entry);
+    void erase(std::list<Entry>::iterator entry);
+    void evict();
+
+    size_t maxBytes;
+    size_t usedBytes;
+    std::list<Entry> lru; // Most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+    std::atomic<uint64_t> hitCount;    // Also read by the metrics endpoint
+    std::atomic<uint64_t> lookupCount;
+    std::atomic<uint64_t> savedNs;
+    MetricCounter *hits;
+    MetricCounter *misses;
+    MetricCounter *stale;
+    MetricCounter *evictions;
+    MetricGauge *cachedBytes;
+};
+
+#endif // CARDCACHE_H
@@ -0,0 +1,217 @@
+#include "credentialprovisioner.h"
+#include "accesscontrol.h"
+#include "mqttmanager.h"
+#include "payloadcodec.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+static const char *WORKER_CONNECTION = "provisioning";
+
+/**
+ * Applies every chunk of one changeset inside a single transaction, including the new
+ * provisioning_state row, so the database either has the whole version or none of it.
+ */
+static bool applyChangeset(QSqlDatabase &db, const QMap<quint32, QByteArray> &chunks, int *operations) {
+    if (!db.transaction()) {
+        qDebug() << "Provisioning: unable to start transaction:" << db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery upsert(db);
+    upsert.prepare("INSERT INTO credentials (uid, flags) VALUES (?, ?) "
+                   "ON CONFLICT(uid) DO UPDATE SET flags = excluded.flags");
+    QSqlQuery revoke(db);
+    revoke.prepare("DELETE FROM credentials WHERE uid = ?");
+
+    quint64 changesetId = 0;
+    quint64 version = 0;
+    bool ok = true;
+    for (const QByteArray &payload : chunks) {
+        CredentialChunkReader reader(payload);
+        changesetId = reader.changesetId();
+        version = reader.version();
+        if (reader.chunkIndex() == 0 && reader.replacesAll()) {
+            ok = ok && QSqlQuery(db).exec("DELETE FROM credentials");
+        }
+
+        for (int i = 0; ok && i < reader.count(); ++i) {
+            CredentialOp op = reader.at(i);
+            QByteArray uid(op.uid.data(), op.uid.size());
+            if (op.kind == CredentialOp::Upsert) {
+                upsert.bindValue(0, uid);
+                upsert.bindValue(1, op.flags);
+                ok = upsert.exec();
+            } else {
+                revoke.bindValue(0, uid);
+                ok = revoke.exec();
+            }
+            ++*operations;
+        }
+    }
+
+    QSqlQuery state(db);
+    state.prepare("INSERT OR REPLACE INTO provisioning_state (id, changeset_id, version) VALUES (1, ?, ?)");
+    state.bindValue(0, changesetId);
+    state.bindValue(1, version);
+    ok = ok && state.exec();
+
+    if (!ok || !db.commit()) {
+        qDebug() << "Provisioning: changeset" << changesetId << "rolled back:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+CredentialProvisioner::CredentialProvisioner(AccessControl *access, MqttManager *mqtt, const QString &topic,
+                                             QObject *parent)
+    : QObject(parent)
+    , accessControl(access)
+    , mqttManager(mqtt)
+    , ackTopic(topic)
+    , applied(0)
+    , applying(false)
+    , applyingId(0)
+{
+    worker.setMaxThreadCount(1);
+}
+
+CredentialProvisioner::~CredentialProvisioner() {
+    worker.waitForDone();
+}
+
+void CredentialProvisioner::loadAppliedVersion() {
+    QSqlQuery query("SELECT version FROM provisioning_state WHERE id = 1");
+    if (query.next()) {
+        applied = query.value(0).toULongLong();
+    }
+}
+
+void CredentialProvisioner::handleChunk(const QByteArray &payload) {
+    CredentialChunkReader reader(payload);
+    if (!reader.isValid()) {
+        qDebug() << "Provisioning: ignoring malformed chunk of" << payload.size() << "bytes";
+        return;
+    }
+
+    if (reader.version() <= applied) {
+        acknowledge(reader.changesetId(), applied, "applied"); // Retransmission of something we have
+        return;
+    }
+    if (applying && reader.changesetId() == applyingId) {
+        return; // Late duplicate of the changeset being applied right now
+    }
+
+    if (reader.changesetId() != pending.changesetId) {
+        if (pending.changesetId != 0 && reader.version() < pending.version) {
+            acknowledge(reader.changesetId(), applied, "superseded");
+            return;
+        }
+        // A newer changeset replaces whatever was half assembled
+        pending = Assembly();
+        pending.changesetId = reader.changesetId();
+        pending.version = reader.version();
+        pending.chunkCount = reader.chunkCount();
+    }
+
+    // Every chunk has to describe the same set; otherwise indices 0 and 5 of a "2 chunk" set
+    // would count as complete with chunk 1 missing
+    if (reader.chunkCount() != pending.chunkCount || reader.version() != pending.version
+        || reader.chunkIndex() >= pending.chunkCount) {
+        qDebug() << "Provisioning: dropping changeset" << pending.changesetId << "- chunk" << reader.chunkIndex()
+                 << "of" << reader.chunkCount() << "version" << reader.version() << "does not match"
+                 << pending.chunkCount << "chunks at version" << pending.version;
+        pending = Assembly();
+        return;
+    }
+
+    if (!pending.chunks.contains(reader.chunkIndex())) {
+        pending.chunks.insert(reader.chunkIndex(), payload);
+    }
+
+    if (!applying && static_cast<quint32>(pending.chunks.size()) == pending.chunkCount) {
+        startApply();
+    }
+}
+
+void CredentialProvisioner::startApply() {
+    applying = true;
+    applyingId = pending.changesetId;
+    Assembly work = pending;
+    pending = Assembly();
+    QString path = QSqlDatabase::database().databaseName();
+    quint64 generation = accessControl->generation();
+
+    // The worker has its own connection; with WAL the scan path keeps reading while it writes
+    worker.start([this, work, path, generation]() {
+        QElapsedTimer timer;
+        timer.start();
+        int operations = 0;
+        bool ok = false;
+        std::shared_ptr<const AccessSet> set;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", WORKER_CONNECTION);
+            db.setDatabaseName(path);
+            if (db.open()) {
+                QSqlQuery(db).exec("PRAGMA busy_timeout = 5000");
+                ok = applyChangeset(db, work.chunks, &operations);
+                if (ok) {
+                    set = AccessSet::fromDatabase(db); // Built off the GUI thread as well
+                    ok = set != nullptr;
+                }
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(WORKER_CONNECTION);
+        qint64 durationMs = timer.elapsed();
+
+        QMetaObject::invokeMethod(this, [this, ok, set, work, operations, durationMs, generation]() {
+            if (ok && accessControl->generation() == generation) {
+                accessControl->replaceSet(set);
+            } else if (ok) {
+                // An enroll, revoke or rebuild swapped the set while the worker ran, so this set
+                // may lack it; the database has both, read it again
+                accessControl->rebuildFromDatabase();
+            }
+            finishApply(ok, work.changesetId, work.version, operations, durationMs);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CredentialProvisioner::finishApply(bool ok, quint64 changesetId, quint64 version, int operations,
+                                        qint64 durationMs) {
+    applying = false;
+    applyingId = 0;
+
+    if (ok) {
+        applied = version;
+        qDebug() << "Provisioning: applied changeset" << changesetId << "version" << version << "with"
+                 << operations << "operations in" << durationMs << "ms";
+        acknowledge(changesetId, version, "applied");
+        emit changesetApplied(changesetId, version, operations, durationMs);
+    } else {
+        acknowledge(changesetId, applied, "failed");
+    }
+
+    // A newer changeset may have finished assembling while this one was applied
+    if (pending.chunkCount > 0 && static_cast<quint32>(pending.chunks.size()) == pending.chunkCount) {
+        if (pending.version > applied) {
+            startApply();
+        } else {
+            pending = Assembly();
+        }
+    }
+}
+
+void CredentialProvisioner::acknowledge(quint64 changesetId, quint64 version, const char *status) {
+    QJsonObject ack{{"changeset", static_cast<qint64>(changesetId)},
+                    {"version", static_cast<qint64>(version)},
+                    {"status", status}};
+    mqttManager->publish(ackTopic, QJsonDocument(ack).toJson(QJsonDocument::Compact), 1);
+}
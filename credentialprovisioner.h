@@ -0,0 +1,54 @@
+#ifndef CREDENTIALPROVISIONER_H
+#define CREDENTIALPROVISIONER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QThreadPool>
+
+class AccessControl;
+class MqttManager;
+
+// Receives chunked credential changesets (PayloadType::CredentialChunk) and applies each one in a
+// single SQLite transaction on a worker thread, then swaps the in-memory access set atomically.
+// Duplicate and out-of-order chunks are harmless; already applied versions are just acknowledged.
+class CredentialProvisioner : public QObject
+{
+    Q_OBJECT
+
+public:
+    CredentialProvisioner(AccessControl *accessControl, MqttManager *mqttManager, const QString &ackTopic,
+                          QObject *parent = nullptr);
+    ~CredentialProvisioner();
+
+    void loadAppliedVersion(); // Call once the database is open
+    quint64 appliedVersion() const { return applied; }
+    void handleChunk(const QByteArray &payload);
+
+signals:
+    void changesetApplied(quint64 changesetId, quint64 version, int operations, qint64 durationMs);
+
+private:
+    struct Assembly {
+        quint64 changesetId = 0;
+        quint64 version = 0;
+        quint32 chunkCount = 0;
+        QMap<quint32, QByteArray> chunks; // By index, ordered for applying
+    };
+
+    void startApply();
+    void finishApply(bool ok, quint64 changesetId, quint64 version, int operations, qint64 durationMs);
+    void acknowledge(quint64 changesetId, quint64 version, const char *status);
+
+    AccessControl *accessControl;
+    MqttManager *mqttManager;
+    QString ackTopic;
+    Assembly pending;
+    quint64 applied;
+    bool applying;
+    quint64 applyingId; // Changeset on the worker, its late duplicate chunks are ignored
+    QThreadPool worker; // Waited for on destruction, the job posts back to this object
+};
+
+#endif // CREDENTIALPROVISIONER_H
@@ -0,0 +1,119 @@
+#include "doorcontroller.h"
+#include "appoptions.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Sends a state line to systemd when started as a Type=notify service. Does nothing without
+ * NOTIFY_SOCKET, so the daemon also runs fine from a shell.
+ */
+static void notifySystemd(const char *state) {
+    QByteArray socketPath = qgetenv("NOTIFY_SOCKET");
+    if (socketPath.isEmpty() || socketPath.size() >= static_cast<int>(sizeof(sockaddr_un::sun_path))) {
+        return;
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath.constData(), socketPath.size());
+    if (address.sun_path[0] == '@') {
+        address.sun_path[0] = '\0'; // Abstract namespace
+    }
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return;
+    }
+    socklen_t length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + socketPath.size());
+    sendto(fd, state, std::strlen(state), MSG_NOSIGNAL, reinterpret_cast<sockaddr *>(&address), length);
+    close(fd);
+}
+
+// SIGTERM/SIGINT are turned into a write on a socket pair so the quit happens in the event loop
+static int signalFds[2];
+
+static void handleSignal(int) {
+    char byte = 1;
+    ssize_t written = ::write(signalFds[0], &byte, 1);
+    Q_UNUSED(written);
+}
+
+int main(int argc, char *argv[])
+{
+    QElapsedTimer startup;
+    startup.start();
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    AppOptions options(parser);
+    parser.process(a);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, signalFds) == 0) {
+        QSocketNotifier *notifier = new QSocketNotifier(signalFds[1], QSocketNotifier::Read, &a);
+        QObject::connect(notifier, &QSocketNotifier::activated, &a, [notifier]() {
+            char byte;
+            ssize_t received = ::read(signalFds[1], &byte, 1);
+            Q_UNUSED(received);
+            notifier->setEnabled(false);
+            notifySystemd("STOPPING=1");
+            QCoreApplication::quit();
+        });
+        std::signal(SIGTERM, handleSignal);
+        std::signal(SIGINT, handleSignal);
+    }
+
+    // Ping the systemd watchdog at half its period while the event loop is alive
+    qint64 watchdogUsec = qgetenv("WATCHDOG_USEC").toLongLong();
+    QTimer watchdog;
+    if (watchdogUsec > 0) {
+        QObject::connect(&watchdog, &QTimer::timeout, []() { notifySystemd("WATCHDOG=1"); });
+        watchdog.start(static_cast<int>(watchdogUsec / 2000));
+    }
+
+    if (options.aggregate()) {
+        return options.runAggregator([&startup]() {
+            DoorController::reportStartup("aggregator", startup.elapsed());
+            notifySystemd("READY=1");
+        });
+    }
+
+    DoorController controller;
+    options.configureController(&controller);
+    QObject::connect(&controller, &DoorController::databaseOpened, &controller, [&](bool ok) {
+        if (!ok) {
+            qDebug() << "Continuing on the access snapshot without a database";
+        } else if (options.backups()) {
+            controller.enableBackups(options.backupDirectory(), options.backupIntervalMinutes(),
+                                     options.compressBackups());
+        }
+    });
+    if (!options.startReplay(&controller)) {
+        return 1;
+    }
+    if (options.replaying()) {
+        // A replay is a benchmark run: stop once the trace is done so runs can be scripted
+        QObject::connect(&controller, &DoorController::replayFinished, &a, &QCoreApplication::quit,
+                         Qt::QueuedConnection);
+    }
+    // Ready once every startup phase has run; the broker may still be connecting
+    QObject::connect(&controller, &DoorController::startupFinished, &a, [&startup]() {
+        DoorController::reportStartup("headless", startup.elapsed());
+        notifySystemd("READY=1");
+    });
+    controller.start(options.databaseProfile(), startup);
+    return a.exec();
+}
@@ -0,0 +1,65 @@
+# Headless door controller: same scan engine, database and MQTT as the GUI build, on a
+# QCoreApplication and without linking QtGui or QtWidgets.
+QT       = core sql mqtt network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = rfid-daemon
+LIBS += -lsqlite3 # online backup API, must match the SQLite the QSQLITE driver uses
+LIBS += -lrt # shm_open for the scan rings
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    main.cpp \
+    ../accesscontrol.cpp \
+    ../appoptions.cpp \
+    ../credentialprovisioner.cpp \
+    ../databasebackup.cpp \
+    ../databasemanager.cpp \
+    ../doorcontroller.cpp \
+    ../latencyhistogram.cpp \
+    ../logger.cpp \
+    ../metrics.cpp \
+    ../metricsserver.cpp \
+    ../mqttmanager.cpp \
+    ../payloadcodec.cpp \
+    ../readertrace.cpp \
+    ../scanaggregator.cpp \
+    ../scaningestwriter.cpp \
+    ../scanpublisher.cpp \
+    ../scanring.cpp \
+    ../scanringreceiver.cpp \
+    ../scantracer.cpp \
+    ../segmentlog.cpp \
+    ../startuporchestrator.cpp \
+    ../topicrouter.cpp \
+    ../uidfilter.cpp
+
+HEADERS += \
+    ../accesscontrol.h \
+    ../appoptions.h \
+    ../credentialprovisioner.h \
+    ../databasebackup.h \
+    ../databasemanager.h \
+    ../doorcontroller.h \
+    ../latencyhistogram.h \
+    ../logger.h \
+    ../metrics.h \
+    ../metricsserver.h \
+    ../mqttmanager.h \
+    ../payloadcodec.h \
+    ../readertrace.h \
+    ../scanaggregator.h \
+    ../scaningestwriter.h \
+    ../scanpublisher.h \
+    ../scanring.h \
+    ../scanringreceiver.h \
+    ../scantracer.h \
+    ../segmentlog.h \
+    ../startuporchestrator.h \
+    ../topicrouter.h \
+    ../uidfilter.h
+
+target.path = /opt/rfid-daemon/bin
+!isEmpty(target.path): INSTALLS += target
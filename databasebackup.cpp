@@ -0,0 +1,196 @@
+#include "databasebackup.h"
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QThread>
+#include <QtEndian>
+#include <QDebug>
+#include <sqlite3.h>
+
+DatabaseBackup::DatabaseBackup(QSqlDatabase database, QObject *parent)
+    : QObject(parent)
+    , sourcePath(database.databaseName())
+    , scheduleTimer(new QTimer(this))
+    , pagesPerStep(64)
+    , stepIntervalMs(10)
+    , compress(false)
+    , running(false)
+{
+    worker.setMaxThreadCount(1);
+    connect(scheduleTimer, &QTimer::timeout, this, &DatabaseBackup::startScheduled);
+}
+
+DatabaseBackup::~DatabaseBackup() {
+    worker.waitForDone(); // The job posts back to this object
+}
+
+bool DatabaseBackup::start(const QString &path) {
+    if (running) {
+        qDebug() << "Backup already running, skipping" << path;
+        return false;
+    }
+    if (sourcePath.isEmpty() || sourcePath == ":memory:") {
+        qDebug() << "Backup needs a file-backed database.";
+        return false;
+    }
+
+    running = true;
+    emit started(path);
+
+    QString source = sourcePath;
+    bool packed = compress;
+    int pages = pagesPerStep;
+    int intervalMs = stepIntervalMs;
+    worker.start([this, source, path, packed, pages, intervalMs]() {
+        QElapsedTimer duration;
+        duration.start();
+
+        QString result = path;
+        bool ok = copyPages(source, path, pages, intervalMs);
+        if (ok && packed) {
+            ok = compressCopy(path, path + ".qz");
+            if (ok) {
+                QFile::remove(path);
+                result = path + ".qz";
+            }
+        }
+
+        qint64 elapsed = duration.elapsed();
+        QMetaObject::invokeMethod(this, [this, ok, result, elapsed]() { complete(ok, result, elapsed); },
+                                  Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void DatabaseBackup::complete(bool ok, const QString &path, qint64 durationMs) {
+    running = false;
+    qDebug() << "Backup to" << path << (ok ? "completed" : "failed") << "in" << durationMs << "ms";
+    emit finished(ok, path, durationMs);
+}
+
+// Runs on the worker. Each step holds the source read lock for `pages` pages only, then sleeps
+// so writers get the database; under the DELETE journal they would otherwise wait for the whole
+// copy. Writes that land between steps are folded into the backup by SQLite itself.
+bool DatabaseBackup::copyPages(const QString &sourcePath, const QString &destinationPath, int pages, int intervalMs) {
+    static QAtomicInt serial;
+    const QString connectionName = QString("backup-%1").arg(serial.fetchAndAddRelaxed(1));
+
+    bool ok = false;
+    {
+        // A connection of our own: QSqlDatabase handles are not shareable across threads
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(sourcePath);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        // The driver hands out its sqlite3* handle; this requires Qt built against the same
+        // (system) SQLite library the app links with, as the distribution packages are
+        QVariant handle = db.open() ? db.driver()->handle() : QVariant();
+        sqlite3 *source = handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0
+            ? *static_cast<sqlite3 **>(handle.data()) : nullptr;
+        sqlite3 *destination = nullptr;
+        if (!source) {
+            qDebug() << "Backup could not open" << sourcePath << db.lastError().text();
+        } else {
+            QFile::remove(destinationPath);
+            if (sqlite3_open_v2(destinationPath.toUtf8().constData(), &destination,
+                                SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+                qDebug() << "Unable to create backup file" << destinationPath << sqlite3_errmsg(destination);
+            } else if (sqlite3_backup *backup = sqlite3_backup_init(destination, "main", source, "main")) {
+                int rc;
+                do {
+                    rc = sqlite3_backup_step(backup, pages);
+                    int total = sqlite3_backup_pagecount(backup);
+                    int copied = total - sqlite3_backup_remaining(backup);
+                    QMetaObject::invokeMethod(this, [this, copied, total]() { emit progress(copied, total); },
+                                              Qt::QueuedConnection);
+                    if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+                        QThread::msleep(intervalMs);
+                    }
+                } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+                if (rc != SQLITE_DONE) {
+                    qDebug() << "Backup step failed:" << sqlite3_errstr(rc);
+                }
+                ok = sqlite3_backup_finish(backup) == SQLITE_OK && rc == SQLITE_DONE;
+            } else {
+                qDebug() << "Unable to start backup:" << sqlite3_errmsg(destination);
+            }
+            sqlite3_close(destination);
+            if (!ok) {
+                QFile::remove(destinationPath);
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return ok;
+}
+
+// Streams the copy as a sequence of [quint32 big-endian frame size][qCompress frame] so the
+// worker never holds more than one chunk of the database in memory
+bool DatabaseBackup::compressCopy(const QString &plainPath, const QString &packedPath) {
+    QFile plain(plainPath);
+    if (!plain.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QSaveFile packed(packedPath);
+    if (!packed.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    while (!plain.atEnd()) {
+        QByteArray chunk = plain.read(COMPRESS_CHUNK_BYTES);
+        if (chunk.isEmpty()) {
+            return false; // Read error; QSaveFile discards the partial file
+        }
+        QByteArray frame = qCompress(chunk, 6);
+        uchar size[4];
+        qToBigEndian<quint32>(quint32(frame.size()), size);
+        if (packed.write(reinterpret_cast<const char *>(size), 4) != 4 || packed.write(frame) != frame.size()) {
+            return false;
+        }
+    }
+    return packed.commit();
+}
+
+bool DatabaseBackup::uncompressCopy(const QString &packedPath, const QString &plainPath) {
+    QFile packed(packedPath);
+    if (!packed.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QSaveFile plain(plainPath);
+    if (!plain.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    while (!packed.atEnd()) {
+        QByteArray size = packed.read(4);
+        if (size.size() != 4) {
+            return false;
+        }
+        quint32 frameSize = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(size.constData()));
+        QByteArray frame = packed.read(frameSize);
+        if (quint32(frame.size()) != frameSize) {
+            return false;
+        }
+        QByteArray chunk = qUncompress(frame);
+        if (chunk.isEmpty() || plain.write(chunk) != chunk.size()) {
+            return false;
+        }
+    }
+    return plain.commit();
+}
+
+void DatabaseBackup::schedule(const QString &directory, int intervalMs) {
+    scheduleDirectory = directory;
+    QDir().mkpath(directory);
+    scheduleTimer->start(intervalMs);
+}
+
+void DatabaseBackup::startScheduled() {
+    QString name = QDateTime::currentDateTime().toString("'test-'yyyyMMdd-HHmmss'.db'");
+    start(QDir(scheduleDirectory).filePath(name));
+}
@@ -0,0 +1,57 @@
+#ifndef DATABASEBACKUP_H
+#define DATABASEBACKUP_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+// Copies the live database with the SQLite online-backup API on a worker thread, a few pages
+// per step through its own QSQLITE connection, so scans keep writing between steps and the
+// GUI thread never waits on the copy
+class DatabaseBackup : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseBackup(QSqlDatabase db, QObject *parent = nullptr);
+    ~DatabaseBackup();
+
+    void setPagesPerStep(int pages) { pagesPerStep = pages; }
+    void setStepInterval(int ms) { stepIntervalMs = ms; }
+    void setCompress(bool enabled) { compress = enabled; } // Replaces the .db with a chunked .qz
+
+    bool start(const QString &destination);
+    void schedule(const QString &directory, int intervalMs); // Timestamped backups into directory
+    bool isRunning() const { return running; }
+
+    // Expands a .qz written by setCompress(true) back into a plain database file
+    static bool uncompressCopy(const QString &packedPath, const QString &plainPath);
+
+signals:
+    void started(const QString &path);
+    void progress(int copiedPages, int totalPages);
+    void finished(bool ok, const QString &path, qint64 durationMs);
+
+private slots:
+    void startScheduled();
+
+private:
+    bool copyPages(const QString &sourcePath, const QString &destinationPath, int pages, int intervalMs);
+    static bool compressCopy(const QString &plainPath, const QString &packedPath);
+    void complete(bool ok, const QString &path, qint64 durationMs);
+
+    QString sourcePath;
+    QString scheduleDirectory;
+    QTimer *scheduleTimer;
+    QThreadPool worker;
+    int pagesPerStep;
+    int stepIntervalMs;
+    bool compress;
+    bool running;
+
+    static constexpr qint64 COMPRESS_CHUNK_BYTES = 1024 * 1024;
+};
+
+#endif // DATABASEBACKUP_H
@@ -0,0 +1,282 @@
+#include "databasemanager.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Schema migrations, in order. Entry N brings the schema from user_version N to N + 1.
+ * Only ever append to this list; never edit a migration that has shipped.
+ */
+static const QList<QStringList> &migrations() {
+    static const QList<QStringList> steps = {
+        // 1: original people table (IF NOT EXISTS so pre-versioned databases adopt cleanly)
+        {
+            "CREATE TABLE IF NOT EXISTS people ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "name TEXT, "
+            "age INTEGER)"
+        },
+        // 2: enrolled cards, keyed by raw UID bytes (4, 7 or 10)
+        {
+            "CREATE TABLE credentials ("
+            "uid BLOB PRIMARY KEY NOT NULL, "
+            "person_id INTEGER REFERENCES people(id) ON DELETE CASCADE, "
+            "flags INTEGER NOT NULL DEFAULT 1) WITHOUT ROWID"
+        },
+        // 3: change log on people so MQTT publishing can send deltas instead of full tables
+        {
+            "CREATE TABLE people_changes ("
+            "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "person_id INTEGER NOT NULL, "
+            "deleted INTEGER NOT NULL DEFAULT 0)",
+            "CREATE TRIGGER people_changes_insert AFTER INSERT ON people BEGIN "
+            "INSERT INTO people_changes (person_id) VALUES (NEW.id); END",
+            "CREATE TRIGGER people_changes_update AFTER UPDATE ON people BEGIN "
+            "INSERT INTO people_changes (person_id) VALUES (NEW.id); END",
+            "CREATE TRIGGER people_changes_delete AFTER DELETE ON people BEGIN "
+            "INSERT INTO people_changes (person_id, deleted) VALUES (OLD.id, 1); END"
+        },
+        // 4: version of the last credential changeset applied through provisioning
+        {
+            "CREATE TABLE provisioning_state ("
+            "id INTEGER PRIMARY KEY CHECK (id = 1), "
+            "changeset_id INTEGER NOT NULL, "
+            "version INTEGER NOT NULL)"
+        },
+        // 5: scan events collected from the fleet in aggregator mode
+        {
+            "CREATE TABLE scan_events ("
+            "reader TEXT NOT NULL, "
+            "seq INTEGER NOT NULL, "
+            "ts INTEGER NOT NULL, "
+            "uid BLOB NOT NULL, "
+            "granted INTEGER NOT NULL, "
+            "received INTEGER NOT NULL)",
+            "CREATE INDEX scan_events_reader_ts ON scan_events(reader, ts)"
+        },
+    };
+    return steps;
+}
+
+DatabaseProfile DatabaseProfile::byName(const QString &name) {
+    if (name == "ssd-server") {
+        // Plenty of RAM and fast random I/O: big cache, map the whole file
+        return {"ssd-server", 65536, 268435456, "WAL", "NORMAL", "MEMORY", 4000, 10 * 60 * 1000};
+    }
+    if (name == "sqlite-default") {
+        // Leave every pragma as SQLite ships it, useful as a benchmark baseline
+        return {"sqlite-default", 0, 0, QString(), QString(), QString(), 0, 0};
+    }
+    // sd-card-edge: small cache, WAL to turn random writes into appends, fewer fsyncs
+    return {"sd-card-edge", 2048, 16777216, "WAL", "NORMAL", "MEMORY", 1000, 60 * 60 * 1000};
+}
+
+QStringList DatabaseProfile::names() {
+    return {"sd-card-edge", "ssd-server", "sqlite-default"};
+}
+
+DatabaseManager::DatabaseManager(QObject *parent)
+    : QObject(parent)
+    , optimizeTimer(new QTimer(this))
+    , readyMs(-1)
+{
+    connect(optimizeTimer, &QTimer::timeout, this, &DatabaseManager::runOptimize);
+}
+
+DatabaseManager::~DatabaseManager() {
+    close();
+}
+
+bool DatabaseManager::open(const QString &path, const DatabaseProfile &dbProfile, const QString &connectionName) {
+    QElapsedTimer timer;
+    timer.start();
+
+    profile = dbProfile;
+    db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(path);
+
+    if (!db.open()) {
+        qDebug() << "Error: Unable to open SQLite database." << db.lastError().text();
+        return false;
+    }
+
+    if (!applyProfile() || !migrate()) {
+        return false;
+    }
+
+    if (profile.optimizeIntervalMs > 0) {
+        optimizeTimer->start(profile.optimizeIntervalMs);
+    }
+
+    readyMs = timer.elapsed();
+    qDebug() << "Database ready in" << readyMs << "ms with profile" << profile.name
+             << "schema version" << schemaVersion();
+    return true;
+}
+
+bool DatabaseManager::prepareSchema(const QString &path, const DatabaseProfile &profile) {
+    static const QString connectionName = "schema-prepare";
+    bool ok;
+    {
+        DatabaseProfile once = profile;
+        once.optimizeIntervalMs = 0; // This connection closes right away
+        DatabaseManager manager;
+        ok = manager.open(path, once, connectionName);
+    } // The manager closes the connection; it must be gone before it is removed
+    QSqlDatabase::removeDatabase(connectionName);
+    return ok;
+}
+
+void DatabaseManager::close() {
+    optimizeTimer->stop();
+    if (db.isOpen()) {
+        exec("PRAGMA optimize"); // Cheap when nothing changed, recommended before closing
+        db.close();
+    }
+}
+
+bool DatabaseManager::exec(const QString &statement) {
+    QSqlQuery query(db);
+    if (!query.exec(statement)) {
+        qDebug() << "SQL failed:" << statement << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::applyProfile() {
+    // journal_mode must be set outside of any transaction, so pragmas go before migrations
+    if (!profile.journalMode.isEmpty() && !exec("PRAGMA journal_mode = " + profile.journalMode)) {
+        return false;
+    }
+    if (!profile.synchronous.isEmpty()) {
+        exec("PRAGMA synchronous = " + profile.synchronous);
+    }
+    if (!profile.tempStore.isEmpty()) {
+        exec("PRAGMA temp_store = " + profile.tempStore);
+    }
+    if (profile.cacheSizeKiB > 0) {
+        exec(QString("PRAGMA cache_size = -%1").arg(profile.cacheSizeKiB)); // Negative means KiB, not pages
+    }
+    if (profile.mmapSize > 0) {
+        exec(QString("PRAGMA mmap_size = %1").arg(profile.mmapSize));
+    }
+    if (profile.walAutoCheckpoint > 0) {
+        exec(QString("PRAGMA wal_autocheckpoint = %1").arg(profile.walAutoCheckpoint));
+    }
+    if (profile.optimizeIntervalMs > 0) {
+        exec("PRAGMA analysis_limit = 400"); // Keeps the automatic ANALYZE bounded on large tables
+    }
+    return true;
+}
+
+int DatabaseManager::schemaVersion() const {
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA user_version") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return -1;
+}
+
+int DatabaseManager::latestSchemaVersion() {
+    return migrations().size();
+}
+
+bool DatabaseManager::migrate() {
+    int current = schemaVersion();
+    int latest = latestSchemaVersion();
+    if (current == latest) {
+        return true; // Schema is current, nothing to do
+    }
+    if (current < 0 || current > latest) {
+        qDebug() << "Unsupported schema version" << current << "(this build knows up to" << latest << ")";
+        return false;
+    }
+
+    if (!db.transaction()) {
+        qDebug() << "Unable to start migration transaction:" << db.lastError().text();
+        return false;
+    }
+
+    for (int version = current; version < latest; ++version) {
+        for (const QString &statement : migrations().at(version)) {
+            if (!exec(statement)) {
+                db.rollback();
+                qDebug() << "Migration to schema version" << version + 1 << "failed, rolled back.";
+                return false;
+            }
+        }
+    }
+
+    // user_version is written inside the same transaction so a crash never leaves a half-applied step
+    if (!exec(QString("PRAGMA user_version = %1").arg(latest)) || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+
+    qDebug() << "Migrated schema from version" << current << "to" << latest;
+    return true;
+}
+
+void DatabaseManager::runOptimize() {
+    QElapsedTimer timer;
+    timer.start();
+    exec("PRAGMA optimize");
+    emit optimized(timer.elapsed());
+}
+
+static qint64 percentile(std::vector<qint64> &samples, double p) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+void DatabaseManager::benchmarkQueries(int iterations) {
+    struct Probe {
+        const char *label;
+        const char *sql;
+        bool bindId;
+    };
+    const Probe probes[] = {
+        {"point lookup", "SELECT name, age FROM people WHERE id = :id", true},
+        {"count", "SELECT COUNT(*) FROM people", false},
+        {"full scan", "SELECT name, age FROM people", false},
+    };
+
+    int rowCount = 0;
+    QSqlQuery countQuery("SELECT MAX(id) FROM people", db);
+    if (countQuery.next()) {
+        rowCount = countQuery.value(0).toInt();
+    }
+
+    for (const Probe &probe : probes) {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare(probe.sql);
+
+        std::vector<qint64> samples;
+        samples.reserve(iterations);
+        QElapsedTimer timer;
+        for (int i = 0; i < iterations; ++i) {
+            if (probe.bindId) {
+                query.bindValue(":id", rowCount > 0 ? (i % rowCount) + 1 : 1);
+            }
+            timer.start();
+            query.exec();
+            while (query.next()) {
+            }
+            samples.push_back(timer.nsecsElapsed());
+        }
+
+        qDebug().noquote() << QString("[%1] %2: p50 %3 us, p99 %4 us")
+                                  .arg(profile.name, probe.label)
+                                  .arg(percentile(samples, 0.50) / 1000.0, 0, 'f', 1)
+                                  .arg(percentile(samples, 0.99) / 1000.0, 0, 'f', 1);
+    }
+}
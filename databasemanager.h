@@ -0,0 +1,65 @@
+#ifndef DATABASEMANAGER_H
+#define DATABASEMANAGER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QTimer>
+
+// Named set of SQLite tuning pragmas applied every time the database is opened
+struct DatabaseProfile {
+    QString name;
+    int cacheSizeKiB;        // PRAGMA cache_size (page cache budget in KiB)
+    qint64 mmapSize;         // PRAGMA mmap_size in bytes, 0 disables memory-mapped I/O
+    QString journalMode;     // PRAGMA journal_mode
+    QString synchronous;     // PRAGMA synchronous
+    QString tempStore;       // PRAGMA temp_store
+    int walAutoCheckpoint;   // PRAGMA wal_autocheckpoint in pages
+    int optimizeIntervalMs;  // How often PRAGMA optimize runs, 0 disables the schedule
+
+    static DatabaseProfile byName(const QString &name); // Unknown names fall back to "sd-card-edge"
+    static QStringList names();
+};
+
+class DatabaseManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseManager(QObject *parent = nullptr);
+    ~DatabaseManager();
+
+    // Opens, tunes and migrates a connection (the default one unless named)
+    bool open(const QString &path, const DatabaseProfile &profile,
+              const QString &connectionName = QLatin1String(QSqlDatabase::defaultConnection));
+    // Runs the persistent pragmas and migrations on a private connection from any thread, so the
+    // open() on the GUI thread that follows finds the schema current and returns quickly
+    static bool prepareSchema(const QString &path, const DatabaseProfile &profile);
+    void close();
+    QSqlDatabase database() const { return db; }
+    const DatabaseProfile &currentProfile() const { return profile; }
+
+    int schemaVersion() const;              // Current PRAGMA user_version
+    static int latestSchemaVersion();       // Version the migration list brings the schema to
+    qint64 openToReadyMs() const { return readyMs; }
+
+    void benchmarkQueries(int iterations = 1000); // Logs latency percentiles of the common queries
+
+signals:
+    void optimized(qint64 elapsedMs);
+
+private slots:
+    void runOptimize();
+
+private:
+    bool applyProfile();
+    bool migrate();
+    bool exec(const QString &statement);
+
+    QSqlDatabase db;
+    DatabaseProfile profile;
+    QTimer *optimizeTimer;
+    qint64 readyMs;
+};
+
+#endif // DATABASEMANAGER_H
@@ -0,0 +1,622 @@
+#include "doorcontroller.h"
+#include "metrics.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTimer>
+#include <QDebug>
+#include <cstring>
+
+// Every tick queries SQLite and may publish; faster than this only loads the database and the broker
+static const int MIN_PUBLISH_INTERVAL_MS = 1000;
+
+static int hexDigit(char16_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+        return (c | 0x20) - 'a' + 10;
+    }
+    return -1;
+}
+
+// Hex digits to UID bytes without the temporaries of QByteArray::fromHex; stops at a non-hex pair
+static quint8 decodeUidHex(QStringView hex, quint8 *out, int capacity) {
+    quint8 length = 0;
+    for (qsizetype i = 0; i + 1 < hex.size() && length < capacity; i += 2) {
+        int high = hexDigit(hex[i].unicode());
+        int low = hexDigit(hex[i + 1].unicode());
+        if (high < 0 || low < 0) {
+            break;
+        }
+        out[length++] = static_cast<quint8>(high << 4 | low);
+    }
+    return length;
+}
+
+DoorController::DoorController(QObject *parent)
+    : QObject(parent)
+    , mqttManager(new MqttManager("", 1883, this))
+    , databaseManager(new DatabaseManager(this))
+    , accessControl(new AccessControl("access.snap", this))
+    , databaseBackup(nullptr)
+    , scanPublisher(new ScanPublisher(mqttManager, "spool", this))
+    , provisioner(new CredentialProvisioner(accessControl, mqttManager,
+                                            QString("rfid/%1/provision/ack").arg(QSysInfo::machineHostName()), this))
+    , scanLog(nullptr)
+    , scanDatabasePath("test.db")
+    , scanTopic(QString("site/%1/scans").arg(QSysInfo::machineHostName()))
+    , scanSequence(0)
+    , scanSession(static_cast<quint16>(QRandomGenerator::global()->bounded(1, 0x10000)))
+    , rfidProcess(new QProcess(this))
+    , scannerKillTimer(new QTimer(this))
+    , scannerStopping(false)
+    , scannerRestartPending(false)
+    , scanRings(nullptr)
+    , lastUidNs(0)
+    , repeatWindowNs(1000000000)
+    , metricsServer(nullptr)
+    , metricsTimer(nullptr)
+    , replayPending(false)
+    , replayTimer(nullptr)
+    , startup(nullptr)
+    , started(false)
+    , replayed(0)
+{
+    accessControl->loadSnapshot(); // Lets the door decide before SQLite has finished opening
+
+    // Scan events go through the store-and-forward publisher so nothing is lost while offline
+    connect(mqttManager->getClient(), &QMqttClient::messageSent, scanPublisher, &ScanPublisher::acknowledge);
+    connect(mqttManager->getClient(), &QMqttClient::stateChanged, scanPublisher, [this](QMqttClient::ClientState state) {
+        scanPublisher->connectionChanged(state == QMqttClient::Connected);
+    });
+
+    connect(scanPublisher, &ScanPublisher::delivered, this, [this](quint32 sequence) {
+        tracer.mark(sequence, ScanTracer::Published);
+    });
+
+    connect(rfidProcess, &QProcess::readyReadStandardOutput, this, &DoorController::handleScannerOutput);
+    connect(rfidProcess, &QProcess::readyReadStandardError, this, &DoorController::handleScannerError);
+    connect(rfidProcess, &QProcess::finished, this, &DoorController::handleScannerFinished);
+    scannerKillTimer->setSingleShot(true);
+    scannerKillTimer->setInterval(3000);
+    connect(scannerKillTimer, &QTimer::timeout, this, [this]() {
+        if (rfidProcess->state() != QProcess::NotRunning) {
+            qDebug() << "RFID process ignored terminate, killing it";
+            rfidProcess->kill();
+        }
+    });
+    connect(rfidProcess, &QProcess::started, this, [this]() {
+        qDebug() << "RFID scanning process started successfully.";
+        if (startup) {
+            startup->milestone("scanner-started");
+        }
+    });
+    connect(rfidProcess, &QProcess::errorOccurred, this, [](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            qDebug() << "Failed to start RFID scanning process.";
+        }
+    });
+}
+
+DoorController::~DoorController() {
+    MetricsRegistry::instance().removeOwner(this);
+    // Shutting down, so blocking is fine here; no restart from the finished handler
+    rfidProcess->disconnect(this);
+    if (rfidProcess->state() != QProcess::NotRunning) {
+        rfidProcess->terminate();
+        if (!rfidProcess->waitForFinished(3000)) {
+            rfidProcess->kill();
+            rfidProcess->waitForFinished(1000);
+        }
+    }
+    if (scanLog) {
+        // The commit observer uses the tracer, which is gone before QObject deletes children
+        scanLog->stop();
+        scanLog->wait();
+    }
+}
+
+bool DoorController::openDatabase(const QString &profileName) {
+    // Opens test.db, applies the tuning profile and brings the schema up to date
+    if (!databaseManager->open("test.db", DatabaseProfile::byName(profileName))) {
+        return false;
+    }
+    qDebug() << "Successfully connected to the SQLite database!";
+    provisioner->loadAppliedVersion();
+    databaseProfileName = profileName;
+    startScanLog(profileName);
+
+    // Refresh the access set from the credentials table once the event loop runs
+    QTimer::singleShot(0, accessControl, &AccessControl::rebuildFromDatabase);
+    accessControl->startPeriodicExport();
+    return true;
+}
+
+DatabaseBackup *DoorController::enableBackups(const QString &directory, int intervalMinutes, bool compress) {
+    if (!databaseManager->database().isOpen()) {
+        qDebug() << "Backups not scheduled: database is not open.";
+        return nullptr;
+    }
+    databaseBackup = new DatabaseBackup(databaseManager->database(), this);
+    databaseBackup->setCompress(compress);
+    databaseBackup->schedule(directory, intervalMinutes * 60 * 1000);
+    return databaseBackup;
+}
+
+void DoorController::start(const QString &profileName, const QElapsedTimer &sinceLaunch) {
+    started = true;
+    startup = new StartupOrchestrator(sinceLaunch, this);
+    using Where = StartupOrchestrator::Where;
+
+    // Connecting is asynchronous; the phase only arms it, the milestone marks the CONNACK
+    startup->addPhase("broker", {}, Where::MainThread, [this]() {
+        registerCommandRoutes();
+        connect(mqttManager->getClient(), &QMqttClient::connected, startup,
+                [this]() { startup->milestone("broker-connected"); }, Qt::SingleShotConnection);
+        mqttManager->connectToBroker();
+        return true;
+    });
+
+    // Migrations and journal setup are the slow part of opening and need no GUI-thread state
+    DatabaseProfile profile = DatabaseProfile::byName(profileName);
+    startup->addPhase("schema", {}, Where::WorkerThread, [profile]() {
+        return DatabaseManager::prepareSchema("test.db", profile);
+    });
+    startup->addPhase("database", {"schema"}, Where::MainThread, [this, profileName]() {
+        return openDatabase(profileName);
+    });
+
+    // Access decisions work from the snapshot meanwhile, so the scanner does not wait for SQLite
+    startup->addPhase("scanner", {}, Where::MainThread, [this]() {
+        if (replayTimer) {
+            replayClock.start();
+            replayTimer->start(0);
+        } else {
+            startScanner();
+        }
+        return true;
+    });
+
+    connect(startup, &StartupOrchestrator::phaseFinished, this, [this](const QString &name, bool ok) {
+        if (name == "database") {
+            emit databaseOpened(ok);
+        }
+    });
+    connect(startup, &StartupOrchestrator::finished, this, &DoorController::startupFinished);
+    startup->start();
+}
+
+void DoorController::startScanLog(const QString &profileName) {
+    if (scanLog) {
+        scanLog->stop();
+        scanLog->wait();
+        delete scanLog;
+        scanLog = nullptr;
+    }
+    // A replay database is a scratch file; it only needs the schema for scan_events
+    if (scanDatabasePath != "test.db"
+        && !DatabaseManager::prepareSchema(scanDatabasePath, DatabaseProfile::byName(profileName))) {
+        qDebug() << "Scan events not stored: cannot prepare" << scanDatabasePath;
+        return;
+    }
+
+    // Every decision is also kept in scan_events; the observer closes the trace's commit stage
+    scanLog = new ScanIngestWriter(scanDatabasePath, this);
+    scanLog->setCommitObserver([this](const std::vector<ScanBatch> &batches) {
+        qint64 now = ScanTracer::nowNs();
+        for (const ScanBatch &batch : batches) {
+            for (const ScanEvent &event : batch.events) {
+                tracer.mark(event.sequence, ScanTracer::Committed, now);
+            }
+        }
+    });
+    scanLog->start();
+}
+
+bool DoorController::startCapture(const QString &path) {
+    if (!capture.open(QFile::encodeName(path).constData())) {
+        qDebug() << "Cannot write reader trace" << path;
+        return false;
+    }
+    qDebug() << "Capturing reader traffic to" << path;
+    return true;
+}
+
+bool DoorController::setReplay(const QString &path, double speed) {
+    if (!replay.open(QFile::encodeName(path).constData())) {
+        qDebug() << "Cannot read reader trace" << path;
+        return false;
+    }
+    replayPacer = TracePacer(speed);
+
+    // Keep the replay away from live data: a fresh scratch database and a topic nobody aggregates
+    if (scanDatabasePath == "test.db") {
+        scanDatabasePath = "replay.db";
+        scanTopic = "replay/" + scanTopic;
+        for (const char *suffix : {"", "-wal", "-shm"}) {
+            QFile::remove(scanDatabasePath + suffix);
+        }
+        if (scanLog) {
+            startScanLog(databaseProfileName); // Opened on test.db before the replay was asked for
+        }
+    }
+
+    replayTimer = new QTimer(this);
+    replayTimer->setSingleShot(true);
+    replayTimer->setTimerType(Qt::PreciseTimer);
+    connect(replayTimer, &QTimer::timeout, this, &DoorController::replayNext);
+    qDebug() << "Replaying" << path << "at" << (speed > 0 ? QString("%1x").arg(speed) : QString("max speed"));
+    if (started) {
+        stopScanner();
+        replayClock.start();
+        replayTimer->start(0);
+    }
+    return true;
+}
+
+bool DoorController::enableScanRings(const QStringList &names) {
+    scanRings = new ScanRingReceiver(this);
+    for (const QString &name : names) {
+        if (!scanRings->addRing(name)) {
+            return false;
+        }
+    }
+    connect(scanRings, &ScanRingReceiver::scanReceived, this,
+            [this](const QByteArray &uid, qint64 reqaNs, qint64 selectedNs, qint64 receivedNs) {
+        if (capture.isOpen()) {
+            capture.recordScan(reinterpret_cast<const uint8_t *>(uid.constData()), uid.size());
+        }
+        processScan(QString::fromLatin1(uid.toHex().toUpper()), reqaNs, selectedNs, receivedNs, receivedNs);
+    });
+
+    MetricsRegistry::instance().addCallback("rfid_scan_ring_dropped_total", "Scans lost because a ring was full",
+                                            MetricsRegistry::Counter,
+                                            [this]() { return double(scanRings->dropped()); }, this);
+    if (rfidProcess->state() != QProcess::NotRunning) {
+        restartScanner(); // Started before the rings existed; restart it with them in its environment
+    }
+    return true;
+}
+
+/**
+ * Processes every scan that is due, then waits for the next one on a timer. At max speed it
+ * still returns to the event loop every few hundred scans so MQTT and the writer keep up.
+ */
+void DoorController::replayNext() {
+    for (int budget = 256; budget > 0; --budget) {
+        if (!replayPending) {
+            replayPending = replay.next(TraceKind::Scan, &replayRecord);
+            if (!replayPending) {
+                qint64 elapsed = replayClock.elapsed();
+                qDebug().noquote() << QString("Replayed %1 scans in %2 ms (%3 scans/s)")
+                                          .arg(replayed).arg(elapsed)
+                                          .arg(elapsed > 0 ? replayed * 1000.0 / elapsed : 0.0, 0, 'f', 0);
+                qDebug().noquote() << QJsonDocument(tracer.summary()).toJson(QJsonDocument::Compact);
+                emit replayFinished(replayed, elapsed);
+                return;
+            }
+        }
+
+        qint64 delay = replayPacer.delayNs(replayRecord.timestampNs);
+        if (delay > 0) {
+            replayTimer->start(int((delay + 999999) / 1000000));
+            return;
+        }
+
+        QByteArray uid(reinterpret_cast<const char *>(replayRecord.data), replayRecord.length);
+        processScan(QString::fromLatin1(uid.toHex().toUpper()), 0, 0, ScanTracer::nowNs(),
+                    qint64(replayRecord.timestampNs));
+        replayPending = false;
+        ++replayed;
+    }
+    replayTimer->start(0);
+}
+
+void DoorController::enableMetrics(const QHostAddress &httpAddress, quint16 httpPort, int mqttIntervalSec) {
+    MetricsRegistry &registry = MetricsRegistry::instance();
+    using Type = MetricsRegistry::Type;
+
+    // Store-and-forward publisher
+    registry.addCallback("rfid_publisher_queued", "Scan messages waiting in memory", Type::Gauge,
+                         [this]() { return double(scanPublisher->stats().queued); }, this);
+    registry.addCallback("rfid_publisher_spilled", "Scan messages waiting on disk", Type::Gauge,
+                         [this]() { return double(scanPublisher->stats().spilled); }, this);
+    registry.addCallback("rfid_publisher_in_flight", "Scan messages sent but not acknowledged", Type::Gauge,
+                         [this]() { return double(scanPublisher->stats().inFlight); }, this);
+    registry.addCallback("rfid_publisher_published_total", "Scan messages delivered to the broker", Type::Counter,
+                         [this]() { return double(scanPublisher->stats().published); }, this);
+    registry.addCallback("rfid_publisher_dropped_total", "Scan messages lost", Type::Counter,
+                         [this]() { return double(scanPublisher->stats().dropped); }, this);
+    registry.addCallback("rfid_mqtt_connected", "1 while connected to the broker", Type::Gauge,
+                         [this]() { return mqttManager->isConnected() ? 1.0 : 0.0; }, this);
+
+    // Access decisions
+    registry.addCallback("rfid_access_credentials", "Credentials in the active access set", Type::Gauge,
+                         [this]() { return double(accessControl->currentSet()->size()); }, this);
+    registry.addCallback("rfid_access_lookups_total", "Access decisions requested", Type::Counter,
+                         [this]() { return double(accessControl->filterStats().lookups); }, this);
+    registry.addCallback("rfid_access_filter_rejected_total", "Unknown tags rejected by the filter alone",
+                         Type::Counter, [this]() { return double(accessControl->filterStats().rejected); }, this);
+
+    // Local scan log writer
+    registry.addCallback("rfid_scan_log_queued", "Scan events waiting for the next commit", Type::Gauge,
+                         [this]() { return scanLog ? double(scanLog->stats().queued) : 0.0; }, this);
+    registry.addCallback("rfid_scan_log_committed_total", "Scan events stored in scan_events", Type::Counter,
+                         [this]() { return scanLog ? double(scanLog->stats().committed) : 0.0; }, this);
+    registry.addCallback("rfid_scan_log_commits_total", "Scan log transactions", Type::Counter,
+                         [this]() { return scanLog ? double(scanLog->stats().commits) : 0.0; }, this);
+
+    // Pipeline latency from the scan tracer
+    for (int stage = ScanTracer::Selected; stage < ScanTracer::StageCount; ++stage) {
+        ScanTracer::Stage current = static_cast<ScanTracer::Stage>(stage);
+        registry.addHistogram(QString("rfid_stage_latency_seconds{stage=\"%1\"}").arg(ScanTracer::stageName(current)),
+                              "Time from the previous pipeline stage", &tracer.histogram(current), this);
+    }
+    registry.addHistogram("rfid_tap_to_decision_seconds", "Time from REQA to the access decision",
+                          &tracer.tapToDecision(), this);
+
+    if (httpPort > 0) {
+        metricsServer = new MetricsServer(this);
+        metricsServer->listen(httpAddress, httpPort);
+    }
+    if (mqttIntervalSec > 0) {
+        metricsTimer = new QTimer(this);
+        connect(metricsTimer, &QTimer::timeout, this, &DoorController::publishMetrics);
+        metricsTimer->start(mqttIntervalSec * 1000);
+    }
+}
+
+void DoorController::publishMetrics() {
+    if (!mqttManager->isConnected()) {
+        return; // Stats are only interesting live; nothing is queued for later
+    }
+    QJsonObject message{{"host", QSysInfo::machineHostName()},
+                        {"ts", QDateTime::currentMSecsSinceEpoch()},
+                        {"metrics", MetricsRegistry::instance().snapshot()}};
+    mqttManager->publishPayload(QString("rfid/%1/metrics").arg(QSysInfo::machineHostName()),
+                                QJsonDocument(message).toJson(QJsonDocument::Compact));
+}
+
+void DoorController::reportStartup(const char *mode, qint64 elapsedMs) {
+    QByteArray rss = "?";
+    QByteArray peak = "?";
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly)) {
+        for (const QByteArray &line : status.readAll().split('\n')) {
+            if (line.startsWith("VmRSS:")) {
+                rss = line.mid(6).simplified();
+            } else if (line.startsWith("VmHWM:")) {
+                peak = line.mid(6).simplified();
+            }
+        }
+    }
+    qDebug().noquote() << QString("Started %1 in %2 ms, resident %3 (peak %4)")
+                              .arg(mode).arg(elapsedMs).arg(QString(rss), QString(peak));
+}
+
+void DoorController::registerCommandRoutes() {
+    // Commands addressed to this device by hostname, or to every device through "all"
+    for (const QString &device : {QSysInfo::machineHostName(), QString("all")}) {
+        QString prefix = "rfid/" + device;
+
+        // {"uid":"04A1B2C3","flags":1,"person_id":7}
+        mqttManager->addRoute(prefix + "/credentials/add", [this](const QByteArray &payload, const QMqttTopicName &) {
+            QJsonObject command = QJsonDocument::fromJson(payload).object();
+            accessControl->enroll(QByteArray::fromHex(command.value("uid").toString().toLatin1()),
+                                  command.value("flags").toInt(AccessGranted),
+                                  command.value("person_id").toInteger(-1));
+        });
+
+        // {"uid":"04A1B2C3"}
+        mqttManager->addRoute(prefix + "/credentials/revoke", [this](const QByteArray &payload, const QMqttTopicName &) {
+            QJsonObject command = QJsonDocument::fromJson(payload).object();
+            accessControl->revoke(QByteArray::fromHex(command.value("uid").toString().toLatin1()));
+        });
+
+        // Chunked binary changesets (PayloadType::CredentialChunk), acknowledged on provision/ack
+        mqttManager->addRoute(prefix + "/provision/changeset", [this](const QByteArray &payload, const QMqttTopicName &) {
+            provisioner->handleChunk(payload);
+        });
+
+        // rfid/<device>/config/<key> with the new value as the payload
+        mqttManager->addRoute(prefix + "/config/+", [this](const QByteArray &payload, const QMqttTopicName &topic) {
+            QString key = topic.levels().last();
+            if (key == "payload-format") {
+                mqttManager->setPayloadFormat(PayloadCodec::formatFromName(QString::fromUtf8(payload)));
+            } else if (key == "publish-interval") {
+                bool ok = false;
+                int intervalMs = payload.trimmed().toInt(&ok);
+                if (!ok || intervalMs < MIN_PUBLISH_INTERVAL_MS) {
+                    qDebug() << "Ignoring publish-interval" << payload << "- expected milliseconds, at least"
+                             << MIN_PUBLISH_INTERVAL_MS;
+                    return;
+                }
+                mqttManager->startPeriodicPublishing(intervalMs);
+            } else {
+                qDebug() << "Unknown config key:" << key;
+            }
+        });
+
+        // rfid/<device>/trace/<summary|dump|reset>; the summary is published on rfid/<host>/trace
+        mqttManager->addRoute(prefix + "/trace/+", [this](const QByteArray &, const QMqttTopicName &topic) {
+            QString action = topic.levels().last();
+            if (action == "summary") {
+                mqttManager->publishPayload(QString("rfid/%1/trace").arg(QSysInfo::machineHostName()),
+                                            QJsonDocument(tracer.summary()).toJson(QJsonDocument::Compact));
+            } else if (action == "dump") {
+                QString path = QString("scan-trace-%1.csv").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+                qDebug() << "Scan trace written to" << path << tracer.dump(path);
+            } else if (action == "reset") {
+                tracer.reset();
+            }
+        });
+
+        // rfid/<device>/reader/<start|stop|restart>
+        mqttManager->addRoute(prefix + "/reader/+", [this](const QByteArray &, const QMqttTopicName &topic) {
+            QString action = topic.levels().last();
+            if (action == "stop") {
+                stopScanner();
+            } else if (action == "start") {
+                startScanner();
+            } else if (action == "restart") {
+                restartScanner();
+            }
+        });
+    }
+}
+
+void DoorController::startScanner() {
+    if (scannerStopping) {
+        scannerRestartPending = true; // The old process is still on its way out
+        return;
+    }
+    if (rfidProcess->state() == QProcess::NotRunning) {
+        if (scanRings && !scanRings->ringNames().isEmpty()) {
+            // RFIDScan.py pushes into the first ring and wakes us through the inherited eventfd
+            QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+            environment.insert("RFID_SCAN_RING", scanRings->ringNames().first());
+            if (scanRings->wakeFd() != -1) {
+                environment.insert("RFID_SCAN_EVENTFD", QString::number(scanRings->wakeFd()));
+            }
+            rfidProcess->setProcessEnvironment(environment);
+        }
+        // Reported through started/errorOccurred instead of blocking in waitForStarted()
+        rfidProcess->start("python3", QStringList() << "/home/nick/Downloads/RFID-Database/RFIDScan.py");
+    }
+}
+
+void DoorController::stopScanner() {
+    scannerRestartPending = false;
+    if (rfidProcess->state() == QProcess::NotRunning || scannerStopping) {
+        return;
+    }
+    // handleScannerFinished completes the stop; the GUI thread never waits for the process
+    scannerStopping = true;
+    rfidProcess->terminate();
+    scannerKillTimer->start();
+}
+
+void DoorController::restartScanner() {
+    if (rfidProcess->state() == QProcess::NotRunning && !scannerStopping) {
+        startScanner();
+        return;
+    }
+    stopScanner();
+    scannerRestartPending = true;
+}
+
+void DoorController::handleScannerOutput() {
+    qint64 receivedNs = ScanTracer::nowNs();
+    QString output = rfidProcess->readAllStandardOutput().trimmed();
+    if (output.isEmpty()) {
+        return;
+    }
+    emit scannerOutput(output);
+
+    // Decide access for every UID the scanner printed, with its monotonic REQA/select times
+    static const QRegularExpression uidPattern("UID: ([0-9A-Fa-f]+)(?: reqa=(\\d+) select=(\\d+))?");
+    QRegularExpressionMatchIterator matches = uidPattern.globalMatch(output);
+    while (matches.hasNext()) {
+        QRegularExpressionMatch match = matches.next();
+        QString hex = match.captured(1);
+        if (capture.isOpen()) {
+            QByteArray uid = QByteArray::fromHex(hex.toLatin1());
+            capture.recordScan(reinterpret_cast<const uint8_t *>(uid.constData()), uid.size());
+        }
+        processScan(hex, match.captured(2).toLongLong(), match.captured(3).toLongLong(), receivedNs, receivedNs);
+    }
+}
+
+void DoorController::processScan(const QString &hex, qint64 reqaNs, qint64 selectedNs, qint64 receivedNs,
+                                 qint64 dedupNs) {
+    static MetricCounter *granted = MetricsRegistry::instance().counter("rfid_scans_total{result=\"granted\"}",
+                                                                          "Scans decided");
+    static MetricCounter *denied = MetricsRegistry::instance().counter("rfid_scans_total{result=\"denied\"}",
+                                                                         "Scans decided");
+    static MetricCounter *repeats = MetricsRegistry::instance().counter("rfid_scan_repeats_total",
+                                                                          "Reads of a card still on the reader");
+    if (startup) {
+        startup->milestone("first-scan");
+    }
+    // The scanner prints the card again on every loop while it stays on the reader
+    bool repeat = hex == lastUid && dedupNs - lastUidNs < repeatWindowNs;
+    lastUid = hex;
+    lastUidNs = dedupNs;
+    if (repeat) {
+        repeats->inc();
+        return;
+    }
+
+    // Traced only once it is a real tap, so repeats stay out of the stage histograms. The
+    // stamps are the ones taken on the way in, so the dedup stage still covers the check.
+    quint32 sequence = scanSequence + 1;
+    tracer.begin(sequence, reqaNs, selectedNs, receivedNs);
+    tracer.mark(sequence, ScanTracer::Deduplicated);
+
+    bool allowed = accessControl->isAuthorized(QByteArray::fromHex(hex.toLatin1()));
+    tracer.mark(sequence, ScanTracer::Decided);
+    scanSequence = sequence;
+    (allowed ? granted : denied)->inc();
+
+    emit scanDecided(hex, allowed);
+    publishScan(hex, allowed, sequence);
+}
+
+void DoorController::handleScannerError() {
+    QString error = rfidProcess->readAllStandardError().trimmed();
+    if (!error.isEmpty()) {
+        qDebug() << "RFID scanning process error:" << error;
+    }
+}
+
+void DoorController::handleScannerFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+    qDebug() << "RFID process finished with code" << exitCode << "and status" << exitStatus;
+    scannerKillTimer->stop();
+    if (scanRings && !scanRings->ringNames().isEmpty()) {
+        // A killed scanner never detached; poll its ring until the next one attaches
+        scanRings->producerExited(scanRings->ringNames().first());
+    }
+    if (scannerStopping) {
+        // terminate() shows up as a CrashExit too; only restart when asked to
+        scannerStopping = false;
+        if (scannerRestartPending) {
+            scannerRestartPending = false;
+            startScanner();
+        }
+        return;
+    }
+    // Restart the process if it unexpectedly stops
+    if (exitStatus == QProcess::CrashExit) {
+        qDebug() << "RFID process crashed. Restarting...";
+        startScanner();
+    }
+}
+
+void DoorController::publishScan(const QString &uidHex, bool granted, quint32 sequence) {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    ScanEvent event{now, sequence, 0, {0}, static_cast<quint8>(granted ? 1 : 0)};
+    event.uidLength = decodeUidHex(uidHex, event.uid, sizeof(event.uid));
+
+    if (scanLog) {
+        scanLog->submit({QSysInfo::machineHostName(), now, {event}, scanSession});
+    }
+
+    if (mqttManager->getPayloadFormat() == PayloadFormat::Binary) {
+        char buffer[PayloadCodec::HEADER_BYTES + PayloadCodec::SCAN_EVENT_BYTES];
+        int size = PayloadCodec::encodeScanEvents(&event, 1, buffer, sizeof(buffer), scanSession);
+        // The one allocation on this path: the publisher owns the payload until the broker has it
+        scanPublisher->enqueue(scanTopic, QByteArray(buffer, size), 1, sequence);
+        return;
+    }
+
+    QJsonObject json{{"uid", uidHex}, {"granted", granted}, {"ts", now}, {"seq", static_cast<qint64>(sequence)},
+                     {"boot", scanSession}};
+    scanPublisher->enqueue(scanTopic, QJsonDocument(json).toJson(QJsonDocument::Compact), 1, sequence);
+}
@@ -0,0 +1,126 @@
+#ifndef DOORCONTROLLER_H
+#define DOORCONTROLLER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QString>
+#include <QTimer>
+
+#include "mqttmanager.h"
+#include "databasemanager.h"
+#include "accesscontrol.h"
+#include "databasebackup.h"
+#include "scanpublisher.h"
+#include "credentialprovisioner.h"
+#include "scaningestwriter.h"
+#include "scantracer.h"
+#include "metricsserver.h"
+#include "readertrace.h"
+#include "scanringreceiver.h"
+#include "startuporchestrator.h"
+
+// Everything a door needs without a screen: scanner process, access decisions, database and
+// MQTT. MainWindow shows what it does; the headless daemon runs it on a QCoreApplication.
+class DoorController : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DoorController(QObject *parent = nullptr);
+    ~DoorController();
+
+    bool openDatabase(const QString &profileName = QString()); // test.db with the given tuning profile, blocking
+    DatabaseBackup *enableBackups(const QString &directory, int intervalMinutes, bool compress); // Needs the database open
+    // Brings up the broker connection, the database (schema work on a worker thread) and the scanner
+    // (or the replay) concurrently and returns at once; databaseOpened() reports the database.
+    // Phase timings and time-to-first-scan are measured from sinceLaunch.
+    void start(const QString &profileName, const QElapsedTimer &sinceLaunch);
+    bool isDatabaseOpen() const { return databaseManager->database().isOpen(); }
+
+    // Appends every UID the scanner reports, before deduplication, to a reader trace. Only Scan
+    // records: the scanner is a separate process, so this app never sees the SPI traffic.
+    // Spi records come from RecordingSpiTransport under RFIDReader, in the driver-level builds.
+    bool startCapture(const QString &path);
+    // Feeds a captured trace through the pipeline instead of running the scanner. Speed 1 keeps
+    // the recorded timing, N plays N times faster, 0 as fast as the pipeline accepts scans.
+    // Replayed scans are stored in replay.db, not test.db, and published under replay/site/...
+    // so neither the live scan_events nor the aggregators subscribed to site/+/scans see them.
+    bool setReplay(const QString &path, double speed); // Takes over from the scanner if already started
+    // Receives scans as binary records over shared memory instead of parsing scanner stdout. The
+    // first ring is handed to the scanner this controller starts; others are for external producers.
+    bool enableScanRings(const QStringList &names);
+    // Registers the subsystem metrics; serves them over HTTP when httpPort > 0 and publishes a
+    // JSON snapshot on rfid/<host>/metrics every mqttIntervalSec when that is > 0
+    void enableMetrics(const QHostAddress &httpAddress, quint16 httpPort, int mqttIntervalSec);
+
+    DatabaseManager *getDatabaseManager() const { return databaseManager; }
+    AccessControl *getAccessControl() const { return accessControl; }
+    MqttManager *getMqttManager() const { return mqttManager; }
+    ScanTracer &getScanTracer() { return tracer; }
+    void setRepeatWindowMs(int ms) { repeatWindowNs = qint64(ms) * 1000000; } // Same card held on the reader
+
+    static void reportStartup(const char *mode, qint64 elapsedMs); // Startup time and resident memory
+
+public slots:
+    void startScanner();
+    void stopScanner();    // Terminates without blocking; killed if still running after 3 s
+    void restartScanner(); // Stops, then starts again once the old process has finished
+
+signals:
+    void scannerOutput(const QString &output);          // Raw text printed by the scanner
+    void scanDecided(const QString &uidHex, bool granted);
+    void replayFinished(quint64 scans, qint64 elapsedMs);
+    void databaseOpened(bool ok);
+    void startupFinished();
+
+private slots:
+    void handleScannerOutput();
+    void handleScannerError();
+    void handleScannerFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void replayNext();
+    void startScanLog(const QString &profileName);
+
+private:
+    // dedupNs is the clock the repeat window runs on: arrival time live, trace time in a replay
+    void processScan(const QString &uidHex, qint64 reqaNs, qint64 selectedNs, qint64 receivedNs, qint64 dedupNs);
+    void publishScan(const QString &uidHex, bool granted, quint32 sequence);
+    void publishMetrics();
+    void registerCommandRoutes();
+
+    MqttManager *mqttManager;
+    DatabaseManager *databaseManager;
+    AccessControl *accessControl;
+    DatabaseBackup *databaseBackup;
+    ScanPublisher *scanPublisher;
+    CredentialProvisioner *provisioner;
+    ScanIngestWriter *scanLog; // Local scan_events, written off the GUI thread
+    QString scanDatabasePath; // test.db, or a scratch database while replaying
+    QString scanTopic; // site/<host>/scans, under replay/ while replaying
+    QString databaseProfileName;
+    quint32 scanSequence; // Numbers published scan events so subscribers can spot gaps
+    quint16 scanSession; // Random per process, tells subscribers scanSequence started over
+    QProcess *rfidProcess;
+    QTimer *scannerKillTimer; // Escalates a terminate() the scanner ignores to kill()
+    bool scannerStopping; // A finish we asked for, not a crash to recover from
+    bool scannerRestartPending; // Start again as soon as the old process is gone
+    ScanRingReceiver *scanRings;
+    ScanTracer tracer;
+    MetricsServer *metricsServer;
+    QTimer *metricsTimer;
+    QString lastUid;
+    qint64 lastUidNs;
+    qint64 repeatWindowNs;
+    TraceWriter capture;
+    TraceReader replay;
+    TracePacer replayPacer;
+    TraceRecord replayRecord;
+    bool replayPending; // replayRecord has been read but not yet processed
+    QTimer *replayTimer;
+    StartupOrchestrator *startup;
+    bool started;
+    QElapsedTimer replayClock;
+    quint64 replayed;
+};
+
+#endif // DOORCONTROLLER_H
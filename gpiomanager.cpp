@@ -1,7 +1,8 @@
 #include "gpiomanager.h"
 #include <wiringPi.h>
 #include <wiringPiSPI.h>
-#include <iostream>
+#include "logger.h"
+#include "rc522timing.h"
 #include <chrono>
 #include <thread>
 
@@ -20,7 +21,7 @@ GPIOManager::GPIOManager(QObject *parent) : QObject(parent), irqPin(-1) {
 
     //Error Code
     if (!setupSPI()) {
-        std::cerr << "Failed to initialize SPI communication for RFID reader!" << std::endl;
+        LOG_ERROR("Failed to initialize SPI communication for RFID reader!");
     }
 
     // Set static instance
@@ -38,13 +39,14 @@ GPIOManager::~GPIOManager() {
 
 // Static interrupt handler (called when a tag is detected)
 void GPIOManager::handleInterrupt() {
-    std::cout << "Interrupt triggered!" << std::endl;
+    // Runs on the wiringPi interrupt thread: only non-blocking logging here
+    LOG_DEBUG("Interrupt triggered!");
 
     // Access the GPIOManager instance and call the non-static readTagUID method
     if (instance->readTagUID()) {
-        std::cout << "Tag UID read successfully!" << std::endl;
+        LOG_DEBUG("Tag UID read successfully!");
     } else {
-        std::cout << "Failed to read tag UID!" << std::endl;
+        LOG_WARN("Failed to read tag UID!");
     }
 
     emit instance->tagDetected();  // Emit signal when IRQ pin is triggered
@@ -73,7 +75,7 @@ void GPIOManager::handleInterrupt() {
 
 bool GPIOManager::setupSPI() {
     if (wiringPiSPISetup(SPI_CHANNEL, SPI_SPEED) < 0) {
-        std::cerr << "SPI Setup failed!" << std::endl;
+        LOG_ERROR("SPI Setup failed!");
         return false;
     }
     return true;
@@ -85,7 +87,7 @@ void GPIOManager::setupResetPin(int rstPin) {
     pinMode(rstPin, OUTPUT);  // Set GPIO24 as output
     digitalWrite(rstPin, HIGH);  // Initially set reset pin HIGH
 
-    std::cout << "RST Pin " << rstPin << " state: " << (digitalRead(rstPin) == HIGH ? "HIGH" : "LOW") << std::endl;
+    LOG_INFO("RST Pin %d state: %s", rstPin, digitalRead(rstPin) == HIGH ? "HIGH" : "LOW");
 }
 
 // Setup the interrupt pin (GPIO25)
@@ -97,17 +99,19 @@ void GPIOManager::initRFIDReader(int irqPin) {
     // Connect interrupt handler for falling edge (detect when IRQ goes LOW)
     wiringPiISR(irqPin, INT_EDGE_FALLING, &GPIOManager::handleInterrupt);
 
-    std::cout << "IRQ Pin " << irqPin << " state: " << (digitalRead(irqPin) == HIGH ? "HIGH" : "LOW") << std::endl;
-    std::cout << "Starting to monitor IRQ pin..." << std::endl;
+    LOG_INFO("IRQ Pin %d state: %s", irqPin, digitalRead(irqPin) == HIGH ? "HIGH" : "LOW");
+    LOG_INFO("Starting to monitor IRQ pin...");
 }
 
 // Reset MFRC522 by setting RST pin LOW and then HIGH
 void GPIOManager::resetMFRC522(int rstPin) {
-    std::cout << "Resetting MFRC522...\n";
+    LOG_INFO("Resetting MFRC522...");
     this->rstPin = rstPin;
     digitalWrite(rstPin, LOW);   // Pull the RST pin low (reset)
-    delay(100);               // Wait 100ms for reset
+    delayMicroseconds(10);       // The RC522 needs 100 ns; no need to hold startup for 100 ms
     digitalWrite(rstPin, HIGH);  // Release reset (set pin high)
+    // setupSPI and the first register access follow right away; let the crystal start first
+    delayMicroseconds(PCD_OSC_STARTUP_US);
 }
 
 void GPIOManager::simulateIRQ() {
@@ -115,7 +119,7 @@ void GPIOManager::simulateIRQ() {
     digitalWrite(irqPin, LOW);  // Simulate an interrupt
     std::this_thread::sleep_for(std::chrono::milliseconds(100));  // Wait a bit
     digitalWrite(irqPin, HIGH); // Set it back to HIGH
-    std::cout << "Simulated IRQ trigger!" << std::endl;
+    LOG_DEBUG("Simulated IRQ trigger!");
 
     // Trigger interrupt handler
     handleInterrupt(); // This will call the interrupt handler to simulate the tag detection
@@ -136,11 +140,8 @@ bool GPIOManager::readTagUID() {
 
     // Check the response, e.g., check the first byte to see if we have a valid tag
     if (buffer[0] == 0x00) {  // Typically, 0x00 indicates a successful read
-        std::cout << "Tag UID: ";
-        for (int i = 1; i < 5; ++i) {  // Loop through the UID bytes (assuming it's 4 bytes long)
-            std::cout << std::hex << (int)buffer[i] << " ";
-        }
-        std::cout << std::endl;
+        // The UID bytes (assuming it's 4 bytes long)
+        LOG_INFO("Tag UID: %02x %02x %02x %02x", buffer[1], buffer[2], buffer[3], buffer[4]);
         return true;  // Successfully read the tag UID
     } else {
         return false;  // Failed to read the tag UID
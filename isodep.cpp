@@ -0,0 +1,255 @@
+#include "isodep.h"
+#include <cstring>
+#include <ctime>
+
+#define RATS_COMMAND        0xE0
+#define PPS_COMMAND         0xD0
+
+// PCB values without CID/NAD; the low bit is the block number
+#define PCB_I_BLOCK         0x02
+#define PCB_I_CHAINING      0x10
+#define PCB_R_ACK           0xA2
+#define PCB_R_NAK           0xB2
+#define PCB_S_DESELECT      0xC2
+#define PCB_S_WTX           0xF2
+
+#define IS_I_BLOCK(pcb)     (((pcb) & 0xE2) == 0x02)
+#define IS_R_BLOCK(pcb)     (((pcb) & 0xE6) == 0xA2)
+#define IS_S_WTX(pcb)       (((pcb) & 0xF7) == 0xF2)
+
+// Frame wait time unit: 256 * 16 / fc, ~302 us
+#define FWT_UNIT_NS         302064
+#define FWT_MAX_US          4949000 // FWI 14
+
+static const int FRAME_SIZES[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+
+static void sleepUs(uint32_t us) {
+    timespec delay = {time_t(us / 1000000), long(us % 1000000) * 1000L};
+    nanosleep(&delay, nullptr);
+}
+
+IsoDep::IsoDep(MFRC522 *reader)
+    : reader(reader)
+    , active(false)
+    , blockNumber(0)
+    , fsc(32)
+    , fwtUs(4833) // FWI 4, the default until the ATS says otherwise
+    , sfgtUs(0)
+    , atsLength(0)
+{
+}
+
+/**
+ * RATS, then the ATS: TL, T0 (FSCI and which interface bytes follow), TA (bit rates), TB (FWI
+ * and SFGI), TC, historical bytes. The card may need the start-up frame guard time after the
+ * ATS before it listens again.
+ */
+rfid_byte IsoDep::activate(rfid_byte maxBitRate) {
+    active = false;
+    blockNumber = 0;
+    rfid_byte rats[2] = {RATS_COMMAND, 0x80}; // FSDI 8 (256 bytes), CID 0
+    int length = sizeof(atsBytes);
+    rfid_byte status = reader->PCD_TransceiveFrame(rats, 2, atsBytes, &length, FWT_UNIT_NS * 16 / 1000); // Activation FWT, FWI 4
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (length < 1 || atsBytes[0] != length) {
+        return STATUS_ERROR;
+    }
+    atsLength = length;
+
+    rfid_byte ta = 0x00;
+    rfid_byte tb = 0x40; // FWI 4, SFGI 0
+    fsc = 32;            // FSCI 2 when T0 is absent
+    if (length > 1) {
+        rfid_byte t0 = atsBytes[1];
+        int fsci = t0 & 0x0F;
+        fsc = FRAME_SIZES[fsci > 8 ? 8 : fsci];
+        int next = 2;
+        if ((t0 & 0x10) && next < length) {
+            ta = atsBytes[next++];
+        }
+        if ((t0 & 0x20) && next < length) {
+            tb = atsBytes[next++];
+        }
+    }
+    int fwi = tb >> 4;
+    int sfgi = tb & 0x0F;
+    fwtUs = uint32_t((uint64_t(FWT_UNIT_NS) << (fwi > 14 ? 4 : fwi)) / 1000);
+    sfgtUs = sfgi == 0 || sfgi == 15 ? 0 : uint32_t((uint64_t(FWT_UNIT_NS) << sfgi) / 1000);
+    if (sfgtUs) {
+        sleepUs(sfgtUs);
+    }
+
+    status = negotiateBitRate(ta, maxBitRate);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    active = true;
+    return STATUS_OK;
+}
+
+/**
+ * Picks the highest rate both sides offer and agrees on it with a PPS. TA bit 7 set means the
+ * card only supports the same rate both ways; otherwise the directions are chosen separately,
+ * but the RC522 is simplest kept symmetric, so a rate is used only if the card offers it for
+ * both directions.
+ */
+rfid_byte IsoDep::negotiateBitRate(rfid_byte ta, rfid_byte maxBitRate) {
+    rfid_byte rate = PICC_BITRATE_106;
+    for (rfid_byte candidate = maxBitRate > PICC_BITRATE_848 ? PICC_BITRATE_848 : maxBitRate;
+         candidate > PICC_BITRATE_106; --candidate) {
+        bool toCard = ta & (0x01 << (candidate - 1));  // DR bits 0-2
+        bool fromCard = ta & (0x10 << (candidate - 1)); // DS bits 4-6
+        if (toCard && fromCard) {
+            rate = candidate;
+            break;
+        }
+    }
+    if (rate == PICC_BITRATE_106) {
+        return STATUS_OK;
+    }
+
+    rfid_byte pps[3] = {PPS_COMMAND, 0x11, rfid_byte((rate << 2) | rate)}; // PPS1 present, DSI and DRI
+    rfid_byte reply[4];
+    int replyLen = sizeof(reply);
+    rfid_byte status = reader->PCD_TransceiveFrame(pps, 3, reply, &replyLen, fwtUs);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (replyLen != 1 || reply[0] != PPS_COMMAND) {
+        return STATUS_ERROR;
+    }
+    reader->PCD_SetBitRate(rate);
+    return STATUS_OK;
+}
+
+/**
+ * Sends one block and returns the card's answer to it, replying to S(WTX) requests on the way:
+ * the card asks for WTXM times the frame wait time for the next answer only.
+ */
+rfid_byte IsoDep::exchange(const rfid_byte *block, int blockLen, rfid_byte *reply, int *replyLen) {
+    int capacity = *replyLen;
+    rfid_byte status = reader->PCD_TransceiveFrame(block, blockLen, reply, replyLen, fwtUs);
+    while (status == STATUS_OK && *replyLen >= 2 && IS_S_WTX(reply[0])) {
+        rfid_byte wtxm = reply[1] & 0x3F;
+        if (wtxm == 0 || wtxm > 59) {
+            return STATUS_ERROR;
+        }
+        uint64_t extended = uint64_t(fwtUs) * wtxm;
+        rfid_byte answer[2] = {PCB_S_WTX, wtxm};
+        *replyLen = capacity;
+        status = reader->PCD_TransceiveFrame(answer, 2, reply, replyLen,
+                                             extended > FWT_MAX_US ? FWT_MAX_US : uint32_t(extended));
+    }
+    return status;
+}
+
+/**
+ * One I-block of the command, retransmitted on a lost or garbled answer: the card is asked with
+ * R(NAK) first, which makes it repeat its last block or acknowledge ours (ISO/IEC 14443-4 7.5.4).
+ */
+rfid_byte IsoDep::sendChunk(const rfid_byte *apdu, int offset, int length, bool chained, rfid_byte *reply, int *replyLen) {
+    rfid_byte block[FSD];
+    block[0] = PCB_I_BLOCK | blockNumber | (chained ? PCB_I_CHAINING : 0);
+    memcpy(block + 1, apdu + offset, length);
+
+    int capacity = *replyLen;
+    rfid_byte status = exchange(block, length + 1, reply, replyLen);
+    for (int retry = 0; retry < MAX_RETRIES && status != STATUS_OK; ++retry) {
+        rfid_byte nak = PCB_R_NAK | blockNumber;
+        *replyLen = capacity;
+        status = exchange(&nak, 1, reply, replyLen);
+        if (status == STATUS_OK && *replyLen >= 1 && IS_R_BLOCK(reply[0]) && (reply[0] & 0x01) != blockNumber) {
+            // The card never got our block: it acknowledges the previous one, send ours again
+            *replyLen = capacity;
+            status = exchange(block, length + 1, reply, replyLen);
+        }
+    }
+    return status;
+}
+
+/**
+ * Sends the APDU in I-blocks of at most FSC bytes (PCB and CRC included) and collects the
+ * response, which the card may chain the same way: each chained I-block is acknowledged with
+ * R(ACK) until one arrives without the chaining bit.
+ */
+rfid_byte IsoDep::transceive(const rfid_byte *apdu, int apduLen, rfid_byte *response, int *responseLen) {
+    if (!active) {
+        return STATUS_INVALID;
+    }
+    const int chunkSize = fsc - 3; // PCB + CRC_A
+    rfid_byte reply[FSD];
+    int replyLen;
+    rfid_byte status;
+
+    int offset = 0;
+    while (true) {
+        int length = apduLen - offset < chunkSize ? apduLen - offset : chunkSize;
+        bool chained = offset + length < apduLen;
+        replyLen = sizeof(reply);
+        status = sendChunk(apdu, offset, length, chained, reply, &replyLen);
+        if (status != STATUS_OK) {
+            return status;
+        }
+        if (replyLen < 1) {
+            return STATUS_ERROR;
+        }
+        if (!chained) {
+            break;
+        }
+        // A chained block is answered with R(ACK) carrying its block number
+        if (!IS_R_BLOCK(reply[0]) || (reply[0] & 0x10) || (reply[0] & 0x01) != blockNumber) {
+            return STATUS_ERROR;
+        }
+        blockNumber ^= 1;
+        offset += length;
+    }
+
+    int capacity = *responseLen;
+    int received = 0;
+    while (true) {
+        if (!IS_I_BLOCK(reply[0]) || (reply[0] & 0x01) != blockNumber) {
+            return STATUS_ERROR;
+        }
+        blockNumber ^= 1;
+        int payload = replyLen - 1;
+        if (received + payload > capacity) {
+            return STATUS_NO_ROOM;
+        }
+        memcpy(response + received, reply + 1, payload);
+        received += payload;
+        if (!(reply[0] & PCB_I_CHAINING)) {
+            break;
+        }
+
+        rfid_byte ack = PCB_R_ACK | blockNumber;
+        status = STATUS_ERROR;
+        for (int retry = 0; retry <= MAX_RETRIES && status != STATUS_OK; ++retry) {
+            replyLen = sizeof(reply);
+            status = exchange(&ack, 1, reply, &replyLen); // A lost answer is asked for again with the same ACK
+        }
+        if (status != STATUS_OK) {
+            return status;
+        }
+        if (replyLen < 1) {
+            return STATUS_ERROR;
+        }
+    }
+    *responseLen = received;
+    return STATUS_OK;
+}
+
+rfid_byte IsoDep::deselect() {
+    rfid_byte command = PCB_S_DESELECT;
+    rfid_byte reply[4];
+    int replyLen = sizeof(reply);
+    rfid_byte status = active ? exchange(&command, 1, reply, &replyLen) : STATUS_OK;
+    active = false;
+    reader->PCD_SetBitRate(PICC_BITRATE_106);
+    reader->PCD_SetHardwareCRC(false);
+    if (status == STATUS_OK && (replyLen < 1 || reply[0] != PCB_S_DESELECT)) {
+        return STATUS_ERROR;
+    }
+    return status;
+}
@@ -0,0 +1,49 @@
+#ifndef ISODEP_H
+#define ISODEP_H
+
+#include "MFRC522.h"
+
+/**
+ * ISO/IEC 14443-4 (T=CL) half-duplex block protocol on top of an MFRC522, for DESFire and other
+ * smartcard credentials. After PICC_Select reports SAK bit 0x20, activate() sends RATS, reads
+ * the ATS and agrees on frame sizes, frame wait time and (PPS) bit rate; transceive() then
+ * exchanges APDUs of any length, chaining I-blocks in both directions and answering waiting
+ * time extensions. Frames go through PCD_TransceiveFrame, which streams the FIFO, so the reader
+ * frame size is the protocol maximum of 256 bytes rather than the 64 byte FIFO.
+ *
+ * No CID or NAD: one card at a time, which is all the door readers ever see.
+ */
+class IsoDep {
+public:
+    explicit IsoDep(MFRC522 *reader);
+
+    // maxBitRate caps the PPS; 848 kbit/s is at the edge of what RC522 boards manage reliably
+    rfid_byte activate(rfid_byte maxBitRate = PICC_BITRATE_424);
+    rfid_byte transceive(const rfid_byte *apdu, int apduLen, rfid_byte *response, int *responseLen);
+    rfid_byte deselect(); // Back to 106 kbit/s; the card goes to HALT
+
+    bool isActive() const { return active; }
+    int cardFrameSize() const { return fsc; }     // FSC from the ATS
+    int readerFrameSize() const { return FSD; }
+    uint32_t frameWaitUs() const { return fwtUs; }
+    const rfid_byte *ats(int *length) const { *length = atsLength; return atsBytes; }
+
+private:
+    static const int FSD = 256;  // FSDI 8
+    static const int MAX_RETRIES = 2;
+
+    rfid_byte exchange(const rfid_byte *block, int blockLen, rfid_byte *reply, int *replyLen);
+    rfid_byte sendChunk(const rfid_byte *apdu, int offset, int length, bool chained, rfid_byte *reply, int *replyLen);
+    rfid_byte negotiateBitRate(rfid_byte ta, rfid_byte maxBitRate);
+
+    MFRC522 *reader;
+    bool active;
+    rfid_byte blockNumber;
+    int fsc;
+    uint32_t fwtUs;
+    uint32_t sfgtUs;
+    rfid_byte atsBytes[32];
+    int atsLength;
+};
+
+#endif // ISODEP_H
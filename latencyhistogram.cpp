@@ -0,0 +1,64 @@
+#include "latencyhistogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<quint64> &bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sumNs.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketFor(quint64 ns) {
+    if (ns < SUB_BUCKETS) {
+        return static_cast<int>(ns); // Exact below 16 ns
+    }
+    // The highest bit picks the power of two, the next four bits the linear sub-bucket
+    int msb = 63 - __builtin_clzll(ns);
+    int bucket = (msb - 3) * SUB_BUCKETS + static_cast<int>((ns >> (msb - 4)) & (SUB_BUCKETS - 1));
+    return qMin(bucket, BUCKETS - 1);
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    int msb = bucket / SUB_BUCKETS + 3;
+    qint64 width = qint64(1) << (msb - 4);
+    return (SUB_BUCKETS + bucket % SUB_BUCKETS) * width + width - 1;
+}
+
+void LatencyHistogram::record(qint64 ns) {
+    if (ns < 0) {
+        ns = 0; // Clock skew between processes; keep the sample rather than lose it
+    }
+    buckets[bucketFor(static_cast<quint64>(ns))].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sumNs.fetch_add(ns, std::memory_order_relaxed);
+    qint64 previous = maxNs.load(std::memory_order_relaxed);
+    while (ns > previous && !maxNs.compare_exchange_weak(previous, ns, std::memory_order_relaxed)) {
+    }
+}
+
+qint64 LatencyHistogram::percentile(double quantile) const {
+    quint64 samples = count();
+    if (samples == 0) {
+        return 0;
+    }
+    quint64 rank = static_cast<quint64>(quantile * samples);
+    if (rank >= samples) {
+        rank = samples - 1;
+    }
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += bucketCount(bucket);
+        if (seen > rank) {
+            return qMin(bucketUpperBound(bucket), max());
+        }
+    }
+    return max();
+}
@@ -0,0 +1,37 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+#include <atomic>
+
+// Log-linear histogram of nanosecond durations: 16 buckets per power of two (about 6 %
+// resolution) from 1 ns to 2^43 ns (~2.4 hours); longer samples land in the last bucket.
+// record() is a few relaxed atomic adds, so any thread may record while another reads percentiles.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKETS = 16;
+    static constexpr int BUCKETS = 40 * SUB_BUCKETS;
+    static constexpr double QUANTILES[] = {0.5, 0.9, 0.99, 0.999}; // Reported by the metrics and the tracer
+
+    LatencyHistogram();
+
+    void record(qint64 ns);
+    void reset();
+
+    quint64 count() const { return total.load(std::memory_order_relaxed); }
+    qint64 sum() const { return sumNs.load(std::memory_order_relaxed); }
+    qint64 max() const { return maxNs.load(std::memory_order_relaxed); }
+    qint64 percentile(double quantile) const; // Upper bound of the bucket holding the quantile, in ns
+    quint64 bucketCount(int bucket) const { return buckets[bucket].load(std::memory_order_relaxed); }
+    static qint64 bucketUpperBound(int bucket);
+
+private:
+    static int bucketFor(quint64 ns);
+
+    std::atomic<quint64> buckets[BUCKETS];
+    std::atomic<quint64> total;
+    std::atomic<qint64> sumNs;
+    std::atomic<qint64> maxNs;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,284 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+static const char *LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+bool LogRing::push(const LogRecord &record) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    records[h & (CAPACITY - 1)] = record;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::pop(LogRecord *record) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    *record = records[t & (CAPACITY - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Marks the ring of a thread as abandoned when the thread ends, so short-lived worker
+ * threads do not leak one ring each.
+ */
+struct LogRingHandle {
+    LogRing *ring = nullptr;
+    ~LogRingHandle() {
+        if (ring) {
+            ring->abandoned.store(true, std::memory_order_release);
+        }
+    }
+};
+
+Logger &Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : output(stderr), stopping(false), flushRequests(0), flushesDone(0), totalDropped(0) {
+    worker = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    stopping.store(true);
+    wake.notify_one();
+    worker.join();
+    for (LogRing *ring : rings) {
+        delete ring;
+    }
+}
+
+uint64_t Logger::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void Logger::captureString(LogRecord &record, uint8_t index, const char *value) {
+    record.argTypes[index] = LogRecord::String;
+    record.args[index].stringOffset = record.stringBytes;
+    if (!value) {
+        value = "(null)";
+    }
+    // Truncate rather than spill: the record has a fixed size
+    size_t room = LOG_STRING_BYTES - record.stringBytes;
+    if (room == 0) {
+        record.args[index].stringOffset = LOG_STRING_BYTES - 1;
+        return;
+    }
+    size_t length = std::min(std::strlen(value), room - 1);
+    std::memcpy(record.strings + record.stringBytes, value, length);
+    record.strings[record.stringBytes + length] = '\0';
+    record.stringBytes = static_cast<uint8_t>(record.stringBytes + length + 1);
+}
+
+LogRing *Logger::ringForThisThread() {
+    thread_local LogRingHandle handle;
+    if (!handle.ring) {
+        handle.ring = new LogRing;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(handle.ring);
+    }
+    return handle.ring;
+}
+
+void Logger::submit(const LogRecord &record) {
+    ringForThisThread()->push(record);
+}
+
+void Logger::flush() {
+    uint64_t ticket = flushRequests.fetch_add(1) + 1;
+    wake.notify_one();
+    while (flushesDone.load() < ticket && !stopping.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Logger::run() {
+    // Producers never signal; the writer wakes on its own every 20 ms, or early for flush()
+    while (!stopping.load()) {
+        uint64_t requested = flushRequests.load();
+        bool wrote = drain();
+        // A burst followed by silence never reaches write() again; report its count here, and
+        // everything still pending when someone waits for the output
+        wrote |= reportSuppressed(now(), requested != flushesDone.load());
+        if (wrote) {
+            fflush(output);
+        }
+        flushesDone.store(requested);
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait_for(lock, std::chrono::milliseconds(20), [this, requested]() {
+            return stopping.load() || flushRequests.load() != requested;
+        });
+    }
+    drain();
+    reportSuppressed(now(), true);
+    fflush(output);
+}
+
+bool Logger::drain() {
+    std::vector<LogRing *> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        snapshot = rings;
+    }
+
+    bool wrote = false;
+    LogRecord record;
+    for (LogRing *ring : snapshot) {
+        // Read abandoned before draining so nothing pushed just before the thread ended is lost
+        bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+        while (ring->pop(&record)) {
+            write(record);
+            wrote = true;
+        }
+        uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            totalDropped.fetch_add(dropped, std::memory_order_relaxed);
+            fprintf(output, "WARN  logger: %llu records dropped, ring full\n", static_cast<unsigned long long>(dropped));
+            wrote = true;
+        }
+        if (abandoned) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.erase(std::remove(rings.begin(), rings.end(), ring), rings.end());
+            delete ring;
+        }
+    }
+    return wrote;
+}
+
+void Logger::writeSuppressed(SiteState &site) {
+    fprintf(output, "%-5s (suppressed %u repeats of \"%s\")\n", LEVEL_NAMES[site.level], site.suppressed, site.format);
+    site.suppressed = 0;
+}
+
+bool Logger::reportSuppressed(uint64_t nowNs, bool all) {
+    bool wrote = false;
+    for (SiteState &site : sites) {
+        bool expired = nowNs - site.windowStartNs >= 1000000000ull;
+        if (site.suppressed > 0 && (expired || all)) {
+            writeSuppressed(site);
+            wrote = true;
+        }
+        if (expired) {
+            // The next record opens a new window; the count must not spill over from this one
+            site.windowStartNs = nowNs;
+            site.count = 0;
+        }
+    }
+    return wrote;
+}
+
+/**
+ * Formats one record. Every conversion in the format string is handed to snprintf on its own
+ * with the captured value, so the usual printf flags, widths and precisions work.
+ */
+void Logger::write(const LogRecord &record) {
+    // Rate limit per call site, keyed by the format literal
+    auto site = std::find_if(sites.begin(), sites.end(),
+                             [&record](const SiteState &state) { return state.format == record.format; });
+    if (site == sites.end()) {
+        sites.push_back({record.format, record.timestampNs, 0, 0, record.level});
+        site = sites.end() - 1;
+    }
+    if (record.timestampNs - site->windowStartNs >= 1000000000ull) {
+        if (site->suppressed > 0) {
+            writeSuppressed(*site);
+        }
+        site->windowStartNs = record.timestampNs;
+        site->count = 0;
+    }
+    if (++site->count > LOG_BURST) {
+        ++site->suppressed;
+        return;
+    }
+
+    char line[512];
+    size_t used = 0;
+    auto append = [&line, &used](const char *text, size_t length) {
+        length = std::min(length, sizeof(line) - 1 - used);
+        std::memcpy(line + used, text, length);
+        used += length;
+    };
+
+    time_t seconds = static_cast<time_t>(record.timestampNs / 1000000000ull);
+    tm local;
+    localtime_r(&seconds, &local);
+    used = strftime(line, sizeof(line), "%H:%M:%S", &local);
+    used += snprintf(line + used, sizeof(line) - used, ".%03u %-5s ",
+                     static_cast<unsigned>(record.timestampNs / 1000000 % 1000), LEVEL_NAMES[record.level]);
+
+    int arg = 0;
+    const char *p = record.format;
+    while (*p) {
+        const char *percent = std::strchr(p, '%');
+        if (!percent) {
+            append(p, std::strlen(p));
+            break;
+        }
+        append(p, percent - p);
+        if (percent[1] == '%') {
+            append("%", 1);
+            p = percent + 2;
+            continue;
+        }
+
+        // Flags, width and precision are kept; length modifiers are replaced by what was captured
+        const char *end = percent + 1;
+        while (*end && std::strchr("-+ #0123456789.*", *end)) {
+            ++end;
+        }
+        std::string spec(percent, end);
+        while (*end && std::strchr("hljztL", *end)) {
+            ++end;
+        }
+        char conversion = *end ? *end++ : 's';
+        p = end;
+
+        char piece[128];
+        int length = 0;
+        if (arg >= record.argCount) {
+            length = snprintf(piece, sizeof(piece), "<missing>");
+        } else {
+            const auto &value = record.args[arg];
+            switch (record.argTypes[arg]) {
+            case LogRecord::Int:
+            case LogRecord::Unsigned:
+                if (std::strchr("diuxXoc", conversion)) {
+                    spec += conversion == 'c' ? "c" : std::string("ll") + conversion;
+                    length = conversion == 'c' ? snprintf(piece, sizeof(piece), spec.c_str(), static_cast<int>(value.i))
+                                               : snprintf(piece, sizeof(piece), spec.c_str(), value.i);
+                } else {
+                    length = snprintf(piece, sizeof(piece), "%lld", static_cast<long long>(value.i));
+                }
+                break;
+            case LogRecord::Double:
+                spec += std::strchr("fFeEgGaA", conversion) ? conversion : 'g';
+                length = snprintf(piece, sizeof(piece), spec.c_str(), value.d);
+                break;
+            case LogRecord::String:
+                spec += 's';
+                length = snprintf(piece, sizeof(piece), spec.c_str(), record.strings + value.stringOffset);
+                break;
+            case LogRecord::Pointer:
+                length = snprintf(piece, sizeof(piece), "%p", value.p);
+                break;
+            }
+        }
+        append(piece, std::min<size_t>(std::max(length, 0), sizeof(piece) - 1));
+        ++arg;
+    }
+
+    line[used++] = '\n';
+    fwrite(line, 1, used, output);
+}
@@ -0,0 +1,177 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Asynchronous logger for the scan path.
+ *
+ *   LOG_DEBUG("REQA status %d after %u retries", status, retries);
+ *
+ * A call below LOG_MIN_LEVEL compiles to nothing: the arguments are not even evaluated.
+ * Enabled calls copy the format pointer (must be a string literal) and up to LOG_MAX_ARGS
+ * integers, doubles or strings into a fixed-size record (120 bytes) in a single-producer ring owned
+ * by the calling thread; no lock, no allocation and no I/O. A background thread formats the
+ * records printf-style, writes them to stderr (or a file) and folds repeats of the same call
+ * site beyond LOG_BURST per second into one "suppressed" line. A full ring drops the record
+ * and counts it instead of blocking the caller.
+ */
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#ifdef QT_NO_DEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define LOG_MAX_ARGS 6
+#define LOG_STRING_BYTES 40 // Room for copied string arguments in one record
+#define LOG_BURST 5         // Records per call site and second before repeats are suppressed
+
+#define LOG_AT(level, format, ...)                                        \
+    do {                                                                  \
+        if constexpr ((level) >= LOG_MIN_LEVEL) {                         \
+            Logger::instance().log((level), format, ##__VA_ARGS__);       \
+        }                                                                 \
+    } while (0)
+
+#define LOG_DEBUG(format, ...) LOG_AT(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...)  LOG_AT(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...)  LOG_AT(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) LOG_AT(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+
+struct LogRecord {
+    enum ArgType : uint8_t { Int, Unsigned, Double, String, Pointer };
+
+    uint64_t timestampNs;
+    const char *format;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t stringBytes;
+    uint8_t argTypes[LOG_MAX_ARGS];
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void *p;
+        uint16_t stringOffset;
+    } args[LOG_MAX_ARGS];
+    char strings[LOG_STRING_BYTES];
+};
+
+// Fixed-capacity single-producer single-consumer ring of records
+class LogRing {
+public:
+    static constexpr uint32_t CAPACITY = 1024; // Power of two
+
+    bool push(const LogRecord &record);
+    bool pop(LogRecord *record);
+
+    std::atomic<bool> abandoned{false}; // Producer thread ended; freed once drained
+    std::atomic<uint64_t> dropped{0};
+
+private:
+    LogRecord records[CAPACITY];
+    alignas(64) std::atomic<uint32_t> head{0}; // Next write, owned by the producer
+    alignas(64) std::atomic<uint32_t> tail{0}; // Next read, owned by the consumer
+};
+
+class Logger {
+public:
+    static Logger &instance();
+
+    void setOutput(FILE *stream) { output = stream; } // stderr by default, for journald
+    void flush();                                     // Waits until everything logged so far is written
+    uint64_t droppedRecords() const { return totalDropped.load(std::memory_order_relaxed); } // Reported so far
+
+    template <typename... Args>
+    void log(int level, const char *format, const Args &...args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+        LogRecord record;
+        record.timestampNs = now();
+        record.format = format;
+        record.level = static_cast<uint8_t>(level);
+        record.argCount = 0;
+        record.stringBytes = 0;
+        (capture(record, args), ...);
+        submit(record);
+    }
+
+private:
+    Logger();
+    ~Logger();
+
+    template <typename T>
+    static void capture(LogRecord &record, const T &value) {
+        uint8_t index = record.argCount++;
+        if constexpr (std::is_floating_point_v<T>) {
+            record.argTypes[index] = LogRecord::Double;
+            record.args[index].d = value;
+        } else if constexpr (std::is_enum_v<T>) {
+            record.argTypes[index] = LogRecord::Int;
+            record.args[index].i = static_cast<int64_t>(value);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            record.argTypes[index] = LogRecord::Int;
+            record.args[index].i = value;
+        } else if constexpr (std::is_integral_v<T>) {
+            record.argTypes[index] = LogRecord::Unsigned;
+            record.args[index].u = value;
+        } else if constexpr (std::is_convertible_v<T, const char *>) {
+            captureString(record, index, value);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            captureString(record, index, value.c_str());
+        } else {
+            static_assert(std::is_pointer_v<T>, "unsupported log argument type");
+            record.argTypes[index] = LogRecord::Pointer;
+            record.args[index].p = value;
+        }
+    }
+
+    static void captureString(LogRecord &record, uint8_t index, const char *value);
+    static uint64_t now();
+
+    void submit(const LogRecord &record);
+    LogRing *ringForThisThread();
+    void run();
+    bool drain();
+    void write(const LogRecord &record);
+    bool reportSuppressed(uint64_t nowNs, bool all); // Windows that ended, or every site with all
+
+    struct SiteState {
+        const char *format;
+        uint64_t windowStartNs;
+        uint32_t count;
+        uint32_t suppressed;
+        uint8_t level;
+    };
+
+    void writeSuppressed(SiteState &site);
+
+    std::mutex ringsMutex;          // Only taken when a thread logs for the first time
+    std::vector<LogRing *> rings;
+    std::vector<SiteState> sites;   // Consumer only
+    FILE *output;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> flushRequests;
+    std::atomic<uint64_t> flushesDone;
+    std::atomic<uint64_t> totalDropped;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::thread worker;
+};
+
+#endif // LOGGER_H
@@ -1,18 +1,57 @@
 #include "mainwindow.h"
+#include "appoptions.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QMessageBox>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
 #include <wiringPi.h>
 #include <gpiomanager.h>
 
 int main(int argc, char *argv[])
 {
+ QElapsedTimer startup;
+ startup.start();
  QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    AppOptions options(parser);
+    QCommandLineOption benchOption("db-bench", "Benchmark common queries with the selected profile and exit.");
+    QCommandLineOption codecBenchOption("codec-bench", "Benchmark the MQTT payload codecs and exit.");
+    parser.addOption(benchOption);
+    parser.addOption(codecBenchOption);
+    parser.process(a);
+
+    if (parser.isSet(codecBenchOption)) {
+        benchmarkCodecs();
+        return 0;
+    }
+
+    if (options.aggregate()) {
+        return options.runAggregator();
+    }
+
     MainWindow w;
-    w.connectToDatabase(); // Call the connection to the database after the window is shown
+    if (parser.isSet(benchOption)) {
+        w.connectToDatabase(options.databaseProfile());
+        w.getDatabaseManager()->benchmarkQueries();
+        return 0;
+    }
+    options.configureController(w.getDoorController());
+    if (options.backups()) {
+        w.enableBackups(options.backupDirectory(), options.backupIntervalMinutes(), options.compressBackups());
+    }
+    if (!options.startReplay(w.getDoorController())) {
+        return 1;
+    }
     w.show(); // Displays Widgets
+    w.getDoorController()->start(options.databaseProfile(), startup); // Database, broker and scanner in parallel
+    QTimer::singleShot(0, &w, [&startup]() { DoorController::reportStartup("gui", startup.elapsed()); });
     return a.exec();
 }
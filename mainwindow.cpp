@@ -1,7 +1,8 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "databasedialog.h"
-#include "mqttmanager.h"
+#include "metrics.h"
+#include "logger.h"
 
 #include <QSqlDatabase>
 #include <QSqlError>
@@ -16,21 +17,28 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , mqttManager(new MqttManager("", 1883, this))
-    , rfidProcess(new QProcess(this))  // Initialize QProcess
+    , doorController(new DoorController(this))
+    , scanFeed(new ScanFeedModel(500, this))
+    , refreshTimer(new QTimer(this))
 {
     ui->setupUi(this);
+    ui->scanFeed->setModel(scanFeed);
+
+    // One-shot, armed by the first change after a repaint, so an idle window never wakes up
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(33);
+    connect(refreshTimer, &QTimer::timeout, this, &MainWindow::refreshUi);
+
     setupMqtt();  // Set up MQTT connections
 
 /***************************************RFID START***********************************************************************/
 
-    // Connect the process signals for output handling
-    connect(rfidProcess, &QProcess::readyReadStandardOutput, this, &MainWindow::handleRFIDOutput);
-    connect(rfidProcess, &QProcess::readyReadStandardError, this, &MainWindow::handleRFIDError);
-    connect(rfidProcess, &QProcess::finished, this, &MainWindow::handleProcessFinished);
+    // Show what the scanner reads and what was decided
+    connect(doorController, &DoorController::scannerOutput, this, &MainWindow::handleScannerOutput);
+    connect(doorController, &DoorController::scanDecided, this, &MainWindow::handleScanDecided);
+    connect(doorController, &DoorController::databaseOpened, this, &MainWindow::showDatabaseStatus);
 
-    // Start the RFID scanning
-    startRFIDPolling();
+    // The scanner, database and broker are started by main() once the window is shown
 
 /***************************************RFID END*************************************************************************/
 
@@ -40,45 +48,57 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->openDatabaseButton, &QPushButton::clicked, this, &MainWindow::openDatabaseDialog);
 
     // Monitor MQTT connection state and update the UI
-    connect(mqttManager->getClient(), &QMqttClient::stateChanged, this, [this](QMqttClient::ClientState state) {
+    connect(getMqttManager()->getClient(), &QMqttClient::stateChanged, this, [this](QMqttClient::ClientState state) {
     updateConnectionStatus(state == QMqttClient::Connected);
     setFocus();
     });
 }
 
 MainWindow::~MainWindow() {
-    delete mqttManager;  // Clean up the mqttManager
-    delete ui;
-    if (rfidProcess->state() == QProcess::Running) {
-        rfidProcess->terminate();
-        if (!rfidProcess->waitForFinished(3000)) {  // Wait up to 3 seconds
-            rfidProcess->kill();  // Force kill if necessary
-        }
-    }
-    delete rfidProcess;
     delete ui;
 }
 
 
-void MainWindow::connectToDatabase() {
-    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("test.db");
+void MainWindow::connectToDatabase(const QString &profileName) {
+    showDatabaseStatus(doorController->openDatabase(profileName));
+}
 
-    if (!db.open()) {
-        qDebug() << "Error: Unable to open SQLite database." << db.lastError().text();
+void MainWindow::showDatabaseStatus(bool connected) {
+    if (!connected) {
         ui->statuslabel->setText("Disconnected from SQLite");
         ui->statuslabel->setStyleSheet("color: red;");
     } else {
-        qDebug() << "Successfully connected to the SQLite database!";
         ui->statuslabel->setText("Connected to SQLite");
         ui->statuslabel->setStyleSheet("color: green;");
     }
+}
+
+void MainWindow::enableBackups(const QString &directory, int intervalMinutes, bool compress) {
+    if (!doorController->isDatabaseOpen()) {
+        // Startup opens the database in the background; schedule once it is there
+        connect(doorController, &DoorController::databaseOpened, this,
+                [this, directory, intervalMinutes, compress](bool ok) {
+            if (ok) {
+                enableBackups(directory, intervalMinutes, compress);
+            }
+        }, Qt::SingleShotConnection);
+        return;
+    }
+    DatabaseBackup *databaseBackup = doorController->enableBackups(directory, intervalMinutes, compress);
+    if (!databaseBackup) {
+        return;
+    }
 
-    QSqlQuery query;
-    query.exec("CREATE TABLE IF NOT EXISTS people ("
-               "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-               "name TEXT, "
-               "age INTEGER)");
+    // Show backup state in the status bar
+    connect(databaseBackup, &DatabaseBackup::started, this, [this](const QString &) {
+        ui->statusbar->showMessage("Backup running...");
+    });
+    connect(databaseBackup, &DatabaseBackup::progress, this, [this](int copied, int total) {
+        ui->statusbar->showMessage(QString("Backup %1%").arg(total > 0 ? copied * 100 / total : 0));
+    });
+    connect(databaseBackup, &DatabaseBackup::finished, this, [this](bool ok, const QString &, qint64 durationMs) {
+        ui->statusbar->showMessage(ok ? QString("Backup done in %1 ms").arg(durationMs) : "Backup failed", 10000);
+    });
 }
 
 void MainWindow::openDatabaseDialog() {
@@ -88,17 +108,39 @@ void MainWindow::openDatabaseDialog() {
 }
 
 void MainWindow::setupMqtt() {
-    connect(mqttManager, &MqttManager::messageReceived, this, &MainWindow::handleIncomingMessage);
-    connect(mqttManager->getClient(), &QMqttClient::stateChanged, this, [this](QMqttClient::ClientState state) {
+    connect(getMqttManager(), &MqttManager::messageReceived, this, &MainWindow::handleIncomingMessage);
+    connect(getMqttManager()->getClient(), &QMqttClient::stateChanged, this, [this](QMqttClient::ClientState state) {
         updateConnectionStatus(state == QMqttClient::Connected);
     });
-
-    mqttManager->connectToBroker();
 }
 
 void MainWindow::handleIncomingMessage(const QString &message, const QMqttTopicName &topic) {
-    qDebug() << "Received message:" << message << "on topic:" << topic.name();
-    ui->messageLabel->setText(message);  // Update messageLabel with new message
+    // Per message, so through the logger ring rather than a synchronous qDebug
+    LOG_DEBUG("Received message on %s: %s", qPrintable(topic.name()), qPrintable(message));
+    showMessage(message);  // Update messageLabel with new message
+    scanFeed->post(topic.name() + ": " + message);
+}
+
+void MainWindow::showMessage(const QString &message) {
+    latestMessage = message;
+    scheduleRefresh();
+}
+
+void MainWindow::scheduleRefresh() {
+    if (!refreshTimer->isActive()) {
+        refreshTimer->start();
+    }
+}
+
+void MainWindow::refreshUi() {
+    static MetricCounter *frames = MetricsRegistry::instance().counter("rfid_gui_frames_total",
+                                                                       "Coalesced GUI repaints");
+    frames->inc();
+    // Only the latest state is painted; everything in between went to the feed
+    if (ui->messageLabel->text() != latestMessage) {
+        ui->messageLabel->setText(latestMessage);
+    }
+    scanFeed->flush();
 }
 
 void MainWindow::updateConnectionStatus(bool connected) {
@@ -117,19 +159,8 @@ void MainWindow::connectToMqttWithIpInput() {
                                        tr("Enter MQTT Broker IP:"), QLineEdit::Normal,
                                        "", &ok);
     if (ok && !ip.isEmpty()) {
-        mqttManager->getClient()->setHostname(ip); // Update MQTT client hostname
-        mqttManager->connectToBroker(); // Connect to the new broker IP
-    }
-}
-
-void MainWindow::startRFIDPolling() {
-    if (rfidProcess->state() == QProcess::NotRunning) {
-        rfidProcess->start("python3", QStringList() << "/home/nick/Downloads/RFID-Database/RFIDScan.py");
-        if (!rfidProcess->waitForStarted()) {
-            qDebug() << "Failed to start RFID scanning process.";
-        } else {
-            qDebug() << "RFID scanning process started successfully.";
-        }
+        getMqttManager()->getClient()->setHostname(ip); // Update MQTT client hostname
+        getMqttManager()->connectToBroker(); // Connect to the new broker IP
     }
 }
 
@@ -140,36 +171,20 @@ void MainWindow::pollRFID() {
 
     QString output = process.readAllStandardOutput().trimmed();
     if (!output.isEmpty()) {
-        ui->messageLabel->setText("Tag UID: " + output);  // Update the QLabel with the UID
+        showMessage("Tag UID: " + output);  // Update the QLabel with the UID
         qDebug() << "Detected RFID Tag UID:" << output;
     }
 }
 
-void MainWindow::handleRFIDOutput() {
-    QString output = rfidProcess->readAllStandardOutput().trimmed();
-    if (!output.isEmpty()) {
-        // Update the label with the detected UID
-        ui->messageLabel->setText("Tag UID: " + output);
-        // Print the output to the debug console
-        qDebug() << "Detected RFID Tag UID:" << output;
-    }
-}
-
-void MainWindow::handleProcessFinished(int exitCode, QProcess::ExitStatus exitStatus) {
-    qDebug() << "RFID process finished with code" << exitCode << "and status" << exitStatus;
-    // Optionally restart the process if it unexpectedly stops
-    if (exitStatus == QProcess::CrashExit) {
-        qDebug() << "RFID process crashed. Restarting...";
-        startRFIDPolling();
-    }
+void MainWindow::handleScannerOutput(const QString &output) {
+    // Update the label with the detected UID
+    showMessage("Tag UID: " + output);
 }
 
-void MainWindow::handleRFIDError() {
-    QString error = rfidProcess->readAllStandardError().trimmed();
-    if (!error.isEmpty()) {
-        // Print the error to the debug console
-        qDebug() << "RFID scanning process error:" << error;
-    }
+void MainWindow::handleScanDecided(const QString &uidHex, bool granted) {
+    QString text = QString("Tag UID: %1 - %2").arg(uidHex, granted ? "Access granted" : "Access denied");
+    showMessage(text);
+    scanFeed->post(text, granted ? FeedEntry::Granted : FeedEntry::Denied);
 }
 
 void MainWindow::startRFIDPythonScript() {
@@ -183,22 +198,27 @@ void MainWindow::startRFIDPythonScript() {
     // Connect to QProcess signals to capture output
     connect(process, &QProcess::readyReadStandardOutput, [process, this]() {
         QString output = process->readAllStandardOutput();
-        qDebug() << "Python Output:" << output; // Log output to the console
-        // Optional: append to a QTextEdit or QLabel in the UI
-        ui->textEdit->append(output);
+        LOG_DEBUG("Python output: %s", qPrintable(output));
+        for (const QString &line : output.split('\n', Qt::SkipEmptyParts)) {
+            scanFeed->post(line.trimmed());
+        }
+        scheduleRefresh();
     });
 
     connect(process, &QProcess::readyReadStandardError, [process, this]() {
         QString error = process->readAllStandardError();
-        qDebug() << "Python Error:" << error; // Log errors to the console
-        // Optional: append to a QTextEdit or QLabel in the UI
-        ui->textEdit->append(error);
+        LOG_DEBUG("Python error: %s", qPrintable(error));
+        for (const QString &line : error.split('\n', Qt::SkipEmptyParts)) {
+            scanFeed->post(line.trimmed(), FeedEntry::Denied);
+        }
+        scheduleRefresh();
     });
 
     // Start the process and check if it starts successfully
     process->start();
     if (!process->waitForStarted()) {
         qDebug() << "Failed to start Python script.";
-        ui->textEdit->append("Failed to start Python script.");
+        scanFeed->post("Failed to start Python script.", FeedEntry::Denied);
+        scheduleRefresh();
     }
 }
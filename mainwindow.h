@@ -6,7 +6,8 @@
 #include <QDebug>
 #include <QProcess>
 
-#include "mqttmanager.h"
+#include "doorcontroller.h"
+#include "scanfeedmodel.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -21,25 +22,34 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
-    void connectToDatabase();
+    void connectToDatabase(const QString &profileName = QString());
+    DoorController *getDoorController() const { return doorController; }
+    DatabaseManager *getDatabaseManager() const { return doorController->getDatabaseManager(); }
+    AccessControl *getAccessControl() const { return doorController->getAccessControl(); }
+    MqttManager *getMqttManager() const { return doorController->getMqttManager(); }
+    void enableBackups(const QString &directory, int intervalMinutes, bool compress);
 
 private slots:
     void openDatabaseDialog();
     void handleIncomingMessage(const QString &message, const QMqttTopicName &topic);
     void connectToMqttWithIpInput();
-    void startRFIDPolling();
     void pollRFID();
-    void handleRFIDOutput();
-    void handleProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
-    void handleRFIDError();
+    void handleScannerOutput(const QString &output);
+    void handleScanDecided(const QString &uidHex, bool granted);
     void startRFIDPythonScript();
+    void refreshUi();
+    void showDatabaseStatus(bool connected);
 
 private:
     Ui::MainWindow *ui;
     void updateConnectionStatus(bool connected);
+    void showMessage(const QString &message); // Shown on the next frame, not immediately
+    void scheduleRefresh();
     void setupMqtt(); // Declare the setupMqtt method
-    MqttManager *mqttManager;
-    QProcess *rfidProcess;
+    DoorController *doorController; // Scanner, database and MQTT; the window only displays them
+    ScanFeedModel *scanFeed;
+    QTimer *refreshTimer; // Caps repaints at ~30 per second however fast scans arrive
+    QString latestMessage;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,161 @@
+#include "metrics.h"
+#include <QSet>
+#include <algorithm>
+
+// "base{a=\"b\"}" -> family "base", labels "a=\"b\""
+static void splitName(const QString &name, QString *family, QString *labels) {
+    int brace = name.indexOf('{');
+    if (brace < 0) {
+        *family = name;
+        labels->clear();
+        return;
+    }
+    *family = name.left(brace);
+    *labels = name.mid(brace + 1, name.size() - brace - 2);
+}
+
+static QString withLabel(const QString &family, const QString &labels, const QString &suffix, const QString &extra) {
+    QString all = labels;
+    if (!extra.isEmpty()) {
+        all += (all.isEmpty() ? "" : ",") + extra;
+    }
+    return family + suffix + (all.isEmpty() ? QString() : "{" + all + "}");
+}
+
+MetricsRegistry &MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Metric *MetricsRegistry::find(const QString &name, Type type) {
+    for (const std::unique_ptr<Metric> &metric : metrics) {
+        if (metric->name == name && metric->type == type) {
+            return metric.get();
+        }
+    }
+    return nullptr;
+}
+
+MetricsRegistry::Metric *MetricsRegistry::add(const QString &name, const QString &help, Type type) {
+    metrics.push_back(std::make_unique<Metric>());
+    Metric *metric = metrics.back().get();
+    metric->name = name;
+    metric->help = help;
+    metric->type = type;
+    return metric;
+}
+
+MetricCounter *MetricsRegistry::counter(const QString &name, const QString &help) {
+    QMutexLocker locker(&mutex);
+    Metric *metric = find(name, Counter);
+    if (!metric || !metric->counter) {
+        metric = add(name, help, Counter);
+        metric->counter = std::make_unique<MetricCounter>();
+    }
+    return metric->counter.get();
+}
+
+MetricGauge *MetricsRegistry::gauge(const QString &name, const QString &help) {
+    QMutexLocker locker(&mutex);
+    Metric *metric = find(name, Gauge);
+    if (!metric || !metric->gauge) {
+        metric = add(name, help, Gauge);
+        metric->gauge = std::make_unique<MetricGauge>();
+    }
+    return metric->gauge.get();
+}
+
+LatencyHistogram *MetricsRegistry::histogram(const QString &name, const QString &help) {
+    QMutexLocker locker(&mutex);
+    Metric *metric = find(name, Histogram);
+    if (!metric || !metric->ownedHistogram) {
+        metric = add(name, help, Histogram);
+        metric->ownedHistogram = std::make_unique<LatencyHistogram>();
+        metric->histogram = metric->ownedHistogram.get();
+    }
+    return metric->ownedHistogram.get();
+}
+
+void MetricsRegistry::addHistogram(const QString &name, const QString &help, const LatencyHistogram *histogram,
+                                   const void *owner) {
+    QMutexLocker locker(&mutex);
+    Metric *metric = add(name, help, Histogram);
+    metric->histogram = histogram;
+    metric->owner = owner;
+}
+
+void MetricsRegistry::addCallback(const QString &name, const QString &help, Type type, std::function<double()> sample,
+                                  const void *owner) {
+    QMutexLocker locker(&mutex);
+    Metric *metric = add(name, help, type);
+    metric->sample = std::move(sample);
+    metric->owner = owner;
+}
+
+void MetricsRegistry::removeOwner(const void *owner) {
+    QMutexLocker locker(&mutex);
+    metrics.erase(std::remove_if(metrics.begin(), metrics.end(),
+                                 [owner](const std::unique_ptr<Metric> &metric) { return metric->owner == owner; }),
+                  metrics.end());
+}
+
+QByteArray MetricsRegistry::prometheusText() const {
+    QMutexLocker locker(&mutex);
+    QByteArray text;
+    text.reserve(8192);
+    QSet<QString> described;
+
+    for (const std::unique_ptr<Metric> &metric : metrics) {
+        QString family;
+        QString labels;
+        splitName(metric->name, &family, &labels);
+        if (!described.contains(family)) {
+            described.insert(family);
+            static const char *types[] = {"counter", "gauge", "summary"};
+            text += "# HELP " + family.toUtf8() + ' ' + metric->help.toUtf8() + '\n';
+            text += "# TYPE " + family.toUtf8() + ' ' + types[metric->type] + '\n';
+        }
+
+        if (metric->type == Histogram) {
+            // Exported as a summary in seconds; the buckets stay internal
+            const LatencyHistogram &histogram = *metric->histogram;
+            for (double quantile : LatencyHistogram::QUANTILES) {
+                text += withLabel(family, labels, "", QString("quantile=\"%1\"").arg(quantile)).toUtf8() + ' '
+                        + QByteArray::number(histogram.percentile(quantile) / 1e9, 'g', 6) + '\n';
+            }
+            text += withLabel(family, labels, "_sum", QString()).toUtf8() + ' '
+                    + QByteArray::number(histogram.sum() / 1e9, 'g', 9) + '\n';
+            text += withLabel(family, labels, "_count", QString()).toUtf8() + ' '
+                    + QByteArray::number(histogram.count()) + '\n';
+            continue;
+        }
+
+        double value = metric->sample ? metric->sample()
+                       : metric->counter ? static_cast<double>(metric->counter->get())
+                                         : static_cast<double>(metric->gauge->get());
+        text += metric->name.toUtf8() + ' ' + QByteArray::number(value, 'g', 15) + '\n';
+    }
+    return text;
+}
+
+QJsonObject MetricsRegistry::snapshot() const {
+    QMutexLocker locker(&mutex);
+    QJsonObject values;
+    for (const std::unique_ptr<Metric> &metric : metrics) {
+        if (metric->type == Histogram) {
+            const LatencyHistogram &histogram = *metric->histogram;
+            values.insert(metric->name, QJsonObject{{"count", static_cast<qint64>(histogram.count())},
+                                                    {"p50_ms", histogram.percentile(0.5) / 1e6},
+                                                    {"p99_ms", histogram.percentile(0.99) / 1e6},
+                                                    {"p999_ms", histogram.percentile(0.999) / 1e6},
+                                                    {"max_ms", histogram.max() / 1e6}});
+        } else if (metric->sample) {
+            values.insert(metric->name, metric->sample());
+        } else if (metric->counter) {
+            values.insert(metric->name, static_cast<qint64>(metric->counter->get()));
+        } else {
+            values.insert(metric->name, static_cast<qint64>(metric->gauge->get()));
+        }
+    }
+    return values;
+}
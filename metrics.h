@@ -0,0 +1,84 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "latencyhistogram.h"
+
+// Monotonic count; inc() is one relaxed atomic add, safe from any thread including the ISR
+class MetricCounter {
+public:
+    void inc(quint64 n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    quint64 get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> value{0};
+};
+
+// Value that goes up and down, e.g. a queue depth
+class MetricGauge {
+public:
+    void set(qint64 v) { value.store(v, std::memory_order_relaxed); }
+    void add(qint64 delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+    qint64 get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> value{0};
+};
+
+/**
+ * Process-wide registry. Registration takes a mutex and returns a pointer that stays valid
+ * for the life of the process, so hot paths look a metric up once and keep it:
+ *
+ *   static MetricCounter *scans = MetricsRegistry::instance().counter("rfid_scans_total", "Scans decided");
+ *   scans->inc();
+ *
+ * Names may carry Prometheus labels, e.g. rfid_stage_latency_seconds{stage="decided"}.
+ * Existing stats structs are exported through callbacks sampled at export time; they are
+ * registered with an owner and must be removed before the owner goes away.
+ */
+class MetricsRegistry {
+public:
+    enum Type { Counter, Gauge, Histogram };
+
+    static MetricsRegistry &instance();
+
+    MetricCounter *counter(const QString &name, const QString &help);
+    MetricGauge *gauge(const QString &name, const QString &help);
+    LatencyHistogram *histogram(const QString &name, const QString &help);
+    void addHistogram(const QString &name, const QString &help, const LatencyHistogram *histogram, const void *owner);
+    void addCallback(const QString &name, const QString &help, Type type, std::function<double()> sample,
+                     const void *owner);
+    void removeOwner(const void *owner);
+
+    QByteArray prometheusText() const; // Text exposition format 0.0.4
+    QJsonObject snapshot() const;      // Flat name -> value, histograms as p50/p99/p999/count
+
+private:
+    struct Metric {
+        QString name;
+        QString help;
+        Type type;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<LatencyHistogram> ownedHistogram;
+        const LatencyHistogram *histogram = nullptr;
+        std::function<double()> sample;
+        const void *owner = nullptr;
+    };
+
+    Metric *find(const QString &name, Type type);
+    Metric *add(const QString &name, const QString &help, Type type);
+
+    mutable QMutex mutex;
+    std::vector<std::unique_ptr<Metric>> metrics;
+};
+
+#endif // METRICS_H
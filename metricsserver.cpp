@@ -0,0 +1,46 @@
+#include "metricsserver.h"
+#include "metrics.h"
+#include <QTcpSocket>
+#include <QDebug>
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent)
+    , server(new QTcpServer(this))
+{
+    connect(server, &QTcpServer::newConnection, this, &MetricsServer::acceptConnection);
+}
+
+bool MetricsServer::listen(const QHostAddress &address, quint16 port) {
+    if (!server->listen(address, port)) {
+        qDebug() << "Metrics endpoint unavailable on port" << port << ":" << server->errorString();
+        return false;
+    }
+    qDebug() << "Serving metrics on" << address.toString() << "port" << server->serverPort();
+    return true;
+}
+
+void MetricsServer::acceptConnection() {
+    while (QTcpSocket *socket = server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+            // Only the request line matters; wait until the headers are complete
+            QByteArray request = socket->peek(4096);
+            if (!request.contains("\r\n\r\n") && request.size() < 4096) {
+                return;
+            }
+            socket->readAll();
+
+            QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+            bool found = requestLine.size() >= 2 && requestLine.at(0) == "GET"
+                         && (requestLine.at(1) == "/metrics" || requestLine.at(1).startsWith("/metrics?"));
+            QByteArray body = found ? MetricsRegistry::instance().prometheusText() : QByteArray("Not found\n");
+            QByteArray response = found ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n";
+            response += found ? "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                              : "Content-Type: text/plain\r\n";
+            response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+            response += "Connection: close\r\n\r\n";
+            socket->write(response + body);
+            socket->disconnectFromHost();
+        });
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QTcpServer>
+
+// Minimal HTTP endpoint for Prometheus: GET /metrics returns MetricsRegistry::prometheusText(),
+// anything else a 404. One request per connection; the scrape is small and infrequent.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    bool listen(const QHostAddress &address, quint16 port);
+
+private slots:
+    void acceptConnection();
+
+private:
+    QTcpServer *server;
+};
+
+#endif // METRICSSERVER_H
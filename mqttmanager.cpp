@@ -1,19 +1,122 @@
 #include "mqttmanager.h"
+#include "metrics.h"
+#include "logger.h"
 #include <QDebug>
 #include <QtMqtt/QMqttClient>
+#include <QtMqtt/QMqttPublishProperties>
 #include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <vector>
+
+/**
+ * Packs rows into payloads no larger than maxBytes. Text batches look like
+ *   {"seq":<change seq>,"rows":[[id,"name",age],[id],...],"last":true}
+ * where a row with only an id means the person was deleted and "last" marks the final batch of
+ * a period. Binary batches carry the same information as PersonRows (see payloadcodec.h).
+ */
+class BatchWriter {
+public:
+    BatchWriter(MqttManager *manager, const QString &topic, qint64 seq, int maxBytes, PayloadFormat format)
+        : messages(0), bytes(0), manager(manager), topic(topic), seq(seq), maxBytes(maxBytes), format(format)
+        , rowWriter(payload) {
+        header = QByteArray("{\"seq\":") + QByteArray::number(seq) + ",\"rows\":[";
+        start();
+    }
+
+    // Returns false for a row that would not fit maxBytes even in a batch of its own; such a row
+    // is left out rather than sent as an oversized batch
+    bool addRow(qint64 id, const QString &name, int age, bool deleted) {
+        if (format == PayloadFormat::Binary) {
+            QByteArray utf8Name = name.toUtf8();
+            int size = rowWriter.sizeWith(utf8Name);
+            if (rowWriter.count() > 0 && (size > maxBytes || rowWriter.count() == 0xFFFF)) {
+                send(false);
+                size = rowWriter.sizeWith(utf8Name);
+            }
+            if (size > maxBytes) {
+                return false;
+            }
+            rowWriter.append(id, age, deleted, utf8Name);
+            return true;
+        }
+
+        QJsonArray row{id};
+        if (!deleted) {
+            row.append(name);
+            row.append(age);
+        }
+        QByteArray encoded = QJsonDocument(row).toJson(QJsonDocument::Compact);
+        int closing = 14; // "],\"last\":true}", the longer of the two endings
+        if (payload.size() > header.size() && payload.size() + 1 + encoded.size() + closing > maxBytes) {
+            send(false);
+        }
+        if (header.size() + encoded.size() + closing > maxBytes) {
+            return false;
+        }
+        if (payload.size() > header.size()) {
+            payload.append(',');
+        }
+        payload.append(encoded);
+        return true;
+    }
+
+    void finish() {
+        send(true);
+    }
+
+    int messages;
+    qint64 bytes;
+
+private:
+    void start() {
+        if (format == PayloadFormat::Binary) {
+            rowWriter.reset(seq);
+        } else {
+            payload = header;
+            payload.reserve(maxBytes);
+        }
+    }
+
+    void send(bool last) {
+        if (format == PayloadFormat::Binary) {
+            rowWriter.setLast(last);
+        } else {
+            payload.append(last ? "],\"last\":true}" : "]}");
+        }
+        manager->publishPayload(topic, payload);
+        ++messages;
+        bytes += payload.size();
+        start();
+    }
+
+    MqttManager *manager;
+    QString topic;
+    qint64 seq;
+    int maxBytes;
+    PayloadFormat format;
+    QByteArray header;
+    QByteArray payload;
+    PersonRowWriter rowWriter;
+};
 
 MqttManager::MqttManager(const QString &host, quint16 port, QObject *parent)
-    : QObject(parent), client(new QMqttClient(this)) {
+    : QObject(parent), client(new QMqttClient(this)), publishTimer(new QTimer(this))
+    , lastPublishedSeq(-1), maxBatchBytes(32 * 1024), publishPeople(true), payloadFormat(PayloadFormat::Text) {
     client->setHostname(host);  // Set the MQTT broker host
     client->setPort(port);      // Set the MQTT broker port
 
     // Connect the message received signal
     connect(client, &QMqttClient::messageReceived, this, &MqttManager::onMessageReceived);
 
+    connect(publishTimer, &QTimer::timeout, this, &MqttManager::publishDatabaseData);
+
     // Connect the connected signal to the onConnected slot
     connect(client, &QMqttClient::connected, this, &MqttManager::onConnected);
 
+    static MetricCounter *disconnects = MetricsRegistry::instance().counter("rfid_mqtt_disconnects_total",
+                                                                            "Broker connections lost or closed");
     connect(client, &QMqttClient::stateChanged, this, [this](QMqttClient::ClientState state) {
         QString status;
         switch (state) {
@@ -25,6 +128,7 @@ MqttManager::MqttManager(const QString &host, quint16 port, QObject *parent)
             break;
         case QMqttClient::Disconnected:
             status = "Disconnected";
+            disconnects->inc();
             break;
         default:
             break;
@@ -34,6 +138,11 @@ MqttManager::MqttManager(const QString &host, quint16 port, QObject *parent)
 }
 
 void MqttManager::connectToBroker() {
+    if (publishPeople && !publishTimer->isActive()) {
+        // Runs from the start, not from the first CONNACK: ticks while offline prune
+        // people_changes, which would otherwise grow without bound on a door that boots offline
+        startPeriodicPublishing();
+    }
     client->connectToHost();
 }
 
@@ -41,6 +150,24 @@ void MqttManager::publishMessage(const QString &topic, const QString &message) {
     client->publish(topic, message.toUtf8());
 }
 
+void MqttManager::publishPayload(const QString &topic, const QByteArray &payload) {
+    publish(topic, payload, 0);
+}
+
+bool MqttManager::isConnected() const {
+    return client->state() == QMqttClient::Connected;
+}
+
+qint32 MqttManager::publish(const QString &topic, const QByteArray &payload, quint8 qos) {
+    if (client->protocolVersion() == QMqttClient::MQTT_5_0) {
+        // MQTT 5 subscribers can pick the decoder from the content type without sniffing (--mqtt5)
+        QMqttPublishProperties properties;
+        properties.setContentType(PayloadCodec::contentType(PayloadCodec::detectFormat(payload)));
+        return client->publish(QMqttTopicName(topic), properties, payload, qos);
+    }
+    return client->publish(QMqttTopicName(topic), payload, qos);
+}
+
 void MqttManager::subscribeToTopic(const QString &topic) {
     auto result = client->subscribe(topic);
     if (result) {
@@ -50,27 +177,147 @@ void MqttManager::subscribeToTopic(const QString &topic) {
     }
 }
 
+void MqttManager::addRoute(const QString &filter, TopicHandler handler) {
+    router.addRoute(filter, std::move(handler));
+    if (isConnected()) {
+        subscribeToTopic(filter);
+    }
+}
+
 void MqttManager::onMessageReceived(const QByteArray &message, const QMqttTopicName &topic) {
-    qDebug() << "Message received on topic" << topic.name() << ":" << message;
-    emit messageReceived(QString(message), topic.name());
+    emit payloadReceived(message, topic);
+    if (router.route(topic, message) > 0) {
+        return; // Handled by a registered command handler
+    }
+    // Only text payloads are worth turning into a QString; binary ones stay raw
+    if (PayloadCodec::detectFormat(message) == PayloadFormat::Text) {
+        LOG_DEBUG("Message received on %s: %s", qPrintable(topic.name()), message.constData());
+        emit messageReceived(QString(message), topic.name());
+    }
 }
 
 void MqttManager::onConnected() {
+    static MetricCounter *connects = MetricsRegistry::instance().counter("rfid_mqtt_connects_total",
+                                                                         "Broker connections established");
+    connects->inc();
     qDebug() << "Connected to MQTT broker";
     subscribeToTopic("test/update");  // Subscribe to the "test/update" topic
-  //  startPeriodicPublishing(); // Start publishing once connected
+    for (const QString &filter : router.filters()) {
+        subscribeToTopic(filter);
+    }
+    if (publishPeople) {
+        resetSnapshot(); // A new session may have new subscribers, start from a full snapshot
+        if (!publishTimer->isActive()) {
+            startPeriodicPublishing(); // Keeps an interval set through config/publish-interval
+        }
+    }
 }
 
-void MqttManager::startPeriodicPublishing() {
-    publishTimer->start(60000); // Publish every 60 seconds
+void MqttManager::startPeriodicPublishing(int intervalMs) {
+    publishTimer->start(intervalMs); // Publish every 60 seconds by default
 }
 
 void MqttManager::publishDatabaseData() {
-    QSqlQuery query("SELECT * FROM people");  // Ensure your database connection is open
+    if (client->state() != QMqttClient::Connected) {
+        // The next session starts from a snapshot, so changes logged meanwhile are never sent;
+        // dropping them keeps people_changes bounded while the broker is away
+        pruneChanges(currentChangeSeq());
+        resetSnapshot();
+        return;
+    }
+
+    qint64 bytes = 0;
+    int messages = lastPublishedSeq < 0 ? publishSnapshot(&bytes) : publishDelta(&bytes);
+    if (messages > 0) {
+        qDebug() << "Published people data in" << messages << "messages," << bytes << "bytes";
+    }
+}
+
+qint64 MqttManager::currentChangeSeq() {
+    QSqlQuery query("SELECT COALESCE(MAX(seq), 0) FROM people_changes");
+    return query.next() ? query.value(0).toLongLong() : 0;
+}
+
+void MqttManager::pruneChanges(qint64 upToSeq) {
+    QSqlQuery prune;
+    prune.prepare("DELETE FROM people_changes WHERE seq <= :seq");
+    prune.bindValue(":seq", upToSeq);
+    if (!prune.exec()) {
+        qDebug() << "Unable to prune people changes:" << prune.lastError().text();
+    }
+}
+
+void MqttManager::addRow(BatchWriter &writer, qint64 id, const QString &name, int age, bool deleted) {
+    static MetricCounter *oversized = MetricsRegistry::instance().counter(
+        "rfid_mqtt_oversized_rows_total", "People rows left out of a batch because they exceed the batch size");
+    if (!writer.addRow(id, name, age, deleted)) {
+        oversized->inc();
+        qDebug() << "Person" << id << "does not fit a" << maxBatchBytes << "byte batch, not published";
+    }
+}
+
+int MqttManager::publishSnapshot(qint64 *bytes) {
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction(); // Read the change seq and the rows from the same snapshot
+
+    qint64 seq = currentChangeSeq();
+    BatchWriter writer(this, "database/people/snapshot", seq, maxBatchBytes, payloadFormat);
+
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    query.exec("SELECT id, name, age FROM people");
+    while (query.next()) {
+        addRow(writer, query.value(0).toLongLong(), query.value(1).toString(), query.value(2).toInt(), false);
+    }
+    db.commit();
+
+    writer.finish();
+    pruneChanges(seq); // Everything up to seq is covered by the snapshot
+    lastPublishedSeq = seq;
+    *bytes = writer.bytes;
+    return writer.messages;
+}
+
+int MqttManager::publishDelta(qint64 *bytes) {
+    // Only the latest state of each person changed since the last period, deletions as bare ids
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    query.prepare("SELECT c.person_id, MAX(c.seq), p.id, p.name, p.age FROM people_changes c "
+                  "LEFT JOIN people p ON p.id = c.person_id "
+                  "WHERE c.seq > :seq GROUP BY c.person_id ORDER BY MAX(c.seq)");
+    query.bindValue(":seq", lastPublishedSeq);
+    if (!query.exec()) {
+        qDebug() << "Unable to read people changes:" << query.lastError().text();
+        return 0;
+    }
+
+    struct PersonChange {
+        qint64 id;
+        QString name;
+        int age;
+        bool deleted;
+    };
+    std::vector<PersonChange> rows;
+    qint64 seq = lastPublishedSeq;
     while (query.next()) {
-        QString name = query.value("name").toString();
-        int age = query.value("age").toInt();
-        QString message = QString("Name: %1, Age: %2").arg(name).arg(age);
-        publishMessage("database/people", message);
+        seq = qMax(seq, query.value(1).toLongLong());
+        rows.push_back({query.value(0).toLongLong(), query.value(3).toString(), query.value(4).toInt(),
+                        query.value(2).isNull()});
+    }
+    if (rows.empty()) {
+        return 0; // Nothing changed, nothing sent
     }
+
+    BatchWriter writer(this, "database/people/delta", seq, maxBatchBytes, payloadFormat);
+    for (const PersonChange &row : rows) {
+        addRow(writer, row.id, row.name, row.age, row.deleted);
+    }
+    writer.finish();
+
+    // Published changes are no longer needed; a reconnect starts from a snapshot anyway
+    pruneChanges(seq);
+
+    lastPublishedSeq = seq;
+    *bytes = writer.bytes;
+    return writer.messages;
 }
@@ -8,20 +8,38 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 
-class MqttManager : public QObject {
+#include "scanpublisher.h"
+#include "payloadcodec.h"
+#include "topicrouter.h"
+
+class BatchWriter;
+
+class MqttManager : public QObject, public PublishTransport {
     Q_OBJECT
 
 public:
     explicit MqttManager(const QString &host, quint16 port, QObject *parent = nullptr);
     void connectToBroker();
     void publishMessage(const QString &topic, const QString &message);
+    void publishPayload(const QString &topic, const QByteArray &payload);
     void subscribeToTopic(const QString &topic);
-    void startPeriodicPublishing();
+    void startPeriodicPublishing(int intervalMs = 60000);
+    void setMaxBatchBytes(int bytes) { maxBatchBytes = bytes; }
+    void resetSnapshot() { lastPublishedSeq = -1; } // Next period publishes the full table again
+    void setPublishPeople(bool enabled) { publishPeople = enabled; } // Periodic people batches on connect
+    void setPayloadFormat(PayloadFormat format) { payloadFormat = format; }
+    PayloadFormat getPayloadFormat() const { return payloadFormat; }
     QMqttClient* getClient() const { return client; }
+    void addRoute(const QString &filter, TopicHandler handler); // Subscribes now or on connect
+
+    // PublishTransport, used by ScanPublisher
+    bool isConnected() const override;
+    qint32 publish(const QString &topic, const QByteArray &payload, quint8 qos) override;
 
 signals: // Add this signals section
     void messageReceived(const QString &message, const QMqttTopicName &topic); // Signal declaration
     void statusChanged(const QString &status);
+    void payloadReceived(const QByteArray &payload, const QMqttTopicName &topic); // Every message, undecoded
 
 private slots:
     void onMessageReceived(const QByteArray &message, const QMqttTopicName &topic); // Updated parameter type
@@ -29,8 +47,19 @@ private slots:
     void publishDatabaseData(); // Periodic publishing function
 
 private:
+    int publishSnapshot(qint64 *bytes);
+    int publishDelta(qint64 *bytes);
+    qint64 currentChangeSeq();
+    void pruneChanges(qint64 upToSeq);
+    void addRow(BatchWriter &writer, qint64 id, const QString &name, int age, bool deleted);
+
     QMqttClient *client; // Pointer to the MQTT client
     QTimer *publishTimer; // The timer for publishing data
+    qint64 lastPublishedSeq; // Highest people_changes.seq already published, -1 before the first snapshot
+    int maxBatchBytes; // Upper bound for one batch payload, rows that cannot fit are skipped
+    bool publishPeople; // False on an aggregator, which only consumes
+    PayloadFormat payloadFormat; // Text (JSON) or binary for database batches and scan events
+    TopicRouter router; // Inbound command handlers, dispatched before anything reaches the GUI
 };
 
 #endif // MQTTMANAGER_H
@@ -0,0 +1,154 @@
+#include "ndef.h"
+#include <cstring>
+
+#define TLV_NULL        0x00
+#define TLV_NDEF        0x03
+#define TLV_TERMINATOR  0xFE
+
+#define NDEF_FLAG_MB    0x80
+#define NDEF_FLAG_ME    0x40
+#define NDEF_FLAG_CF    0x20
+#define NDEF_FLAG_SR    0x10
+#define NDEF_FLAG_IL    0x08
+
+bool NdefBytes::equals(const char *text) const {
+    size_t length = strlen(text);
+    return length == size && memcmp(data, text, length) == 0;
+}
+
+bool ndefFindMessage(NdefBytes userMemory, NdefBytes *message) {
+    size_t offset = 0;
+    while (offset < userMemory.size) {
+        uint8_t tag = userMemory.data[offset++];
+        if (tag == TLV_NULL) {
+            continue; // Padding, no length field
+        }
+        if (tag == TLV_TERMINATOR) {
+            return false;
+        }
+        if (offset >= userMemory.size) {
+            return false;
+        }
+
+        // One length byte, or 0xFF and two big-endian bytes
+        size_t length = userMemory.data[offset++];
+        if (length == 0xFF) {
+            if (offset + 2 > userMemory.size) {
+                return false;
+            }
+            length = (size_t(userMemory.data[offset]) << 8) | userMemory.data[offset + 1];
+            offset += 2;
+        }
+        if (length > userMemory.size - offset) {
+            return false; // Claims more than was read
+        }
+        if (tag == TLV_NDEF) {
+            *message = NdefBytes(userMemory.data + offset, length);
+            return true;
+        }
+        offset += length; // Lock control, memory control, proprietary
+    }
+    return false;
+}
+
+NdefRecordReader::NdefRecordReader(NdefBytes message)
+    : message(message)
+    , offset(0)
+    , finished(message.size == 0)
+    , malformed(false)
+{
+}
+
+bool NdefRecordReader::next(NdefRecord *record) {
+    if (finished) {
+        return false;
+    }
+    const uint8_t *data = message.data;
+    size_t size = message.size;
+
+    // Header byte, type length, then 1 or 4 payload length bytes and an optional ID length
+    size_t position = offset;
+    if (size - position < 2) {
+        malformed = finished = true;
+        return false;
+    }
+    uint8_t flags = data[position++];
+    size_t typeLength = data[position++];
+    size_t payloadLength;
+    if (flags & NDEF_FLAG_SR) {
+        if (size - position < 1) {
+            malformed = finished = true;
+            return false;
+        }
+        payloadLength = data[position++];
+    } else {
+        if (size - position < 4) {
+            malformed = finished = true;
+            return false;
+        }
+        payloadLength = (size_t(data[position]) << 24) | (size_t(data[position + 1]) << 16)
+                        | (size_t(data[position + 2]) << 8) | data[position + 3];
+        position += 4;
+    }
+    size_t idLength = 0;
+    if (flags & NDEF_FLAG_IL) {
+        if (size - position < 1) {
+            malformed = finished = true;
+            return false;
+        }
+        idLength = data[position++];
+    }
+
+    // Each length is checked against what is left, so a corrupt field cannot overflow the sum
+    size_t left = size - position;
+    if (typeLength > left || idLength > left - typeLength || payloadLength > left - typeLength - idLength) {
+        malformed = finished = true;
+        return false;
+    }
+
+    record->tnf = flags & 0x07;
+    record->messageBegin = flags & NDEF_FLAG_MB;
+    record->messageEnd = flags & NDEF_FLAG_ME;
+    record->chunked = flags & NDEF_FLAG_CF;
+    record->type = NdefBytes(data + position, typeLength);
+    position += typeLength;
+    record->id = NdefBytes(data + position, idLength);
+    position += idLength;
+    record->payload = NdefBytes(data + position, payloadLength);
+    position += payloadLength;
+
+    offset = position;
+    finished = record->messageEnd || offset >= size;
+    return true;
+}
+
+bool ndefTextRecord(const NdefRecord &record, NdefBytes *language, NdefBytes *text) {
+    if (record.tnf != NDEF_TNF_WELL_KNOWN || !record.type.equals("T") || record.payload.size < 1) {
+        return false;
+    }
+    uint8_t status = record.payload.data[0];
+    size_t languageLength = status & 0x3F;
+    if ((status & 0x80) || languageLength > record.payload.size - 1) {
+        return false; // UTF-16, or a language code longer than the payload
+    }
+    *language = NdefBytes(record.payload.data + 1, languageLength);
+    *text = NdefBytes(record.payload.data + 1 + languageLength, record.payload.size - 1 - languageLength);
+    return true;
+}
+
+bool ndefUriRecord(const NdefRecord &record, const char **prefix, NdefBytes *rest) {
+    static const char *const prefixes[] = {
+        "", "http://www.", "https://www.", "http://", "https://", "tel:", "mailto:",
+        "ftp://anonymous:anonymous@", "ftp://ftp.", "ftps://", "sftp://", "smb://", "nfs://",
+        "ftp://", "dav://", "news:", "telnet://", "imap:", "rtsp://", "urn:", "pop:", "sip:",
+        "sips:", "tftp:", "btspp://", "btl2cap://", "btgoep://", "tcpobex://", "irdaobex://",
+        "file://", "urn:epc:id:", "urn:epc:tag:", "urn:epc:pat:", "urn:epc:raw:", "urn:epc:",
+        "urn:nfc:"};
+    if (record.tnf != NDEF_TNF_WELL_KNOWN || !record.type.equals("U") || record.payload.size < 1) {
+        return false;
+    }
+    uint8_t code = record.payload.data[0];
+    *prefix = code < sizeof(prefixes) / sizeof(prefixes[0]) ? prefixes[code] : "";
+    *rest = NdefBytes(record.payload.data + 1, record.payload.size - 1);
+    return true;
+}
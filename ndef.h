@@ -0,0 +1,73 @@
+#ifndef NDEF_H
+#define NDEF_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * NDEF over NFC Forum Type 2 tag memory (NTAG21x, Ultralight), parsed in place: every result
+ * is a view into the buffer the pages were read into, so that buffer has to outlive them.
+ * Nothing is copied or allocated, malformed lengths end the iteration instead of reading past
+ * the buffer.
+ *
+ *   NdefBytes message;
+ *   if (ndefFindMessage(NdefBytes(pages, size), &message)) {
+ *       NdefRecordReader records(message);
+ *       NdefRecord record;
+ *       while (records.next(&record)) { ... }
+ *   }
+ */
+
+// Non-owning view of bytes, std::span<const uint8_t> in spirit
+struct NdefBytes {
+    const uint8_t *data;
+    size_t size;
+
+    NdefBytes() : data(nullptr), size(0) {}
+    NdefBytes(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    bool equals(const char *text) const; // Byte-wise against a NUL-terminated string
+};
+
+// Type name format
+#define NDEF_TNF_EMPTY       0x00
+#define NDEF_TNF_WELL_KNOWN  0x01
+#define NDEF_TNF_MIME        0x02
+#define NDEF_TNF_URI         0x03
+#define NDEF_TNF_EXTERNAL    0x04
+#define NDEF_TNF_UNKNOWN     0x05
+#define NDEF_TNF_UNCHANGED   0x06
+
+struct NdefRecord {
+    uint8_t tnf;
+    bool messageBegin;
+    bool messageEnd;
+    bool chunked;        // Payload continues in the next record (TNF_UNCHANGED)
+    NdefBytes type;
+    NdefBytes id;
+    NdefBytes payload;
+};
+
+// Walks the TLV blocks of user memory (from page 4) to the first NDEF Message TLV
+bool ndefFindMessage(NdefBytes userMemory, NdefBytes *message);
+
+class NdefRecordReader {
+public:
+    explicit NdefRecordReader(NdefBytes message);
+
+    bool next(NdefRecord *record); // false at the end of the message or on a malformed record
+    bool failed() const { return malformed; }
+
+private:
+    NdefBytes message;
+    size_t offset;
+    bool finished;
+    bool malformed;
+};
+
+// Well-known "T" record: IANA language code and UTF-8 text (UTF-16 text is reported as false)
+bool ndefTextRecord(const NdefRecord &record, NdefBytes *language, NdefBytes *text);
+// Well-known "U" record: the abbreviated prefix ("https://" for 0x04, "" when none) and the rest
+bool ndefUriRecord(const NdefRecord &record, const char **prefix, NdefBytes *rest);
+
+#endif // NDEF_H
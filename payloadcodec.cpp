@@ -0,0 +1,325 @@
+#include "payloadcodec.h"
+#include <QtEndian>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <cstring>
+
+static const int PERSON_NAME_MAX_BYTES = 0xFFFF;
+static const int COMMAND_FIXED_BYTES = 4;
+static const int PERSON_BATCH_PREFIX_BYTES = 9;
+static const int CREDENTIAL_CHUNK_PREFIX_BYTES = 25;
+static const int CREDENTIAL_OP_BYTES = 16;
+
+static void writeHeader(char *out, PayloadType type, quint16 count, quint16 session = 0) {
+    out[0] = 'R';
+    out[1] = 'F';
+    out[2] = static_cast<char>(PayloadCodec::VERSION);
+    out[3] = static_cast<char>(type);
+    qToLittleEndian<quint16>(count, out + 4);
+    qToLittleEndian<quint16>(session, out + 6);
+}
+
+// Returns the record count, or -1 if the payload is not a binary payload of this type and version
+static int readHeader(QByteArrayView payload, PayloadType type) {
+    if (payload.size() < PayloadCodec::HEADER_BYTES) {
+        return -1;
+    }
+    const char *data = payload.data();
+    if (data[0] != 'R' || data[1] != 'F' || static_cast<quint8>(data[2]) != PayloadCodec::VERSION
+        || static_cast<quint8>(data[3]) != static_cast<quint8>(type)) {
+        return -1;
+    }
+    return qFromLittleEndian<quint16>(data + 4);
+}
+
+PayloadFormat PayloadCodec::detectFormat(QByteArrayView payload) {
+    // Text that merely starts with "RF" fails on the version byte (0x01) or the type byte
+    if (payload.size() < HEADER_BYTES || payload[0] != 'R' || payload[1] != 'F'
+        || static_cast<quint8>(payload[2]) != VERSION) {
+        return PayloadFormat::Text;
+    }
+    quint8 type = static_cast<quint8>(payload[3]);
+    return type >= quint8(PayloadType::ScanEvents) && type <= quint8(PayloadType::CredentialChunk)
+               ? PayloadFormat::Binary : PayloadFormat::Text;
+}
+
+PayloadFormat PayloadCodec::formatFromName(const QString &name) {
+    return name == "binary" ? PayloadFormat::Binary : PayloadFormat::Text;
+}
+
+const char *PayloadCodec::contentType(PayloadFormat format) {
+    return format == PayloadFormat::Binary ? "application/vnd.rfid-database.v1" : "application/json";
+}
+
+int PayloadCodec::encodeScanEvents(const ScanEvent *events, int count, char *out, int capacity, quint16 session) {
+    int size = HEADER_BYTES + count * SCAN_EVENT_BYTES;
+    if (count > 0xFFFF || size > capacity) {
+        return 0;
+    }
+
+    writeHeader(out, PayloadType::ScanEvents, static_cast<quint16>(count), session);
+    char *record = out + HEADER_BYTES;
+    for (int i = 0; i < count; ++i, record += SCAN_EVENT_BYTES) {
+        const ScanEvent &event = events[i];
+        qToLittleEndian<qint64>(event.timestampMs, record);
+        qToLittleEndian<quint32>(event.sequence, record + 8);
+        record[12] = static_cast<char>(event.uidLength);
+        std::memcpy(record + 13, event.uid, sizeof(event.uid));
+        record[23] = static_cast<char>(event.decision);
+    }
+    return size;
+}
+
+void PayloadCodec::encodeScanEvents(const ScanEvent *events, int count, QByteArray &buffer, quint16 session) {
+    int size = HEADER_BYTES + count * SCAN_EVENT_BYTES;
+    buffer.resize(size); // Allocates when the buffer grows or is still shared with a sent payload
+    encodeScanEvents(events, count, buffer.data(), size, session);
+}
+
+int PayloadCodec::encodeCommand(quint16 opcode, QByteArrayView argument, char *out, int capacity) {
+    int size = HEADER_BYTES + COMMAND_FIXED_BYTES + static_cast<int>(argument.size());
+    if (argument.size() > 0xFFFF || size > capacity) {
+        return 0;
+    }
+
+    writeHeader(out, PayloadType::Commands, 1);
+    qToLittleEndian<quint16>(opcode, out + HEADER_BYTES);
+    qToLittleEndian<quint16>(static_cast<quint16>(argument.size()), out + HEADER_BYTES + 2);
+    std::memcpy(out + HEADER_BYTES + COMMAND_FIXED_BYTES, argument.data(), argument.size());
+    return size;
+}
+
+void PayloadCodec::encodeCredentialChunk(quint64 changesetId, quint64 version, quint32 chunkIndex, quint32 chunkCount,
+                                         bool replaceAll, const CredentialOp *ops, int count, QByteArray &buffer) {
+    count = qMin(count, 0xFFFF);
+    buffer.resize(HEADER_BYTES + CREDENTIAL_CHUNK_PREFIX_BYTES + count * CREDENTIAL_OP_BYTES);
+    char *out = buffer.data();
+    writeHeader(out, PayloadType::CredentialChunk, static_cast<quint16>(count));
+
+    char *prefix = out + HEADER_BYTES;
+    qToLittleEndian<quint64>(changesetId, prefix);
+    qToLittleEndian<quint64>(version, prefix + 8);
+    qToLittleEndian<quint32>(chunkIndex, prefix + 16);
+    qToLittleEndian<quint32>(chunkCount, prefix + 20);
+    prefix[24] = replaceAll ? 1 : 0;
+
+    char *record = prefix + CREDENTIAL_CHUNK_PREFIX_BYTES;
+    for (int i = 0; i < count; ++i, record += CREDENTIAL_OP_BYTES) {
+        quint8 uidLength = static_cast<quint8>(qMin<qsizetype>(ops[i].uid.size(), 10));
+        record[0] = static_cast<char>(ops[i].kind);
+        qToLittleEndian<quint32>(ops[i].flags, record + 1);
+        record[5] = static_cast<char>(uidLength);
+        std::memset(record + 6, 0, 10);
+        std::memcpy(record + 6, ops[i].uid.data(), uidLength);
+    }
+}
+
+// Bytes of an UTF-8 name that fit a row, cut before a partial character rather than inside it
+static quint16 nameBytes(QByteArrayView utf8Name) {
+    qsizetype length = utf8Name.size();
+    if (length > PERSON_NAME_MAX_BYTES) {
+        length = PERSON_NAME_MAX_BYTES;
+        while (length > 0 && (static_cast<quint8>(utf8Name[length]) & 0xC0) == 0x80) {
+            --length; // utf8Name[length] continues the character that starts before it
+        }
+    }
+    return static_cast<quint16>(length);
+}
+
+PersonRowWriter::PersonRowWriter(QByteArray &target)
+    : buffer(target)
+    , rows(0)
+{
+    reset(0);
+}
+
+void PersonRowWriter::reset(qint64 changeSeq) {
+    // Keeps earlier capacity, unless the last batch is still shared with the client that sent it
+    buffer.resize(PayloadCodec::HEADER_BYTES + PERSON_BATCH_PREFIX_BYTES);
+    writeHeader(buffer.data(), PayloadType::PersonRows, 0);
+    qToLittleEndian<qint64>(changeSeq, buffer.data() + PayloadCodec::HEADER_BYTES);
+    buffer[PayloadCodec::HEADER_BYTES + 8] = 0;
+    rows = 0;
+}
+
+void PersonRowWriter::setLast(bool last) {
+    buffer[PayloadCodec::HEADER_BYTES + 8] = last ? 1 : 0;
+}
+
+int PersonRowWriter::sizeWith(QByteArrayView utf8Name) const {
+    return static_cast<int>(buffer.size() + PayloadCodec::PERSON_ROW_FIXED_BYTES + nameBytes(utf8Name));
+}
+
+void PersonRowWriter::append(qint64 id, qint32 age, bool deleted, QByteArrayView utf8Name) {
+    qsizetype offset = buffer.size();
+    quint16 nameLength = nameBytes(utf8Name);
+    buffer.resize(offset + PayloadCodec::PERSON_ROW_FIXED_BYTES + nameLength);
+
+    char *row = buffer.data() + offset;
+    qToLittleEndian<qint64>(id, row);
+    qToLittleEndian<qint32>(age, row + 8);
+    row[12] = deleted ? 1 : 0;
+    qToLittleEndian<quint16>(nameLength, row + 13);
+    std::memcpy(row + PayloadCodec::PERSON_ROW_FIXED_BYTES, utf8Name.data(), nameLength);
+
+    ++rows;
+    qToLittleEndian<quint16>(static_cast<quint16>(rows), buffer.data() + 4);
+}
+
+ScanEventReader::ScanEventReader(QByteArrayView data)
+    : payload(data)
+    , events(readHeader(data, PayloadType::ScanEvents))
+    , valid(false)
+{
+    valid = events >= 0 && payload.size() >= PayloadCodec::HEADER_BYTES + events * PayloadCodec::SCAN_EVENT_BYTES;
+}
+
+quint16 ScanEventReader::session() const {
+    return valid ? qFromLittleEndian<quint16>(payload.data() + 6) : 0;
+}
+
+ScanEvent ScanEventReader::at(int index) const {
+    const char *record = payload.data() + PayloadCodec::HEADER_BYTES + index * PayloadCodec::SCAN_EVENT_BYTES;
+    ScanEvent event;
+    event.timestampMs = qFromLittleEndian<qint64>(record);
+    event.sequence = qFromLittleEndian<quint32>(record + 8);
+    event.uidLength = qMin<quint8>(static_cast<quint8>(record[12]), sizeof(event.uid));
+    std::memcpy(event.uid, record + 13, sizeof(event.uid));
+    event.decision = static_cast<quint8>(record[23]);
+    return event;
+}
+
+PersonRowReader::PersonRowReader(QByteArrayView data)
+    : payload(data)
+    , offset(PayloadCodec::HEADER_BYTES + PERSON_BATCH_PREFIX_BYTES)
+    , rows(readHeader(data, PayloadType::PersonRows))
+    , valid(rows >= 0 && data.size() >= PayloadCodec::HEADER_BYTES + PERSON_BATCH_PREFIX_BYTES)
+{
+}
+
+qint64 PersonRowReader::changeSeq() const {
+    return valid ? qFromLittleEndian<qint64>(payload.data() + PayloadCodec::HEADER_BYTES) : -1;
+}
+
+bool PersonRowReader::isLast() const {
+    return valid && payload[PayloadCodec::HEADER_BYTES + 8] != 0;
+}
+
+bool PersonRowReader::next(PersonRowView *row) {
+    if (!valid || offset + PayloadCodec::PERSON_ROW_FIXED_BYTES > payload.size()) {
+        return false;
+    }
+    const char *data = payload.data() + offset;
+    quint16 nameLength = qFromLittleEndian<quint16>(data + 13);
+    if (offset + PayloadCodec::PERSON_ROW_FIXED_BYTES + nameLength > payload.size()) {
+        return false;
+    }
+
+    row->id = qFromLittleEndian<qint64>(data);
+    row->age = qFromLittleEndian<qint32>(data + 8);
+    row->deleted = data[12] != 0;
+    row->name = payload.sliced(offset + PayloadCodec::PERSON_ROW_FIXED_BYTES, nameLength);
+    offset += PayloadCodec::PERSON_ROW_FIXED_BYTES + nameLength;
+    return true;
+}
+
+CommandReader::CommandReader(QByteArrayView data)
+    : payload(data)
+    , offset(PayloadCodec::HEADER_BYTES)
+    , valid(readHeader(data, PayloadType::Commands) >= 0)
+{
+}
+
+bool CommandReader::next(CommandView *command) {
+    if (!valid || offset + COMMAND_FIXED_BYTES > payload.size()) {
+        return false;
+    }
+    const char *data = payload.data() + offset;
+    quint16 argumentLength = qFromLittleEndian<quint16>(data + 2);
+    if (offset + COMMAND_FIXED_BYTES + argumentLength > payload.size()) {
+        return false;
+    }
+
+    command->opcode = qFromLittleEndian<quint16>(data);
+    command->argument = payload.sliced(offset + COMMAND_FIXED_BYTES, argumentLength);
+    offset += COMMAND_FIXED_BYTES + argumentLength;
+    return true;
+}
+
+CredentialChunkReader::CredentialChunkReader(QByteArrayView data)
+    : payload(data)
+    , changeset(0)
+    , targetVersion(0)
+    , index(0)
+    , chunks(0)
+    , replaceAll(false)
+    , ops(readHeader(data, PayloadType::CredentialChunk))
+    , valid(false)
+{
+    if (ops < 0 || payload.size() < PayloadCodec::HEADER_BYTES + CREDENTIAL_CHUNK_PREFIX_BYTES + ops * CREDENTIAL_OP_BYTES) {
+        return;
+    }
+    const char *prefix = payload.data() + PayloadCodec::HEADER_BYTES;
+    changeset = qFromLittleEndian<quint64>(prefix);
+    targetVersion = qFromLittleEndian<quint64>(prefix + 8);
+    index = qFromLittleEndian<quint32>(prefix + 16);
+    chunks = qFromLittleEndian<quint32>(prefix + 20);
+    replaceAll = prefix[24] != 0;
+    valid = chunks > 0 && index < chunks;
+}
+
+CredentialOp CredentialChunkReader::at(int i) const {
+    const char *record = payload.data() + PayloadCodec::HEADER_BYTES + CREDENTIAL_CHUNK_PREFIX_BYTES
+                         + i * CREDENTIAL_OP_BYTES;
+    CredentialOp op;
+    op.kind = static_cast<quint8>(record[0]);
+    op.flags = qFromLittleEndian<quint32>(record + 1);
+    op.uid = QByteArrayView(record + 6, qMin<int>(static_cast<quint8>(record[5]), 10));
+    return op;
+}
+
+void benchmarkCodecs(int iterations) {
+    ScanEvent event{1700000000000LL, 1, 4, {0xDE, 0xAD, 0xBE, 0xEF}, 1};
+    QElapsedTimer timer;
+
+    // Binary encode into one reused stack buffer
+    char buffer[PayloadCodec::HEADER_BYTES + PayloadCodec::SCAN_EVENT_BYTES];
+    int binarySize = 0;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        event.sequence = i;
+        binarySize = PayloadCodec::encodeScanEvents(&event, 1, buffer, sizeof(buffer));
+    }
+    qint64 binaryEncodeNs = timer.nsecsElapsed();
+
+    quint64 checksum = 0;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        ScanEventReader reader(QByteArrayView(buffer, binarySize));
+        checksum += reader.at(0).sequence;
+    }
+    qint64 binaryDecodeNs = timer.nsecsElapsed();
+
+    // The text format used before, for comparison
+    QByteArray json;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        QJsonObject object{{"uid", "DEADBEEF"}, {"granted", true}, {"ts", event.timestampMs}, {"seq", i}};
+        json = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    }
+    qint64 jsonEncodeNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        checksum += QJsonDocument::fromJson(json).object().value("seq").toInt();
+    }
+    qint64 jsonDecodeNs = timer.nsecsElapsed();
+
+    qDebug().noquote() << QString("Scan event codec over %1 iterations (checksum %2):").arg(iterations).arg(checksum);
+    qDebug().noquote() << QString("  binary: %1 bytes, encode %2 ns, decode %3 ns")
+                              .arg(binarySize).arg(binaryEncodeNs / iterations).arg(binaryDecodeNs / iterations);
+    qDebug().noquote() << QString("  json:   %1 bytes, encode %2 ns, decode %3 ns")
+                              .arg(json.size()).arg(jsonEncodeNs / iterations).arg(jsonDecodeNs / iterations);
+}
@@ -0,0 +1,178 @@
+#ifndef PAYLOADCODEC_H
+#define PAYLOADCODEC_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QStringView>
+
+/**
+ * Versioned fixed little-endian wire format for MQTT payloads.
+ *
+ * Every binary payload starts with an 8 byte header:
+ *   'R' 'F' | version u8 | type u8 | count u16 | session u16
+ * session is only set on ScanEvents payloads: a random non-zero value per sender process, so a
+ * reader whose sequence starts over after a restart is not taken for a redelivery. 0 means unknown.
+ * followed by `count` records of the given type:
+ *   ScanEvent  (24 bytes): timestamp ms i64 | sequence u32 | uid length u8 | uid[10] | decision u8
+ *   PersonRow  (variable): id i64 | age i32 | flags u8 | name length u16 | name bytes (UTF-8)
+ *              a PersonRows payload has a batch prefix before its rows: change seq i64 | last u8
+ *   Command    (variable): opcode u16 | argument length u16 | argument bytes
+ *   CredentialOp (16 bytes): op u8 (1 upsert, 2 revoke) | access flags u32 | uid length u8 | uid[10]
+ *              a CredentialChunk payload has a prefix before its ops:
+ *              changeset id u64 | version u64 | chunk index u32 | chunk count u32 | flags u8 (1 = replace all)
+ *
+ * Text (JSON) payloads always start with '{', so the two formats can share a topic. detectFormat
+ * only calls a payload binary when the version and type bytes are valid as well.
+ */
+enum class PayloadFormat : quint8 {
+    Text,
+    Binary
+};
+
+enum class PayloadType : quint8 {
+    ScanEvents = 1,
+    PersonRows = 2,
+    Commands = 3,
+    CredentialChunk = 4
+};
+
+struct ScanEvent {
+    qint64 timestampMs;
+    quint32 sequence;     // Per reader, lets subscribers detect gaps
+    quint8 uidLength;
+    quint8 uid[10];
+    quint8 decision;      // 1 granted, 0 denied
+};
+
+// Read-only view of one person row inside a RecordBatch payload
+struct PersonRowView {
+    qint64 id;
+    qint32 age;
+    bool deleted;
+    QByteArrayView name;  // Points into the payload, UTF-8
+};
+
+struct CredentialOp {
+    enum Kind : quint8 { Upsert = 1, Revoke = 2 };
+    quint8 kind;
+    quint32 flags;
+    QByteArrayView uid;   // Points into the payload
+};
+
+struct CommandView {
+    quint16 opcode;
+    QByteArrayView argument;
+};
+
+class PayloadCodec {
+public:
+    static constexpr int HEADER_BYTES = 8;
+    static constexpr int SCAN_EVENT_BYTES = 24;
+    static constexpr int PERSON_ROW_FIXED_BYTES = 15;
+    static constexpr quint8 VERSION = 1;
+
+    static PayloadFormat detectFormat(QByteArrayView payload);
+    static PayloadFormat formatFromName(const QString &name); // "binary" or anything else for text
+    static const char *contentType(PayloadFormat format);     // MQTT 5 content type
+
+    // Encoders write into caller-owned memory and return the bytes written, 0 if it does not fit.
+    // They never touch the heap.
+    static int encodeScanEvents(const ScanEvent *events, int count, char *out, int capacity, quint16 session = 0);
+    static int encodeCommand(quint16 opcode, QByteArrayView argument, char *out, int capacity);
+
+    // Convenience for callers that keep one QByteArray around. Its capacity is reused, except when
+    // the previous payload is still shared (e.g. queued by the MQTT client): then resize detaches.
+    static void encodeScanEvents(const ScanEvent *events, int count, QByteArray &buffer, quint16 session = 0);
+
+    // One chunk of a provisioning changeset
+    static void encodeCredentialChunk(quint64 changesetId, quint64 version, quint32 chunkIndex, quint32 chunkCount,
+                                      bool replaceAll, const CredentialOp *ops, int count, QByteArray &buffer);
+};
+
+// Appends person rows to a reusable buffer until a size limit is reached. Names come already
+// UTF-8 encoded, so the caller encodes each one once for both the size check and the append.
+class PersonRowWriter {
+public:
+    explicit PersonRowWriter(QByteArray &buffer);
+
+    void reset(qint64 changeSeq);
+    int sizeWith(QByteArrayView utf8Name) const;
+    void append(qint64 id, qint32 age, bool deleted, QByteArrayView utf8Name);
+    void setLast(bool last);
+    int count() const { return rows; }
+
+private:
+    QByteArray &buffer;
+    int rows;
+};
+
+// Zero-copy readers: they validate the header once and then decode straight from the payload
+class ScanEventReader {
+public:
+    explicit ScanEventReader(QByteArrayView payload);
+    bool isValid() const { return valid; }
+    int count() const { return events; }
+    quint16 session() const;
+    ScanEvent at(int index) const;
+
+private:
+    QByteArrayView payload;
+    int events;
+    bool valid;
+};
+
+class PersonRowReader {
+public:
+    explicit PersonRowReader(QByteArrayView payload);
+    bool isValid() const { return valid; }
+    int count() const { return rows; }
+    qint64 changeSeq() const;
+    bool isLast() const;
+    bool next(PersonRowView *row); // false at the end or on a truncated row
+
+private:
+    QByteArrayView payload;
+    qsizetype offset;
+    int rows;
+    bool valid;
+};
+
+class CommandReader {
+public:
+    explicit CommandReader(QByteArrayView payload);
+    bool isValid() const { return valid; }
+    bool next(CommandView *command);
+
+private:
+    QByteArrayView payload;
+    qsizetype offset;
+    bool valid;
+};
+
+class CredentialChunkReader {
+public:
+    explicit CredentialChunkReader(QByteArrayView payload);
+    bool isValid() const { return valid; }
+    quint64 changesetId() const { return changeset; }
+    quint64 version() const { return targetVersion; }
+    quint32 chunkIndex() const { return index; }
+    quint32 chunkCount() const { return chunks; }
+    bool replacesAll() const { return replaceAll; }
+    int count() const { return ops; }
+    CredentialOp at(int index) const;
+
+private:
+    QByteArrayView payload;
+    quint64 changeset;
+    quint64 targetVersion;
+    quint32 index;
+    quint32 chunks;
+    bool replaceAll;
+    int ops;
+    bool valid;
+};
+
+void benchmarkCodecs(int iterations = 100000); // Logs encode/decode cost of binary vs JSON
+
+#endif // PAYLOADCODEC_H
@@ -0,0 +1,99 @@
+#include "piccpolicy.h"
+
+static const float SAMPLE_WEIGHT = 1.0f / 16;
+static const float MAX_TIMEOUT_SCALE = 4.0f;
+
+uint32_t piccTimeoutUs(uint8_t piccCommand) {
+    switch (piccCommand) {
+    case 0x26: // REQA
+    case 0x52: // WUPA
+        return 300;
+    case 0x93: // Anticollision / select, cascade levels 1-3
+    case 0x95:
+    case 0x97:
+    case 0x50: // HLTA, success is no answer
+        return 1000;
+    case 0x60: // MIFARE authenticate with key A / B
+    case 0x61:
+    case 0x30: // MIFARE / NTAG read
+        return 5000;
+    case 0xA0: // MIFARE write, the second phase waits for the EEPROM
+    case 0xA2: // Ultralight write
+    case 0xC0: // Decrement, increment, restore, transfer
+    case 0xC1:
+    case 0xC2:
+    case 0xB0:
+        return 10000;
+    }
+    return 25000; // Unknown commands keep the old catch-all timeout
+}
+
+uint16_t piccTimerReload(uint32_t timeoutUs) {
+    uint64_t ticks = (uint64_t(timeoutUs) * 1000 + PICC_TIMER_TICK_NS - 1) / PICC_TIMER_TICK_NS;
+    return ticks > 0xFFFF ? 0xFFFF : ticks < 1 ? 1 : uint16_t(ticks);
+}
+
+PiccRetryPolicy::PiccRetryPolicy()
+    : timeouts(0)
+    , collisions(0)
+    , errors(0)
+    , lateAnswers(0)
+    , timeoutScale(1)
+{
+}
+
+void PiccRetryPolicy::record(Outcome outcome, bool tagExpected) {
+    timeouts += SAMPLE_WEIGHT * ((outcome == Timeout ? 1.0f : 0.0f) - timeouts);
+    collisions += SAMPLE_WEIGHT * ((outcome == Collision ? 1.0f : 0.0f) - collisions);
+    errors += SAMPLE_WEIGHT * ((outcome == Error ? 1.0f : 0.0f) - errors);
+
+    if (tagExpected) {
+        lateAnswers += SAMPLE_WEIGHT * ((outcome == Timeout ? 1.0f : 0.0f) - lateAnswers);
+        if (lateAnswers > 0.25f && timeoutScale < MAX_TIMEOUT_SCALE) {
+            timeoutScale *= 1.5f;
+            if (timeoutScale > MAX_TIMEOUT_SCALE) {
+                timeoutScale = MAX_TIMEOUT_SCALE;
+            }
+            lateAnswers = 0; // Give the longer wait a chance before stretching again
+        } else if (lateAnswers < 0.02f && timeoutScale > 1.0f) {
+            timeoutScale *= 0.9f;
+            if (timeoutScale < 1.0f) {
+                timeoutScale = 1.0f;
+            }
+        }
+    }
+}
+
+int PiccRetryPolicy::retries() const {
+    float garbled = collisions + errors;
+    if (garbled > 0.3f) {
+        return 3;
+    }
+    if (garbled > 0.05f) {
+        return 2;
+    }
+    return 1;
+}
+
+unsigned PiccRetryPolicy::backoffMs(int attempt) const {
+    // A garbled frame is usually a tag still moving into the field: give it a moment, more
+    // when that keeps happening; a tag that just collided can answer again right away
+    unsigned base = errors > 0.3f ? 5 : errors > 0.05f ? 2 : 0;
+    unsigned delay = base << (attempt - 1);
+    return delay > 20 ? 20 : delay;
+}
+
+bool PiccRetryPolicy::shouldRetry(Outcome outcome) const {
+    if (outcome == Ok) {
+        return false;
+    }
+    if (outcome == Timeout) {
+        // Timeouts are the empty field unless they are rare, then they are a tag's bad moment
+        return timeouts < 0.5f;
+    }
+    return true;
+}
+
+uint32_t PiccRetryPolicy::timeoutUs(uint8_t piccCommand) const {
+    return uint32_t(piccTimeoutUs(piccCommand) * timeoutScale);
+}
@@ -0,0 +1,54 @@
+#ifndef PICCPOLICY_H
+#define PICCPOLICY_H
+
+#include <cstdint>
+
+// RC522 timer clocked at 13.56 MHz / (2 * 67 + 1) = ~100 kHz, one tick per ~10 us.
+// TModeReg 0x80 (TAuto, prescaler high nibble 0) with TPrescalerReg 0x43.
+#define PICC_TIMER_MODE      0x80
+#define PICC_TIMER_PRESCALER 0x43
+#define PICC_TIMER_TICK_NS   9956
+
+// Frame wait time for a PICC command: how long the reader's timer should wait for an answer.
+// REQA/WUPA answer 86 us after the request, a MIFARE write acknowledges its second phase only
+// after the EEPROM has been programmed, so one fixed timeout is either too long or too short.
+uint32_t piccTimeoutUs(uint8_t piccCommand);
+uint16_t piccTimerReload(uint32_t timeoutUs); // TReloadReg value for the tick above
+
+/**
+ * Per-reader retry and timeout policy learned from what the field has been doing. Outcomes are
+ * folded into exponentially weighted rates (1/16 per sample, so about the last 16 polls count):
+ *
+ *   - timeouts on REQA mean nobody is there; retrying an empty field only burns time, so when
+ *     they dominate a poll makes one attempt and no backoff sleep
+ *   - collisions and transmission errors mean a tag is there but the frame was garbled (tag
+ *     on the edge of the field, two tags); those are worth retrying, more often and with a
+ *     longer backoff the more frequent they are
+ *   - timeouts while a tag is known to be present mean the answer came late; the frame wait
+ *     time is stretched (up to 4x) until they stop and shrinks back once they have
+ */
+class PiccRetryPolicy {
+public:
+    enum Outcome { Ok, Timeout, Collision, Error };
+
+    PiccRetryPolicy();
+
+    void record(Outcome outcome, bool tagExpected);
+    int retries() const;                // Extra attempts after the first failure
+    unsigned backoffMs(int attempt) const; // Before retry attempt 1, 2, ...
+    bool shouldRetry(Outcome outcome) const;
+    uint32_t timeoutUs(uint8_t piccCommand) const; // piccTimeoutUs() stretched by the late-answer rate
+
+    float timeoutRate() const { return timeouts; }
+    float errorRate() const { return errors; }
+    float collisionRate() const { return collisions; }
+
+private:
+    float timeouts;
+    float collisions;
+    float errors;
+    float lateAnswers;
+    float timeoutScale; // 1 .. 4
+};
+
+#endif // PICCPOLICY_H
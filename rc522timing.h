@@ -0,0 +1,8 @@
+#ifndef RC522TIMING_H
+#define RC522TIMING_H
+
+// Crystal start-up after RST release or a soft reset (a few ms for 27.12 MHz) plus the 37.74 us
+// the RC522 adds; register reads return garbage until it has passed, so nothing polls earlier
+#define PCD_OSC_STARTUP_US   5038
+
+#endif // RC522TIMING_H
@@ -0,0 +1,206 @@
+#include "readertrace.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+static const char TRACE_MAGIC[7] = {'R', 'F', 'T', 'R', 'A', 'C', 'E'};
+static const uint8_t TRACE_VERSION = 1;
+static const int TRACE_HEADER_BYTES = 16;
+static const int RECORD_HEADER_BYTES = 10;
+
+uint64_t traceClockNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return uint64_t(now.tv_sec) * 1000000000ull + uint64_t(now.tv_nsec);
+}
+
+TraceWriter::TraceWriter()
+    : file(nullptr)
+    , startNs(0)
+    , written(0)
+{
+}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const char *path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file) {
+        fclose(file);
+    }
+    file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, 1 << 16); // A transfer is a dozen bytes; let stdio batch them
+
+    uint8_t header[TRACE_HEADER_BYTES] = {0};
+    memcpy(header, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header[7] = TRACE_VERSION;
+    fwrite(header, 1, sizeof(header), file);
+    startNs = traceClockNs();
+    written = 0;
+    return true;
+}
+
+void TraceWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void TraceWriter::recordSpi(const uint8_t *tx, const uint8_t *rx, int length) {
+    std::lock_guard<std::mutex> lock(mutex);
+    append(TraceKind::Spi, tx, rx, length);
+}
+
+void TraceWriter::recordScan(const uint8_t *uid, int length) {
+    std::lock_guard<std::mutex> lock(mutex);
+    append(TraceKind::Scan, uid, nullptr, length);
+}
+
+bool TraceWriter::recordValue(const uint8_t *uid, int uidLength, uint8_t block, int32_t value) {
+    if (uidLength < 0 || uidLength > 10) {
+        return false;
+    }
+    uint8_t payload[5 + 10];
+    payload[0] = block;
+    for (int i = 0; i < 4; ++i) {
+        payload[1 + i] = static_cast<uint8_t>(uint32_t(value) >> (8 * i));
+    }
+    memcpy(payload + 5, uid, uidLength);
+
+    // The card has been charged: a crash must not lose this record in the stdio buffer, and a
+    // write error has to reach the caller, which grants the ride only on success
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!append(TraceKind::Value, payload, nullptr, 5 + uidLength)) {
+        return false;
+    }
+    return fflush(file) == 0;
+}
+
+bool TraceWriter::append(TraceKind kind, const uint8_t *first, const uint8_t *second, int length) {
+    if (length < 0 || length > 255 || !file) {
+        return false;
+    }
+
+    uint64_t timestamp = traceClockNs() - startNs;
+    uint8_t header[RECORD_HEADER_BYTES];
+    header[0] = static_cast<uint8_t>(kind);
+    header[1] = static_cast<uint8_t>(length);
+    for (int i = 0; i < 8; ++i) {
+        header[2 + i] = static_cast<uint8_t>(timestamp >> (8 * i));
+    }
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    ok = ok && fwrite(first, 1, length, file) == size_t(length);
+    if (second) {
+        ok = ok && fwrite(second, 1, length, file) == size_t(length);
+    }
+    if (ok) {
+        ++written;
+    }
+    return ok;
+}
+
+TraceReader::TraceReader()
+    : file(nullptr)
+{
+}
+
+TraceReader::~TraceReader() {
+    close();
+}
+
+bool TraceReader::open(const char *path) {
+    close();
+    file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t header[TRACE_HEADER_BYTES];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)
+        || memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header[7] != TRACE_VERSION) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TraceReader::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void TraceReader::rewind() {
+    if (file) {
+        fseek(file, TRACE_HEADER_BYTES, SEEK_SET);
+    }
+}
+
+bool TraceReader::next(TraceRecord *record) {
+    if (!file) {
+        return false;
+    }
+    uint8_t header[RECORD_HEADER_BYTES];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        return false;
+    }
+    record->kind = static_cast<TraceKind>(header[0]);
+    record->length = header[1];
+    record->timestampNs = 0;
+    for (int i = 0; i < 8; ++i) {
+        record->timestampNs |= uint64_t(header[2 + i]) << (8 * i);
+    }
+    size_t payload = record->kind == TraceKind::Spi ? 2u * record->length : record->length;
+    return fread(record->data, 1, payload, file) == payload;
+}
+
+bool TraceReader::next(TraceKind kind, TraceRecord *record) {
+    while (next(record)) {
+        if (record->kind == kind) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TracePacer::TracePacer(double speed)
+    : speed(speed)
+    , started(false)
+    , firstTimestampNs(0)
+    , startNs(0)
+{
+}
+
+int64_t TracePacer::delayNs(uint64_t timestampNs) {
+    if (!started) {
+        started = true;
+        firstTimestampNs = timestampNs;
+        startNs = traceClockNs();
+        return 0;
+    }
+    if (speed <= 0.0) {
+        return 0;
+    }
+    uint64_t due = startNs + uint64_t(double(timestampNs - firstTimestampNs) / speed);
+    return int64_t(due - traceClockNs());
+}
+
+void TracePacer::wait(uint64_t timestampNs) {
+    int64_t delay = delayNs(timestampNs);
+    if (delay <= 0) {
+        return;
+    }
+    // Absolute deadline so time spent decoding between records does not accumulate as drift
+    uint64_t due = traceClockNs() + uint64_t(delay);
+    timespec deadline = {time_t(due / 1000000000ull), long(due % 1000000000ull)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        // Interrupted by a signal, sleep again towards the same deadline
+    }
+}
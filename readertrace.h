@@ -0,0 +1,90 @@
+#ifndef READERTRACE_H
+#define READERTRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+/**
+ * Compact binary capture of reader traffic, for replaying a busy entrance on a laptop.
+ *
+ * File header (16 bytes): "RFTRACE" | version u8 | reserved[8]
+ * Records:                kind u8 | length u8 | timestamp ns u64 (since the capture started) | payload
+ *   Spi  payload: tx[length] | rx[length]   one full-duplex transfer on the RC522 bus
+ *   Scan payload: uid[length]               one UID as the scanner reported it, before deduplication
+ *   Value payload: block u8 | value i32 | uid[length - 5]   a value block after a committed update
+ *
+ * All integers are little-endian. A truncated last record (power cut) ends the trace cleanly.
+ */
+enum class TraceKind : uint8_t {
+    Spi = 1,
+    Scan = 2,
+    Value = 3
+};
+
+struct TraceRecord {
+    TraceKind kind;
+    uint8_t length;
+    uint64_t timestampNs;
+    uint8_t data[2 * 255]; // Spi: tx then rx; Scan: the UID
+};
+
+class TraceWriter {
+public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool open(const char *path);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    // Safe from any thread; records are appended in the order the calls take the lock
+    void recordSpi(const uint8_t *tx, const uint8_t *rx, int length);
+    void recordScan(const uint8_t *uid, int length);
+    // Flushed at once; false when the record did not reach the file (closed, full, I/O error)
+    bool recordValue(const uint8_t *uid, int uidLength, uint8_t block, int32_t value);
+    uint64_t records() const { return written; }
+
+private:
+    bool append(TraceKind kind, const uint8_t *first, const uint8_t *second, int length); // Caller holds mutex
+
+    std::mutex mutex;
+    FILE *file;
+    uint64_t startNs;
+    uint64_t written;
+};
+
+class TraceReader {
+public:
+    TraceReader();
+    ~TraceReader();
+
+    bool open(const char *path);
+    void close();
+    bool next(TraceRecord *record);          // false at the end of the trace
+    bool next(TraceKind kind, TraceRecord *record); // Skips records of other kinds
+    void rewind();
+
+private:
+    FILE *file;
+};
+
+// Sleeps until a record is due: timestamp / speed after the first one. Speed 0 never sleeps.
+class TracePacer {
+public:
+    explicit TracePacer(double speed = 1.0);
+
+    void wait(uint64_t timestampNs);
+    int64_t delayNs(uint64_t timestampNs); // How long until the record is due, <= 0 if now
+    void restart() { started = false; }
+
+private:
+    double speed;
+    bool started;
+    uint64_t firstTimestampNs;
+    uint64_t startNs;
+};
+
+uint64_t traceClockNs(); // CLOCK_MONOTONIC
+
+#endif // READERTRACE_H
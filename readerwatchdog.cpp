@@ -0,0 +1,122 @@
+#include "readerwatchdog.h"
+#include "metrics.h"
+#include "logger.h"
+
+static const int MAX_BACKOFF_CHECKS = 60;
+
+static const char *faultName(quint32 fault) {
+    switch (fault) {
+    case RFIDReader::FaultVersion: return "version";
+    case RFIDReader::FaultTimer: return "timer";
+    case RFIDReader::FaultErrors: return "errors";
+    case RFIDReader::FaultFifo: return "fifo";
+    case RFIDReader::FaultSpi: return "spi";
+    }
+    return "unknown";
+}
+
+static const char *recoveryName(RFIDReader::Recovery action) {
+    switch (action) {
+    case RFIDReader::SoftReset: return "soft_reset";
+    case RFIDReader::HardReset: return "hard_reset";
+    case RFIDReader::ReinitSpi: return "reinit_spi";
+    }
+    return "unknown";
+}
+
+ReaderWatchdog::ReaderWatchdog(RFIDReader *reader, const QString &name, QObject *parent)
+    : QObject(parent)
+    , reader(reader)
+    , name(name)
+    , timer(this)
+    , healthy(true)
+    , skip(0)
+    , backoff(1)
+{
+    MetricsRegistry &metrics = MetricsRegistry::instance();
+    QString label = QString("{reader=\"%1\"}").arg(name);
+    healthyGauge = metrics.gauge("rfid_reader_healthy" + label, "1 while the reader passes its health checks");
+    recoveryTime = metrics.histogram("rfid_reader_recovery_seconds" + label, "From fault detected to reader healthy");
+    healthyGauge->set(1);
+
+    connect(&timer, &QTimer::timeout, this, &ReaderWatchdog::check);
+}
+
+void ReaderWatchdog::start(int intervalMs) {
+    timer.start(intervalMs);
+}
+
+/**
+ * One health check. A faulty reader goes through the recovery ladder right away; time to
+ * recovery is measured from the first failed check, not from the last attempt.
+ */
+void ReaderWatchdog::check() {
+    if (skip > 0) {
+        --skip;
+        return;
+    }
+
+    quint32 faults = reader->checkHealth();
+    if (faults == RFIDReader::FaultNone) {
+        if (!healthy) {
+            // Came back between checks after the ladder gave up (power or wiring restored)
+            markRecovered();
+        }
+        return;
+    }
+
+    if (healthy) {
+        healthy = false;
+        healthyGauge->set(0);
+        down.start();
+        LOG_WARN("Reader %s unhealthy, faults 0x%02x", qPrintable(name), faults);
+        emit readerFailed(name, faults);
+    }
+    countFaults(faults);
+
+    if (tryRecover(faults)) {
+        markRecovered();
+        return;
+    }
+
+    skip = backoff;
+    backoff = qMin(backoff * 2, MAX_BACKOFF_CHECKS);
+    LOG_ERROR("Reader %s did not recover, next attempt in %d checks", qPrintable(name), skip + 1);
+}
+
+void ReaderWatchdog::markRecovered() {
+    qint64 downNs = down.nsecsElapsed();
+    recoveryTime->record(downNs);
+    healthy = true;
+    healthyGauge->set(1);
+    backoff = 1;
+    LOG_INFO("Reader %s recovered after %lld ms", qPrintable(name), downNs / 1000000);
+    emit readerRecovered(name, downNs / 1000000);
+}
+
+bool ReaderWatchdog::tryRecover(quint32 faults) {
+    // A dead bus cannot be fixed by resetting the chip behind it
+    int first = (faults & RFIDReader::FaultSpi) ? RFIDReader::ReinitSpi : RFIDReader::SoftReset;
+    for (int step = first; step <= RFIDReader::ReinitSpi; ++step) {
+        RFIDReader::Recovery action = static_cast<RFIDReader::Recovery>(step);
+        MetricsRegistry::instance()
+            .counter(QString("rfid_reader_recoveries_total{reader=\"%1\",action=\"%2\"}").arg(name, recoveryName(action)),
+                     "Recovery attempts by action")
+            ->inc();
+        if (reader->recover(action) && reader->checkHealth() == RFIDReader::FaultNone) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReaderWatchdog::countFaults(quint32 faults) {
+    for (quint32 fault = RFIDReader::FaultVersion; fault <= RFIDReader::FaultSpi; fault <<= 1) {
+        if (faults & fault) {
+            MetricsRegistry::instance()
+                .counter(QString("rfid_reader_faults_total{reader=\"%1\",kind=\"%2\"}").arg(name, faultName(fault)),
+                         "Reader faults seen by the watchdog")
+                ->inc();
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef READERWATCHDOG_H
+#define READERWATCHDOG_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "rfidreader.h"
+
+class MetricCounter;
+class MetricGauge;
+class LatencyHistogram;
+
+/**
+ * Polls one reader's health and brings it back in-process when it wedges: soft reset, then a
+ * RST pulse, then a fresh SPI descriptor, re-checking after each step so the cheapest fix that
+ * works is the one used. Nothing is restarted and other readers keep scanning. When even the
+ * SPI re-init does not help the checks back off exponentially instead of resetting in a loop.
+ *
+ * Lives on the reader's thread (moveToThread alongside it) so checks never race a transceive.
+ */
+class ReaderWatchdog : public QObject {
+    Q_OBJECT
+
+public:
+    ReaderWatchdog(RFIDReader *reader, const QString &name, QObject *parent = nullptr);
+
+    void start(int intervalMs = 1000);
+    bool isHealthy() const { return healthy; }
+
+signals:
+    void readerFailed(const QString &name, quint32 faults);
+    void readerRecovered(const QString &name, qint64 downMs);
+
+private slots:
+    void check();
+
+private:
+    bool tryRecover(quint32 faults);
+    void markRecovered();   // Records the downtime and reports the reader healthy again
+    void countFaults(quint32 faults);
+
+    RFIDReader *reader;
+    QString name;
+    QTimer timer;
+    QElapsedTimer down;     // Since the fault was first seen
+    bool healthy;
+    int skip;               // Checks still to skip while backing off
+    int backoff;            // Checks to skip after the next failed ladder, doubles up to 60
+
+    MetricGauge *healthyGauge;
+    LatencyHistogram *recoveryTime;
+};
+
+#endif // READERWATCHDOG_H
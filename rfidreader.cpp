@@ -1,11 +1,19 @@
 #include "rfidreader.h"
-#include <wiringPi.h>
-#include <wiringPiSPI.h>
 #include <QDebug>
 #include <QTimer>
+#include "logger.h"
+#include "metrics.h"
 
 #define SPI_CHANNEL 0
 #define SPI_SPEED 500000
+#define RST_PIN 25 // GPIO 25 (BCM)
+
+static MetricCounter *spiTransactions = MetricsRegistry::instance().counter("rfid_spi_transactions_total",
+                                                                            "Register reads and writes on the RC522");
+static MetricCounter *spiErrors = MetricsRegistry::instance().counter("rfid_spi_errors_total",
+                                                                      "Failed SPI transfers");
+static MetricCounter *piccRetries = MetricsRegistry::instance().counter("rfid_picc_retries_total",
+                                                                        "REQA attempts after a failed one");
 
 // RC522 Register Definitions
 #define CommandReg           0x01
@@ -34,36 +42,59 @@
 #define VersionReg           0x37
 #define RFCfgReg             0x26
 
-RFIDReader::RFIDReader(QObject *parent) : QObject(parent) {
+RFIDReader::RFIDReader(QObject *parent)
+    : RFIDReader(SPI_CHANNEL, RST_PIN, parent)
+{
+}
+
+RFIDReader::RFIDReader(int spiChannel, int resetPin, QObject *parent)
+    : QObject(parent)
+    , hardware(new WiringPiSpiTransport(spiChannel, SPI_SPEED, resetPin))
+    , transport(hardware.get())
+    , lastStatus(0xFF)
+    , expectedVersion(0)
+    , consecutiveErrors(0)
+    , timerStalls(0)
+    , spiFailures(0)
+    , timerReload(0)
+{
     mfrc522Initialized = false;
 }
 
+void RFIDReader::setTransport(SpiTransport *replacement) {
+    transport = replacement ? replacement : hardware.get();
+}
+
 RFIDReader::~RFIDReader() {
 }
 
 void RFIDReader::initialize() {
-    if (wiringPiSetupGpio() == -1) {
-        qDebug() << "Failed to initialize GPIO.";
+    // GPIO, SPI and the reset pin on hardware; nothing for a replayed trace
+    if (!transport->open()) {
+        qDebug() << "Failed to initialize the SPI transport.";
         return;
     }
 
-    if (wiringPiSPISetup(SPI_CHANNEL, SPI_SPEED) == -1) {
-        qDebug() << "Failed to initialize SPI.";
-        return;
-    }
-
-    // Configure the Reset pin
-    pinMode(25, OUTPUT); // RST pin on GPIO 25
-    digitalWrite(25, HIGH); // Ensure the RC522 is powered on
-
     // Initialize the RC522
     reset(); // Perform a soft reset of the RFID reader
+    configure();
+    uint8_t version = readFromRegister(VersionReg);
+    if (isKnownVersion(version)) {
+        expectedVersion = version;
+    } else {
+        // Leave expectedVersion unset: the first health check that reads a real chip adopts it
+        LOG_WARN("Unexpected RC522 version 0x%02x at initialize", version);
+    }
+    mfrc522Initialized = true;
 
+    qDebug() << "RFID Reader initialized.";
+}
+
+void RFIDReader::configure() {
     // Configure Timer
-    writeToRegister(TModeReg, 0x8D);       // TAuto=1; timers start automatically at the end of transmission
-    writeToRegister(TPrescalerReg, 0x3E); // Timer prescaler
-    writeToRegister(TReloadRegL, 30);     // Reload timer low byte
-    writeToRegister(TReloadRegH, 0);      // Reload timer high byte
+    writeToRegister(TModeReg, PICC_TIMER_MODE);       // TAuto=1; timers start automatically at the end of transmission
+    writeToRegister(TPrescalerReg, PICC_TIMER_PRESCALER); // ~10 us ticks; the reload is set per command
+    timerReload = 0;                      // A reset cleared it, force the next command to program it
     // Configure Transmission
     writeToRegister(TxASKReg, 0x40);      // 100% ASK modulation (amplitude shift keying)
     // Configure Default Mode
@@ -72,10 +103,77 @@ void RFIDReader::initialize() {
     writeToRegister(RFCfgReg, 0x30);      // Set RxGain to maximum value (48 dB)
     // Turn on the Antenna
     antennaOn();
-    mfrc522Initialized = true;
+}
 
-    qDebug() << "RFID Reader initialized.";
+// 0x91/0x92 are RC522 v1.0/v2.0, 0x88 the FM17522 clone. 0x00 or 0xFF usually means MISO is
+// floating: the chip is unpowered or the bus is gone, and must never count as a match.
+bool RFIDReader::isKnownVersion(uint8_t version) {
+    return version == 0x91 || version == 0x92 || version == 0x88;
+}
+
+bool RFIDReader::versionMatches(uint8_t version) {
+    if (!isKnownVersion(version)) {
+        return false;
+    }
+    if (expectedVersion == 0) {
+        expectedVersion = version;
+    }
+    return version == expectedVersion;
+}
 
+quint32 RFIDReader::checkHealth() {
+    quint32 faults = FaultNone;
+    if (!versionMatches(readFromRegister(VersionReg))) {
+        faults |= FaultVersion;
+    }
+    writeToRegister(FIFOLevelReg, 0x80); // Flush
+    if (readFromRegister(FIFOLevelReg) & 0x7F) {
+        faults |= FaultFifo;
+    }
+    if (timerStalls > 0) {
+        faults |= FaultTimer;
+    }
+    if (consecutiveErrors >= 5) {
+        faults |= FaultErrors;
+    }
+    if (spiFailures > 0) {
+        faults |= FaultSpi;
+    }
+    timerStalls = 0;
+    spiFailures = 0;
+    return faults;
+}
+
+bool RFIDReader::recover(Recovery action) {
+    switch (action) {
+    case ReinitSpi:
+        if (!transport->reopen()) {
+            return false;
+        }
+        [[fallthrough]];
+    case HardReset:
+        transport->hardReset();
+        [[fallthrough]];
+    case SoftReset:
+        reset();
+        break;
+    }
+    configure();
+    consecutiveErrors = 0;
+    timerStalls = 0;
+    spiFailures = 0;
+    lastStatus = 0xFF;
+    return versionMatches(readFromRegister(VersionReg));
+}
+
+/**
+ * Register read-back checks, split out of initialize() so they stay off the startup path:
+ * run them from a worker or after the first scan, they only log.
+ */
+void RFIDReader::runDiagnostics() {
+    if (!mfrc522Initialized) {
+        return;
+    }
     // Example: Reading and Writing to Version Register (should be 0x91 or 0x92 for RC522)
     uint8_t version = readFromRegister(VersionReg);
     qDebug() << "Version Register:" << QString::number(static_cast<int>(version), 16).toUpper();
@@ -86,8 +184,7 @@ void RFIDReader::initialize() {
         qDebug() << "Antenna is not enabled. Attempting to enable.";
         antennaOn();
     }
-    // Write and read back from a test register
-    writeToRegister(ModeReg, 0x3D); // Example value
+    // Read back the mode register set by initialize()
     uint8_t modeValue = readFromRegister(ModeReg);
     if (modeValue == 0x3D) {
         qDebug() << "ModeReg correctly configured.";
@@ -113,23 +210,33 @@ void RFIDReader::startPolling() {
 }
 
 bool RFIDReader::detectTag() {
-    static uint8_t lastStatus = 0xFF; // Track the previous status
     uint8_t bufferATQA[2] = {0};
     uint8_t bufferSize = sizeof(bufferATQA);
 
     writeToRegister(FIFOLevelReg, 0x80); // Clear FIFO buffer
 
-    qDebug() << "Sending REQA to check for tag...";
+    LOG_DEBUG("Sending REQA to check for tag...");
     uint8_t status;
-    int retryCount = 3;
-    do {
+    bool tagExpected = lastStatus == STATUS_K; // A tag answered last time: a timeout now may be a late answer
+    int retries = policy.retries();
+    for (int attempt = 0;; ++attempt) {
         status = communicateWithPICC(0x26, bufferATQA, &bufferSize);
-        if (status == STATUS_K) {
+        PiccRetryPolicy::Outcome outcome = status == STATUS_K ? PiccRetryPolicy::Ok
+            : status == STATUS_TIMEOUT ? PiccRetryPolicy::Timeout
+            : status == STATUS_COLLISION ? PiccRetryPolicy::Collision
+            : PiccRetryPolicy::Error;
+        policy.record(outcome, tagExpected);
+        if (attempt >= retries || !policy.shouldRetry(outcome)) {
             break;
         }
-        qDebug() << "Retrying REQA...";
-        QThread::msleep(50); // Wait before retrying
-    } while (retryCount-- > 0);
+        LOG_DEBUG("Retrying REQA after status %u, %d attempts left", status, retries - attempt);
+        piccRetries->inc();
+        unsigned backoff = policy.backoffMs(attempt + 1);
+        if (backoff > 0) {
+            transport->sleepMs(backoff);
+        }
+        bufferSize = sizeof(bufferATQA);
+    }
 
     if (status == lastStatus) {
         return status == STATUS_K;
@@ -138,19 +245,27 @@ bool RFIDReader::detectTag() {
     lastStatus = status;
 
     if (status == STATUS_K) {
-        qDebug() << "REQA Status:" << status;
-        qDebug() << "Tag detected!";
+        LOG_INFO("Tag detected, REQA status %u", status);
         emit tagDetected("RFID Tag Detected!");
         return true;
     } else {
-        qDebug() << "No tag detected. Status:" << status;
+        LOG_DEBUG("No tag detected, status %u", status);
         return false;
     }
 }
 
 void RFIDReader::reset() {
     writeToRegister(CommandReg, 0x0F); // Soft reset command
-    QThread::msleep(50);              // Allow time for reset to complete
+    // The oscillator restarts; reads before it runs are garbage, so wait it out before polling
+    transport->sleepMs((PCD_OSC_STARTUP_US + 999) / 1000);
+    // Then poll PowerDown instead of sleeping a fixed 50 ms; 0x00/0xFF means the bus is not answering
+    for (int waited = 0; waited < 50; ++waited) {
+        uint8_t value = readFromRegister(CommandReg);
+        if (value != 0x00 && value != 0xFF && !(value & 0x10)) {
+            break;
+        }
+        transport->sleepMs(1);
+    }
 }
 
 void RFIDReader::antennaOn() {
@@ -162,23 +277,41 @@ void RFIDReader::antennaOn() {
 
 uint8_t RFIDReader::readFromRegister(uint8_t reg) {
     uint8_t buffer[2] = {static_cast<uint8_t>(((reg << 1) & 0x7E) | 0x80), 0}; // MSB for read, LSB ignored
-    int result = wiringPiSPIDataRW(SPI_CHANNEL, buffer, sizeof(buffer));
-    if (result == -1) {
-        qDebug() << "SPI Read failed for register:" << reg;
+    bool ok = transport->transfer(buffer, sizeof(buffer));
+    spiTransactions->inc();
+    if (!ok) {
+        spiErrors->inc();
+        ++spiFailures;
+        LOG_WARN("SPI read failed for register 0x%02x", reg);
     }
     return buffer[1];
 }
 
 void RFIDReader::writeToRegister(uint8_t reg, uint8_t value) {
     uint8_t buffer[2] = {static_cast<uint8_t>((reg << 1) & 0x7E), value}; // MSB for write
-    int result = wiringPiSPIDataRW(SPI_CHANNEL, buffer, sizeof(buffer));
-    if (result == -1) {
-        qDebug() << "SPI Write failed for register:" << reg;
+    bool ok = transport->transfer(buffer, sizeof(buffer));
+    spiTransactions->inc();
+    if (!ok) {
+        spiErrors->inc();
+        ++spiFailures;
+        LOG_WARN("SPI write failed for register 0x%02x", reg);
+    }
+}
+
+uint32_t RFIDReader::setTimeout(uint8_t command) {
+    uint32_t timeoutUs = policy.timeoutUs(command);
+    uint16_t reload = piccTimerReload(timeoutUs);
+    if (reload != timerReload) {
+        writeToRegister(TReloadRegH, reload >> 8);
+        writeToRegister(TReloadRegL, reload & 0xFF);
+        timerReload = reload;
     }
+    return timeoutUs;
 }
 
 uint8_t RFIDReader::communicateWithPICC(uint8_t command, uint8_t *data, uint8_t *dataLen) {
     writeToRegister(CommandReg, 0x00);  // Idle command
+    uint32_t timeoutUs = setTimeout(command);
     writeToRegister(FIFOLevelReg, 0x80);  // Flush FIFO
 
     // Write data to FIFO
@@ -190,29 +323,44 @@ uint8_t RFIDReader::communicateWithPICC(uint8_t command, uint8_t *data, uint8_t
     writeToRegister(BitFramingReg, 0x80);  // StartSend = 1
 
     // Wait for completion
-    for (int i = 0; i < 200; i++) {
+    // The timer fires after timeoutUs; polling well past it means the chip is not running commands
+    bool completed = false;
+    int polls = int(timeoutUs / 1000) + 10;
+    for (int i = 0; i < polls; i++) {
         uint8_t irq = readFromRegister(ComIrqReg);
         if (irq & 0x01) {
-            qDebug() << "Communication timed out.";
+            LOG_DEBUG("Communication with PICC timed out, command 0x%02x", command);
             return STATUS_TIMEOUT; // Timer interrupt
         }
         if (irq & 0x30) {
+            completed = true;
             break; // RxIRq or IdleIRq
         }
-        QThread::msleep(1);
+        transport->sleepMs(1);
+    }
+    if (!completed) {
+        ++timerStalls; // The timer should have fired long ago: the chip is not running commands
+        LOG_WARN("Neither timer nor RX interrupt after command 0x%02x", command);
+        return STATUS_TIMEOUT;
     }
 
     // Check for errors
     uint8_t error = readFromRegister(ErrorReg);
     if (error & 0x13) { // BufferOvfl, ParityErr, ProtocolErr
-        qDebug() << "Communication error: ErrorReg value:" << error;
+        ++consecutiveErrors;
+        LOG_WARN("Communication error, ErrorReg 0x%02x", error);
         return STATUS_ROR;
     }
+    if (error & 0x08) { // CollErr: more than one tag answered, which is not a reader fault
+        LOG_DEBUG("Collision, CollReg 0x%02x", readFromRegister(CollReg));
+        return STATUS_COLLISION;
+    }
+    consecutiveErrors = 0;
 
     // Read received data
     uint8_t receivedLength = readFromRegister(FIFOLevelReg);
     if (receivedLength > *dataLen) {
-        qDebug() << "Received data exceeds buffer size.";
+        LOG_WARN("Received %u bytes, buffer holds %u", receivedLength, *dataLen);
         return STATUS_NO_ROOM;
     }
 
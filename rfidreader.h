@@ -4,6 +4,9 @@
 #include <QObject>
 #include <QThread>
 #include <QTimer>
+#include <memory>
+#include "piccpolicy.h"
+#include "spitransport.h"
 
 // Status codes
 #define STATUS_K            0
@@ -17,23 +20,58 @@ class RFIDReader : public QObject {
 
 public:
     explicit RFIDReader(QObject *parent = nullptr);
+    RFIDReader(int spiChannel, int resetPin, QObject *parent = nullptr); // One of several readers
     ~RFIDReader();
 
+    // Talks to the hardware through wiringPi unless another transport (recording, replay) is set
+    // before initialize(); the reader does not take ownership
+    void setTransport(SpiTransport *transport);
+
     void initialize();  // Initializes the RC522 reader
+    void runDiagnostics();  // Logs register read-backs; not needed to scan, keep it off startup
     void startPolling();  // Starts the polling loop for detecting tags
     bool detectTag();
 
+    // Stuck states a watchdog can see; checkHealth() returns a mask of them
+    enum Fault {
+        FaultNone = 0,
+        FaultVersion = 1,   // VersionReg reads no known chip, or not the one seen before
+        FaultTimer = 2,     // Transceives ended with neither the timer nor an RX/idle interrupt
+        FaultErrors = 4,    // ErrorReg reported faults on several transceives in a row
+        FaultFifo = 8,      // FIFO level does not return to 0 after a flush
+        FaultSpi = 16       // The bus itself refused transfers
+    };
+    enum Recovery { SoftReset, HardReset, ReinitSpi };
+
+    quint32 checkHealth();             // A handful of register accesses, clears the fault counters
+    bool recover(Recovery action);     // Resets and reconfigures; true when the version reads back
+
+    const PiccRetryPolicy &retryPolicy() const { return policy; }
+
 signals:
     void tagDetected(QString tagId);  // Signal emitted when a tag is detected
 
 private:
     void reset();  // Resets the RC522
+    void configure();  // Timer, modulation, mode and gain registers, then the antenna
     void antennaOn();  // Turns the antenna on
+    static bool isKnownVersion(uint8_t version);  // An RC522 or compatible, not a dead bus
+    bool versionMatches(uint8_t version);  // Known and the same chip as before; adopts the first one seen
     uint8_t readFromRegister(uint8_t reg);  // Reads a value from an RC522 register
     void writeToRegister(uint8_t reg, uint8_t value);  // Writes a value to an RC522 register
     uint8_t communicateWithPICC(uint8_t command, uint8_t *data, uint8_t *dataLen);  // Communicates with the PICC
+    uint32_t setTimeout(uint8_t command);  // Programs the frame wait time for command, returns it in us
 
+    std::unique_ptr<SpiTransport> hardware;  // Default transport
+    SpiTransport *transport;
     bool mfrc522Initialized;  // Tracks whether the RC522 has been initialized
+    uint8_t lastStatus;       // Previous REQA status, so only changes are reported
+    uint8_t expectedVersion;  // First known VersionReg value read, 0 until then
+    int consecutiveErrors;    // ErrorReg faults since the last good transceive
+    int timerStalls;          // Since the last health check
+    int spiFailures;          // Since the last health check
+    PiccRetryPolicy policy;   // Retries, backoff and timeouts learned from this reader's field
+    uint16_t timerReload;     // Last value written to TReloadReg, to skip rewriting it
 };
 
 #endif // RFIDREADER_H
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <cstring>
 #include <stdio.h>
+#include "logger.h"
 
 #define RSTPIN 25  // GPIO 25 (BCM), corresponds to physical pin 22
 #define SPI_CHANNEL 0  // SPI channel 0
@@ -111,7 +112,7 @@ bool RFIDScan::PICC_IsNewCardPresent() {
     uint8_t command[] = {PICC_CMD_REQA};
     uint8_t result = PCD_TransceiveData(command, 1, bufferATQA, &bufferSize);
 
-    printf("PICC_IsNewCardPresent - Result: %d, BufferSize: %d\n", result, bufferSize);
+    LOG_DEBUG("PICC_IsNewCardPresent - Result: %d, BufferSize: %d", result, bufferSize);
     return (result == STATUS_OK && bufferSize == 2);
 }
 
@@ -0,0 +1,45 @@
+#include "ridecounter.h"
+#include <cstring>
+
+RideCounter::RideCounter(MFRC522 *reader, TraceWriter *log, rfid_byte valueBlock, const MIFARE_Key &key)
+    : reader(reader)
+    , log(log)
+    , valueBlock(valueBlock)
+    , key(key)
+{
+}
+
+bool RideCounter::tap(RideTap *result, bool wakeHalted) {
+    uint64_t startNs = traceClockNs();
+    rfid_byte atqa[2];
+    rfid_byte atqaSize = sizeof(atqa);
+    rfid_byte status = wakeHalted ? reader->PICC_REQA_or_WUPA(PICC_CMD_WUPA, atqa, &atqaSize)
+                                  : reader->PICC_RequestA(atqa, &atqaSize);
+    if (status != STATUS_OK || reader->PICC_Select(&reader->uid) != STATUS_OK) {
+        return false;
+    }
+    result->uidLength = reader->uid.size;
+    memcpy(result->uid, reader->uid.uidbyte, reader->uid.size);
+    result->remaining = 0;
+
+    status = reader->PCD_Authenticate(PICC_CMD_MF_AUTH_KEY_A, valueBlock, &key, &reader->uid);
+    if (status == STATUS_OK) {
+        status = reader->MIFARE_DecrementTransfer(valueBlock, 1, &result->remaining);
+    }
+    if (status == STATUS_OK) {
+        // Part of the tap, not queued behind it: the ride is granted only once the record is written
+        if (!log || !log->recordValue(result->uid, result->uidLength, valueBlock, result->remaining)) {
+            // Still authenticated: give the ride back so the card is not charged for a refused tap
+            if (reader->MIFARE_Increment(valueBlock, 1) == STATUS_OK && reader->MIFARE_Transfer(valueBlock) == STATUS_OK) {
+                ++result->remaining;
+            }
+            status = STATUS_LOG_FAILED;
+        }
+    }
+    reader->PICC_HaltA();
+    reader->PCD_StopCrypto1();
+
+    result->status = status;
+    result->elapsedNs = traceClockNs() - startNs;
+    return true;
+}
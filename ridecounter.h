@@ -0,0 +1,36 @@
+#ifndef RIDECOUNTER_H
+#define RIDECOUNTER_H
+
+#include "MFRC522.h"
+#include "readertrace.h"
+
+struct RideTap {
+    rfid_byte status;      // STATUS_OK when a ride was deducted and logged
+    rfid_byte uid[10];
+    rfid_byte uidLength;
+    int32_t remaining;     // Rides left; valid for STATUS_OK and STATUS_INSUFFICIENT
+    uint64_t elapsedNs;    // From the request to the logged result
+};
+
+/**
+ * Turnstile tap on a MIFARE Classic ride card: select, authenticate the ticket sector, deduct
+ * one ride from the value block (MFRC522::MIFARE_DecrementTransfer), append the new count to
+ * the local event log and halt the card, all in one call. When the log write fails the ride is
+ * put back on the card and the tap reports STATUS_LOG_FAILED. A halted card does not answer REQA,
+ * so a card left on the reader is charged once; it has to leave the field to be charged again.
+ */
+class RideCounter {
+public:
+    RideCounter(MFRC522 *reader, TraceWriter *log, rfid_byte valueBlock, const MIFARE_Key &key);
+
+    // false when no card answered; wakeHalted (WUPA) charges a card that is already halted
+    bool tap(RideTap *result, bool wakeHalted = false);
+
+private:
+    MFRC522 *reader;
+    TraceWriter *log;
+    rfid_byte valueBlock;
+    MIFARE_Key key;
+};
+
+#endif // RIDECOUNTER_H
@@ -0,0 +1,112 @@
+#include "scanaggregator.h"
+#include "mqttmanager.h"
+#include "metrics.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <cstring>
+
+/**
+ * Turns one scan message into events. Binary payloads carry ScanEvents records; text payloads
+ * are the single {"uid","granted","ts","seq","boot"} objects DoorController::publishScan sends.
+ */
+static bool decodeScans(const QByteArray &payload, std::vector<ScanEvent> *events, quint16 *session) {
+    if (PayloadCodec::detectFormat(payload) == PayloadFormat::Binary) {
+        ScanEventReader reader(payload);
+        if (!reader.isValid()) {
+            return false;
+        }
+        *session = reader.session();
+        events->reserve(reader.count());
+        for (int i = 0; i < reader.count(); ++i) {
+            events->push_back(reader.at(i));
+        }
+        return true;
+    }
+
+    QJsonObject scan = QJsonDocument::fromJson(payload).object();
+    if (!scan.contains("uid") || !scan.contains("seq")) {
+        return false;
+    }
+    QByteArray uid = QByteArray::fromHex(scan.value("uid").toString().toLatin1());
+    ScanEvent event = {};
+    event.timestampMs = scan.value("ts").toInteger();
+    event.sequence = static_cast<quint32>(scan.value("seq").toInteger());
+    event.uidLength = static_cast<quint8>(qMin<qsizetype>(uid.size(), sizeof(event.uid)));
+    std::memcpy(event.uid, uid.constData(), event.uidLength);
+    event.decision = scan.value("granted").toBool() ? 1 : 0;
+    events->push_back(event);
+    *session = static_cast<quint16>(scan.value("boot").toInt());
+    return true;
+}
+
+ScanAggregator::ScanAggregator(MqttManager *mqtt, const QString &databasePath, QObject *parent)
+    : QObject(parent)
+    , mqttManager(mqtt)
+    , writer(new ScanIngestWriter(databasePath, this))
+    , statsTimer(new QTimer(this))
+    , malformed(0)
+{
+    connect(statsTimer, &QTimer::timeout, this, &ScanAggregator::logStats);
+}
+
+ScanAggregator::~ScanAggregator() {
+    MetricsRegistry::instance().removeOwner(this);
+    decodePool.waitForDone(); // Decoders hold a pointer to the writer
+    writer->stop();
+    writer->wait();
+}
+
+void ScanAggregator::start(const QString &filter, int statsIntervalMs) {
+    writer->start();
+
+    mqttManager->addRoute(filter, [this](const QByteArray &payload, const QMqttTopicName &topic) {
+        // The GUI/event thread only copies a reference to the payload; decoding happens on the pool
+        QString reader = topic.levelCount() > 1 ? topic.levels().at(1) : topic.name();
+        qint64 receivedMs = QDateTime::currentMSecsSinceEpoch();
+        decodePool.start([this, payload, reader, receivedMs]() {
+            ScanBatch batch{reader, receivedMs, {}};
+            if (!decodeScans(payload, &batch.events, &batch.session)) {
+                malformed.fetchAndAddRelaxed(1);
+                return;
+            }
+            writer->submit(std::move(batch));
+        });
+    });
+
+    MetricsRegistry &registry = MetricsRegistry::instance();
+    using Type = MetricsRegistry::Type;
+    registry.addCallback("rfid_ingest_received_total", "Scan events decoded from readers", Type::Counter,
+                         [this]() { return double(writer->stats().received); }, this);
+    registry.addCallback("rfid_ingest_committed_total", "Scan events stored in scan_events", Type::Counter,
+                         [this]() { return double(writer->stats().committed); }, this);
+    registry.addCallback("rfid_ingest_queued", "Scan events waiting for the next commit", Type::Gauge,
+                         [this]() { return double(writer->stats().queued); }, this);
+    registry.addCallback("rfid_ingest_missing_total", "Events lost between reader and aggregator", Type::Counter,
+                         [this]() { return double(writer->stats().missing); }, this);
+    registry.addCallback("rfid_ingest_dropped_total", "Events refused because the queue was full", Type::Counter,
+                         [this]() { return double(writer->stats().dropped); }, this);
+    registry.addCallback("rfid_ingest_readers", "Readers seen since start", Type::Gauge,
+                         [this]() { return double(writer->stats().readers); }, this);
+    registry.addCallback("rfid_ingest_malformed_total", "Scan messages that could not be decoded", Type::Counter,
+                         [this]() { return double(malformed.loadRelaxed()); }, this);
+
+    statsClock.start();
+    statsTimer->start(statsIntervalMs);
+    qDebug() << "Aggregating scans from" << filter << "with" << decodePool.maxThreadCount() << "decode threads";
+}
+
+void ScanAggregator::logStats() {
+    IngestStats now = writer->stats();
+    double seconds = statsClock.restart() / 1000.0;
+    quint64 committed = now.committed - lastStats.committed;
+    quint64 commits = now.commits - lastStats.commits;
+    qDebug().nospace() << "Aggregator: " << qRound(committed / qMax(seconds, 0.001)) << " events/s, "
+                       << (commits > 0 ? committed / commits : 0) << " per commit, "
+                       << (commits > 0 ? (now.commitNs - lastStats.commitNs) / qint64(commits) / 1000 : 0)
+                       << " us per commit, " << now.readers << " readers, " << now.missing << " missing, "
+                       << now.late << " late, " << now.duplicates << " duplicates, " << now.dropped
+                       << " dropped, " << malformedMessages() << " malformed";
+    lastStats = now;
+}
@@ -0,0 +1,42 @@
+#ifndef SCANAGGREGATOR_H
+#define SCANAGGREGATOR_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+#include "scaningestwriter.h"
+
+class MqttManager;
+
+// Server side of the fleet: subscribes to the scan streams of every reader, decodes the
+// payloads (binary or JSON) on a worker pool and stores them through a ScanIngestWriter.
+class ScanAggregator : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScanAggregator(MqttManager *mqttManager, const QString &databasePath, QObject *parent = nullptr);
+    ~ScanAggregator();
+
+    void setDecodeThreads(int threads) { decodePool.setMaxThreadCount(threads); }
+    void start(const QString &filter = "site/+/scans", int statsIntervalMs = 10000);
+    ScanIngestWriter *ingestWriter() const { return writer; }
+    quint64 malformedMessages() const { return malformed.loadRelaxed(); }
+
+private slots:
+    void logStats();
+
+private:
+    MqttManager *mqttManager;
+    ScanIngestWriter *writer;
+    QThreadPool decodePool;
+    QTimer *statsTimer;
+    QElapsedTimer statsClock;
+    IngestStats lastStats;
+    QAtomicInteger<quint64> malformed;
+};
+
+#endif // SCANAGGREGATOR_H
@@ -0,0 +1,73 @@
+#include "scanfeedmodel.h"
+#include <QBrush>
+#include <QDateTime>
+
+ScanFeedModel::ScanFeedModel(int size, QObject *parent)
+    : QAbstractListModel(parent)
+    , capacity(qMax(1, size))
+    , ring(capacity)
+    , newest(-1)
+    , rows(0)
+    , dropped(0)
+{
+}
+
+void ScanFeedModel::post(const QString &text, FeedEntry::Kind kind) {
+    if (static_cast<int>(pending.size()) == capacity) {
+        pending.pop_front(); // More than a screenful per frame, the oldest would scroll away anyway
+        ++dropped;
+    }
+    pending.push_back({QDateTime::currentMSecsSinceEpoch(), text, kind});
+}
+
+bool ScanFeedModel::flush() {
+    if (pending.empty()) {
+        return false;
+    }
+    int incoming = static_cast<int>(pending.size());
+
+    // Make room by dropping the oldest rows at the bottom first
+    int overflow = rows + incoming - capacity;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), rows - overflow, rows - 1);
+        rows -= overflow;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), 0, incoming - 1);
+    for (FeedEntry &entry : pending) {
+        newest = (newest + 1) % capacity;
+        ring[newest] = std::move(entry);
+    }
+    rows += incoming;
+    endInsertRows();
+
+    pending.clear();
+    return true;
+}
+
+int ScanFeedModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : rows;
+}
+
+QVariant ScanFeedModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= rows) {
+        return QVariant();
+    }
+    const FeedEntry &entry = ring[(newest - index.row() + capacity) % capacity];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return QDateTime::fromMSecsSinceEpoch(entry.timestampMs).toString("hh:mm:ss ") + entry.text;
+    case Qt::ForegroundRole:
+        if (entry.kind == FeedEntry::Granted) {
+            return QBrush(Qt::darkGreen);
+        }
+        if (entry.kind == FeedEntry::Denied) {
+            return QBrush(Qt::red);
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
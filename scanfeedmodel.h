@@ -0,0 +1,42 @@
+#ifndef SCANFEEDMODEL_H
+#define SCANFEEDMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <deque>
+#include <vector>
+
+struct FeedEntry {
+    enum Kind : quint8 { Info, Granted, Denied };
+    qint64 timestampMs;
+    QString text;
+    Kind kind;
+};
+
+// Live scan feed for a QListView, newest first. Holds at most `capacity` rows in a ring, so
+// memory stays flat however long the door runs, and the view only paints the visible rows.
+// post() just queues; flush() applies everything queued since the last frame in one insert.
+class ScanFeedModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit ScanFeedModel(int capacity = 500, QObject *parent = nullptr);
+
+    void post(const QString &text, FeedEntry::Kind kind = FeedEntry::Info);
+    bool flush(); // true when rows changed
+    quint64 coalesced() const { return dropped; } // Entries that never reached the view
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    int capacity;
+    std::vector<FeedEntry> ring;   // Visible rows, entries[newest] is row 0
+    int newest;
+    int rows;
+    std::deque<FeedEntry> pending; // Bounded by capacity, oldest overwritten first
+    quint64 dropped;
+};
+
+#endif // SCANFEEDMODEL_H
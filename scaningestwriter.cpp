@@ -0,0 +1,219 @@
+#include "scaningestwriter.h"
+#include "logger.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+
+static const char *WRITER_CONNECTION = "scan-ingest";
+
+SequenceTracker::Result SequenceTracker::observe(const QString &reader, quint16 session, quint32 sequence,
+                                                 quint32 *skipped) {
+    *skipped = 0;
+    auto it = states.find(reader);
+    if (it == states.end()) {
+        ReaderState state;
+        state.session = session;
+        state.current.last = sequence;
+        states.insert(reader, state);
+        return InOrder;
+    }
+
+    ReaderState &state = *it;
+    if (session == state.session) {
+        Result result = advance(state.current, sequence, skipped);
+        if (result == Duplicate && session == 0 && state.current.last - sequence > RESTART_WINDOW) {
+            // A sender without sessions: only a large step back can tell a restart apart
+            state.current = SessionState{sequence, {}};
+            return Restart;
+        }
+        return result;
+    }
+    if (state.hasPrevious && session == state.previousSession) {
+        return advance(state.previous, sequence, skipped); // Stragglers from before the restart
+    }
+
+    // A session we have not seen: the reader restarted, and its numbering with it
+    state.hasPrevious = true;
+    state.previousSession = state.session;
+    state.previous = std::move(state.current);
+    state.session = session;
+    state.current = SessionState{sequence, {}};
+    return Restart;
+}
+
+SequenceTracker::Result SequenceTracker::advance(SessionState &state, quint32 sequence, quint32 *skipped) {
+    if (sequence == state.last + 1) {
+        state.last = sequence;
+        return InOrder;
+    }
+    if (sequence > state.last) {
+        *skipped = sequence - state.last - 1;
+        for (quint32 s = state.last + 1; s < sequence && state.skipped.size() < MAX_REMEMBERED; ++s) {
+            state.skipped.insert(s);
+        }
+        state.last = sequence;
+        return Gap;
+    }
+    if (state.skipped.remove(sequence)) {
+        return Late;
+    }
+    return Duplicate;
+}
+
+ScanIngestWriter::ScanIngestWriter(const QString &path, QObject *parent)
+    : QThread(parent)
+    , databasePath(path)
+    , commitThreshold(2000)
+    , maxDelayMs(20)
+    , maxQueued(200000)
+    , queuedEvents(0)
+    , stopping(false)
+{
+}
+
+ScanIngestWriter::~ScanIngestWriter() {
+    stop();
+    wait();
+}
+
+bool ScanIngestWriter::submit(ScanBatch &&batch) {
+    QMutexLocker locker(&mutex);
+    int events = static_cast<int>(batch.events.size());
+    if (stopping || queuedEvents + events > maxQueued) {
+        counters.dropped += events;
+        return false;
+    }
+    counters.received += events;
+    queuedEvents += events;
+    queue.push_back(std::move(batch));
+    // Wake the writer for the first batch and once a full group is waiting, not for every message
+    if (queue.size() == 1 || queuedEvents >= commitThreshold) {
+        wake.wakeOne();
+    }
+    return true;
+}
+
+void ScanIngestWriter::stop() {
+    QMutexLocker locker(&mutex);
+    stopping = true;
+    wake.wakeOne();
+}
+
+IngestStats ScanIngestWriter::stats() const {
+    QMutexLocker locker(&mutex);
+    IngestStats current = counters;
+    current.queued = queuedEvents;
+    return current;
+}
+
+void ScanIngestWriter::run() {
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", WRITER_CONNECTION);
+        db.setDatabaseName(databasePath);
+        if (!db.open()) {
+            qDebug() << "Scan ingest: unable to open" << databasePath << ":" << db.lastError().text();
+            return;
+        }
+        // The schema and WAL mode come from DatabaseManager on the main connection
+        QSqlQuery(db).exec("PRAGMA busy_timeout = 5000");
+        QSqlQuery(db).exec("PRAGMA synchronous = NORMAL");
+
+        QSqlQuery insert(db);
+        insert.prepare("INSERT INTO scan_events (reader, seq, ts, uid, granted, received) VALUES (?, ?, ?, ?, ?, ?)");
+
+        std::vector<ScanBatch> work;
+        for (;;) {
+            {
+                QMutexLocker locker(&mutex);
+                while (queue.empty() && !stopping) {
+                    wake.wait(&mutex);
+                }
+                if (queue.empty()) {
+                    break; // Stopping with nothing left
+                }
+                // Group commit: let more events gather unless a full group is already here
+                if (!stopping && queuedEvents < commitThreshold) {
+                    wake.wait(&mutex, maxDelayMs);
+                }
+                work.swap(queue);
+                queuedEvents = 0;
+            }
+            store(work, db, insert);
+            work.clear();
+        }
+        insert.finish();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(WRITER_CONNECTION);
+}
+
+void ScanIngestWriter::store(std::vector<ScanBatch> &batches, QSqlDatabase &db, QSqlQuery &insert) {
+    QElapsedTimer timer;
+    timer.start();
+
+    IngestStats delta;
+    bool ok = db.transaction();
+    for (const ScanBatch &batch : batches) {
+        for (const ScanEvent &event : batch.events) {
+            quint32 skipped = 0;
+            switch (tracker.observe(batch.reader, batch.session, event.sequence, &skipped)) {
+            case SequenceTracker::Duplicate:
+                ++delta.duplicates;
+                continue; // QoS 1 redelivery, already stored
+            case SequenceTracker::Gap:
+                delta.missing += skipped;
+                LOG_WARN("Scan ingest: %s skipped %u events before %u", qPrintable(batch.reader), skipped,
+                         event.sequence);
+                break;
+            case SequenceTracker::Late:
+                ++delta.late;
+                break;
+            case SequenceTracker::Restart:
+                ++delta.restarts;
+                break;
+            case SequenceTracker::InOrder:
+                break;
+            }
+            if (!ok) {
+                ++delta.failed;
+                continue;
+            }
+
+            insert.bindValue(0, batch.reader);
+            insert.bindValue(1, event.sequence);
+            insert.bindValue(2, event.timestampMs);
+            insert.bindValue(3, QByteArray(reinterpret_cast<const char *>(event.uid), event.uidLength));
+            insert.bindValue(4, event.decision);
+            insert.bindValue(5, batch.receivedMs);
+            if (insert.exec()) {
+                ++delta.committed;
+            } else {
+                ++delta.failed;
+            }
+        }
+    }
+
+    if (ok && !db.commit()) {
+        qDebug() << "Scan ingest: commit failed:" << db.lastError().text();
+        db.rollback();
+        delta.failed += delta.committed;
+        delta.committed = 0;
+        ok = false;
+    }
+    if (ok && committed) {
+        committed(batches);
+    }
+
+    QMutexLocker locker(&mutex);
+    counters.committed += delta.committed;
+    counters.commits += ok ? 1 : 0;
+    counters.failed += delta.failed;
+    counters.missing += delta.missing;
+    counters.late += delta.late;
+    counters.duplicates += delta.duplicates;
+    counters.restarts += delta.restarts;
+    counters.readers = tracker.readers();
+    counters.commitNs += timer.nsecsElapsed();
+}
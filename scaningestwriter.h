@@ -0,0 +1,113 @@
+#ifndef SCANINGESTWRITER_H
+#define SCANINGESTWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <functional>
+#include <vector>
+
+#include "payloadcodec.h"
+
+class QSqlDatabase;
+class QSqlQuery;
+
+// Scan events decoded from one inbound message
+struct ScanBatch {
+    QString reader;              // Second level of site/<reader>/scans
+    qint64 receivedMs;
+    std::vector<ScanEvent> events;
+    quint16 session = 0;         // Sender's per-process session, 0 if it does not send one
+};
+
+struct IngestStats {
+    quint64 received = 0;        // Events handed to the writer
+    quint64 queued = 0;          // Waiting for the next commit
+    quint64 committed = 0;       // Events stored
+    quint64 commits = 0;         // Transactions, committed / commits is the group size
+    quint64 dropped = 0;         // Refused because the queue was full
+    quint64 failed = 0;          // Lost to a failed transaction
+    quint64 missing = 0;         // Sequence numbers skipped by a reader
+    quint64 late = 0;            // Skipped numbers that turned up afterwards
+    quint64 duplicates = 0;      // Redelivered events, not stored again
+    quint64 restarts = 0;        // Readers whose sequence started over
+    quint64 readers = 0;
+    qint64 commitNs = 0;         // Time spent inside transactions
+};
+
+// Per reader sequence bookkeeping. Events may arrive out of order because batches are decoded
+// in parallel, so skipped numbers are remembered for a while and count as late if they show up.
+// Sequences are tracked per sender session: a new session is a restart however low its numbers
+// are, and the previous session is kept so its late redeliveries are still recognised.
+class SequenceTracker {
+public:
+    enum Result { InOrder, Gap, Late, Duplicate, Restart };
+
+    Result observe(const QString &reader, quint16 session, quint32 sequence, quint32 *skipped);
+    int readers() const { return states.size(); }
+
+private:
+    static constexpr int MAX_REMEMBERED = 4096; // Skipped numbers kept per reader
+    static constexpr quint32 RESTART_WINDOW = 4096; // Without a session, a bigger step back is a restart
+
+    struct SessionState {
+        quint32 last = 0;
+        QSet<quint32> skipped;
+    };
+    struct ReaderState {
+        quint16 session = 0;
+        SessionState current;
+        bool hasPrevious = false;
+        quint16 previousSession = 0;
+        SessionState previous;
+    };
+    static Result advance(SessionState &state, quint32 sequence, quint32 *skipped);
+    QHash<QString, ReaderState> states;
+};
+
+// Group-commit writer for the aggregator. Producers on any thread hand over decoded batches;
+// one thread with its own SQLite connection stores everything queued in a single transaction,
+// waiting a few milliseconds for more work so commits stay large under load.
+class ScanIngestWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit ScanIngestWriter(const QString &databasePath, QObject *parent = nullptr);
+    ~ScanIngestWriter();
+
+    void setCommitThreshold(int events) { commitThreshold = events; } // Commit at once past this many
+    void setMaxDelayMs(int ms) { maxDelayMs = ms; }                   // Longest an event waits otherwise
+    void setMaxQueued(int events) { maxQueued = events; }
+    // Called on the writer thread after each successful commit; set it before start()
+    void setCommitObserver(std::function<void(const std::vector<ScanBatch> &)> observer) { committed = observer; }
+
+    bool submit(ScanBatch &&batch); // Thread-safe; false when the queue is full
+    void stop();                    // Commits what is queued, then the thread ends
+    IngestStats stats() const;
+
+protected:
+    void run() override;
+
+private:
+    void store(std::vector<ScanBatch> &batches, QSqlDatabase &db, QSqlQuery &insert);
+
+    QString databasePath;
+    std::function<void(const std::vector<ScanBatch> &)> committed;
+    int commitThreshold;
+    int maxDelayMs;
+    int maxQueued;
+
+    mutable QMutex mutex;
+    QWaitCondition wake;
+    std::vector<ScanBatch> queue;
+    int queuedEvents;
+    bool stopping;
+    IngestStats counters;
+    SequenceTracker tracker; // Only touched by the writer thread
+};
+
+#endif // SCANINGESTWRITER_H
@@ -0,0 +1,146 @@
+#include "scanpublisher.h"
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+ScanPublisher::ScanPublisher(PublishTransport *publishTransport, const QString &spillDirectory, QObject *parent)
+    : QObject(parent)
+    , transport(publishTransport)
+    , spillLog(spillDirectory)
+    , retryTimer(new QTimer(this))
+    , maxQueued(1000)
+    , maxInFlight(16)
+{
+    retryTimer->setSingleShot(true);
+    retryTimer->setInterval(100);
+    connect(retryTimer, &QTimer::timeout, this, &ScanPublisher::pump);
+}
+
+void ScanPublisher::enqueue(const QString &topic, const QByteArray &payload, quint8 qos, quint32 tag) {
+    SpilledMessage message{topic, payload, qos, QDateTime::currentMSecsSinceEpoch(), tag};
+
+    if (!transport->isConnected() || inMemory() >= static_cast<size_t>(maxQueued)) {
+        // Anything in tail is older than this message, so it goes to disk first to keep the order
+        spillTail();
+        spill(message);
+    } else if (spillLog.isEmpty()) {
+        queue.push_back(std::move(message));
+    } else {
+        tail.push_back(std::move(message)); // Behind the spilled messages, but without the disk
+    }
+
+    pump();
+}
+
+bool ScanPublisher::spill(const SpilledMessage &message) {
+    if (!spillLog.append(message)) {
+        ++counters.dropped;
+        return false;
+    }
+    ++counters.totalSpilled;
+    return true;
+}
+
+void ScanPublisher::spillTail() {
+    for (const SpilledMessage &message : tail) {
+        spill(message);
+    }
+    tail.clear();
+}
+
+void ScanPublisher::refill() {
+    SpilledMessage message;
+    while (queue.size() < static_cast<size_t>(maxQueued) && spillLog.readNext(&message)) {
+        queue.push_back(std::move(message));
+    }
+    if (spillLog.isEmpty()) {
+        // The disk has drained, so tail is next in line and new messages can go straight to queue
+        std::move(tail.begin(), tail.end(), std::back_inserter(queue));
+        tail.clear();
+    }
+}
+
+void ScanPublisher::pump() {
+    if (!transport->isConnected()) {
+        return;
+    }
+
+    refill();
+    while (!queue.empty()) {
+        SpilledMessage &message = queue.front();
+        if (message.qos > 0 && inFlightById.size() >= maxInFlight) {
+            return; // Window full, the next acknowledgement resumes sending
+        }
+
+        qint32 id = transport->publish(message.topic, message.payload, message.qos);
+        if (id < 0) {
+            if (!retryTimer->isActive()) {
+                retryTimer->start(); // Client refused, retry shortly
+            }
+            return;
+        }
+
+        if (message.qos == 0 || id == 0) {
+            counters.lastLatencyMs = QDateTime::currentMSecsSinceEpoch() - message.enqueuedMs;
+            counters.maxLatencyMs = qMax(counters.maxLatencyMs, counters.lastLatencyMs);
+            ++counters.published;
+            if (message.tag != 0) {
+                emit delivered(message.tag);
+            }
+        } else {
+            inFlightById.insert(id, std::move(message));
+            inFlightOrder.push_back(id);
+        }
+        queue.pop_front();
+
+        if (queue.empty()) {
+            refill();
+        }
+    }
+}
+
+void ScanPublisher::acknowledge(qint32 messageId) {
+    auto it = inFlightById.find(messageId);
+    if (it == inFlightById.end()) {
+        return; // Not ours, e.g. a database batch published directly
+    }
+
+    counters.lastLatencyMs = QDateTime::currentMSecsSinceEpoch() - it->enqueuedMs;
+    counters.maxLatencyMs = qMax(counters.maxLatencyMs, counters.lastLatencyMs);
+    ++counters.published;
+    quint32 tag = it->tag;
+    inFlightById.erase(it);
+    inFlightOrder.erase(std::find(inFlightOrder.begin(), inFlightOrder.end(), messageId));
+    if (tag != 0) {
+        emit delivered(tag);
+    }
+
+    pump();
+}
+
+void ScanPublisher::connectionChanged(bool connected) {
+    if (!connected) {
+        retryTimer->stop();
+        // Messages enqueued from now on are spilled, and they must land behind tail
+        spillTail();
+
+        // Unacknowledged messages go back to the head of the queue in their original order
+        for (auto it = inFlightOrder.rbegin(); it != inFlightOrder.rend(); ++it) {
+            queue.push_front(inFlightById.take(*it));
+        }
+        inFlightOrder.clear();
+        inFlightById.clear();
+        return;
+    }
+    pump();
+}
+
+PublisherStats ScanPublisher::stats() const {
+    PublisherStats current = counters;
+    current.queued = inMemory();
+    current.spilled = spillLog.pending();
+    current.spilledBytes = spillLog.pendingSize();
+    current.inFlight = inFlightById.size();
+    return current;
+}
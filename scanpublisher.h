@@ -0,0 +1,82 @@
+#ifndef SCANPUBLISHER_H
+#define SCANPUBLISHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QTimer>
+#include <deque>
+
+#include "segmentlog.h"
+
+// Where the publisher sends messages. MqttManager implements it for the real broker;
+// a stand-in only has to record publishes and call ScanPublisher::acknowledge.
+class PublishTransport {
+public:
+    virtual ~PublishTransport() = default;
+    virtual bool isConnected() const = 0;
+    // Returns the packet id for QoS 1/2, 0 for QoS 0 and -1 when the message was not accepted
+    virtual qint32 publish(const QString &topic, const QByteArray &payload, quint8 qos) = 0;
+};
+
+struct PublisherStats {
+    quint64 queued = 0;          // Messages waiting in memory
+    quint64 spilled = 0;         // Messages waiting on disk
+    quint64 spilledBytes = 0;    // Bytes waiting on disk
+    quint64 totalSpilled = 0;    // Messages ever written to disk
+    quint64 inFlight = 0;        // Sent but not yet acknowledged
+    quint64 published = 0;       // Acknowledged (or sent, for QoS 0)
+    quint64 dropped = 0;         // Lost because the disk refused them
+    qint64 lastLatencyMs = 0;    // Enqueue to acknowledgement of the latest message
+    qint64 maxLatencyMs = 0;
+};
+
+// Store-and-forward publisher: bounded memory queue, spill to a segment log while the broker
+// is unreachable or the queue is full, in-order replay after reconnect and a QoS-aware
+// in-flight window. Delivery is at-least-once for QoS > 0.
+//
+// Order is queue, then spillLog, then tail: messages that arrive while older ones are still on
+// disk wait in tail instead of taking a disk round trip, as long as memory has room.
+class ScanPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScanPublisher(PublishTransport *transport, const QString &spillDirectory, QObject *parent = nullptr);
+
+    void setMaxQueued(int messages) { maxQueued = messages; }
+    void setMaxInFlight(int messages) { maxInFlight = messages; }
+
+    // A non-zero tag is reported through delivered() once the broker has the message
+    void enqueue(const QString &topic, const QByteArray &payload, quint8 qos = 1, quint32 tag = 0);
+    PublisherStats stats() const;
+
+signals:
+    void delivered(quint32 tag);
+
+public slots:
+    void acknowledge(qint32 messageId);  // Broker confirmed a QoS 1/2 message
+    void connectionChanged(bool connected);
+
+private slots:
+    void pump();
+
+private:
+    void refill();
+    bool spill(const SpilledMessage &message);
+    void spillTail();
+    size_t inMemory() const { return queue.size() + tail.size(); }
+
+    PublishTransport *transport;
+    SegmentLog spillLog;
+    std::deque<SpilledMessage> queue;           // Oldest; spillLog holds everything newer
+    std::deque<SpilledMessage> tail;            // Newer than everything in spillLog
+    QTimer *retryTimer;                         // Single shot, restarted while the client refuses
+    QHash<qint32, SpilledMessage> inFlightById;
+    std::deque<qint32> inFlightOrder;           // Send order, for requeueing after a disconnect
+    int maxQueued;
+    int maxInFlight;
+    PublisherStats counters;
+};
+
+#endif // SCANPUBLISHER_H
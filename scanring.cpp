@@ -0,0 +1,215 @@
+#include "scanring.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t ringBytes(uint32_t capacity) {
+    return sizeof(ScanRingHeader) + (capacity - 1) * sizeof(ScanRingRecord);
+}
+
+ScanRingProducer::ScanRingProducer()
+    : ring(nullptr)
+    , mappedBytes(0)
+    , wakeFd(-1)
+    , sequence(0)
+{
+}
+
+ScanRingProducer::~ScanRingProducer() {
+    detach();
+}
+
+bool ScanRingProducer::attach(const char *name, int fd) {
+    detach();
+    int shm = shm_open(name, O_RDWR, 0);
+    if (shm == -1) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(shm, &info) == -1 || size_t(info.st_size) < sizeof(ScanRingHeader)) {
+        close(shm);
+        return false;
+    }
+    void *memory = mmap(nullptr, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+    close(shm);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    ScanRingHeader *header = static_cast<ScanRingHeader *>(memory);
+    if (header->magic != SCANRING_MAGIC || header->version != SCANRING_VERSION
+        || header->recordBytes != sizeof(ScanRingRecord) || ringBytes(header->capacity) > size_t(info.st_size)) {
+        munmap(memory, size_t(info.st_size));
+        return false;
+    }
+    ring = header;
+    mappedBytes = size_t(info.st_size);
+
+    if (fd < 0) {
+        const char *inherited = getenv("RFID_SCAN_EVENTFD");
+        fd = inherited ? atoi(inherited) : -1;
+    }
+    wakeFd = fd;
+    ring->producerWakes.store(wakeFd >= 0 ? 1 : 0, std::memory_order_release);
+    wake(); // The consumer re-checks which rings it still has to poll
+    return true;
+}
+
+void ScanRingProducer::wake() {
+    if (wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+bool ScanRingProducer::attachFromEnvironment() {
+    const char *name = getenv("RFID_SCAN_RING");
+    return name && attach(name, -1);
+}
+
+void ScanRingProducer::detach() {
+    if (ring) {
+        if (wakeFd >= 0) {
+            // Whoever attaches next may not have the fd: make the consumer poll again
+            ring->producerWakes.store(0, std::memory_order_release);
+            wake();
+        }
+        munmap(ring, mappedBytes);
+        ring = nullptr;
+    }
+}
+
+bool ScanRingProducer::push(const uint8_t *uid, int length, uint64_t reqaNs, uint64_t selectedNs) {
+    if (!ring) {
+        return false;
+    }
+    ++sequence;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= ring->capacity) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ScanRingRecord &record = ring->records[head & (ring->capacity - 1)];
+    record.reqaNs = reqaNs;
+    record.selectedNs = selectedNs;
+    record.sequence = sequence;
+    record.uidLength = uint8_t(length < 0 ? 0 : length > 10 ? 10 : length);
+    memcpy(record.uid, uid, record.uidLength);
+    record.reserved = 0;
+
+    // seq_cst on both sides: either the consumer sees this record after flagging that it sleeps,
+    // or this producer sees the flag and wakes it
+    ring->head.store(head + 1, std::memory_order_seq_cst);
+    if (wakeFd >= 0 && ring->consumerSleeping.exchange(0, std::memory_order_seq_cst)) {
+        wake();
+    }
+    return true;
+}
+
+ScanRingConsumer::ScanRingConsumer()
+    : ring(nullptr)
+    , mappedBytes(0)
+    , capacity(0)
+{
+    name[0] = '\0';
+}
+
+ScanRingConsumer::~ScanRingConsumer() {
+    if (ring) {
+        munmap(ring, mappedBytes);
+        shm_unlink(name);
+    }
+}
+
+bool ScanRingConsumer::create(const char *ringName, uint32_t ringCapacity) {
+    if (ring || ringCapacity == 0 || (ringCapacity & (ringCapacity - 1)) != 0 || strlen(ringName) >= sizeof(name)) {
+        return false;
+    }
+    shm_unlink(ringName); // A ring left behind by a crash has stale indices
+    int shm = shm_open(ringName, O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (shm == -1) {
+        return false;
+    }
+    size_t bytes = ringBytes(ringCapacity);
+    if (ftruncate(shm, off_t(bytes)) == -1) {
+        close(shm);
+        shm_unlink(ringName);
+        return false;
+    }
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+    close(shm);
+    if (memory == MAP_FAILED) {
+        shm_unlink(ringName);
+        return false;
+    }
+
+    // ftruncate zero-fills, which is a valid state for every index and flag
+    ring = static_cast<ScanRingHeader *>(memory);
+    ring->version = SCANRING_VERSION;
+    ring->capacity = ringCapacity;
+    capacity = ringCapacity; // Producers can write the header; index with our own copy
+    ring->recordBytes = sizeof(ScanRingRecord);
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = SCANRING_MAGIC; // Last, so a producer never attaches to a half-built ring
+    mappedBytes = bytes;
+    strcpy(name, ringName);
+    return true;
+}
+
+bool ScanRingConsumer::pop(ScanRingRecord *record) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    if (head - tail > capacity) {
+        // No well-behaved producer gets this far ahead: skip whatever it wrote rather than
+        // spin through a corrupted head
+        ring->tail.store(head, std::memory_order_release);
+        return false;
+    }
+    *record = ring->records[tail & (capacity - 1)];
+    ring->tail.store(tail + 1, std::memory_order_release);
+    if (record->uidLength > sizeof(record->uid)) {
+        record->uidLength = sizeof(record->uid); // The copy is ours; the length came from shared memory
+    }
+    return true;
+}
+
+bool ScanRingConsumer::prepareToSleep() {
+    ring->consumerSleeping.store(1, std::memory_order_seq_cst);
+    if (ring->head.load(std::memory_order_seq_cst) != ring->tail.load(std::memory_order_relaxed)) {
+        ring->consumerSleeping.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+uint64_t ScanRingConsumer::depth() const {
+    if (!ring) {
+        return 0;
+    }
+    return ring->head.load(std::memory_order_relaxed) - ring->tail.load(std::memory_order_relaxed);
+}
+
+void *scanring_attach(const char *name, int wakeFd) {
+    ScanRingProducer *producer = new ScanRingProducer;
+    if (!producer->attach(name, wakeFd)) {
+        delete producer;
+        return nullptr;
+    }
+    return producer;
+}
+
+int scanring_push(void *ring, const uint8_t *uid, int length, uint64_t reqaNs, uint64_t selectedNs) {
+    return static_cast<ScanRingProducer *>(ring)->push(uid, length, reqaNs, selectedNs) ? 1 : 0;
+}
+
+void scanring_detach(void *ring) {
+    delete static_cast<ScanRingProducer *>(ring);
+}
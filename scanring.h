@@ -0,0 +1,103 @@
+#ifndef SCANRING_H
+#define SCANRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Shared-memory single-producer/single-consumer ring of fixed-size scan records, one ring per
+ * scanner process. The app creates the ring (POSIX shm, e.g. /rfid-scans) and an eventfd; a
+ * producer attaches by name and pushes binary records: no pipe, no text, no parsing.
+ *
+ * Wakeups: the consumer sets `consumerSleeping` before it waits on the eventfd and re-checks
+ * the ring; a producer writes the eventfd only when it clears that flag. Under load the consumer
+ * is busy draining and producers make no syscall at all.
+ *
+ * The eventfd reaches the producer by inheritance: the app starts its own scanner with
+ * RFID_SCAN_RING=<name> and RFID_SCAN_EVENTFD=<fd> in the environment. A producer started some
+ * other way attaches without a wake fd; `producerWakes` tells the consumer which rings it still
+ * has to poll. A producer with the fd wakes the consumer on attach and detach so it re-checks.
+ */
+
+#define SCANRING_MAGIC 0x52465352u // "RFSR"
+#define SCANRING_VERSION 1
+
+struct ScanRingRecord {
+    uint64_t reqaNs;      // CLOCK_MONOTONIC when the tag answered REQA, 0 if unknown
+    uint64_t selectedNs;  // CLOCK_MONOTONIC when the UID was selected, 0 if unknown
+    uint32_t sequence;    // Per producer, counts pushes including dropped ones
+    uint8_t uidLength;
+    uint8_t uid[10];
+    uint8_t reserved;
+};
+static_assert(sizeof(ScanRingRecord) == 32, "ScanRingRecord is part of the shared layout");
+
+struct ScanRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;    // Records, a power of two
+    uint32_t recordBytes;
+    alignas(64) std::atomic<uint64_t> head;             // Next record the producer writes
+    std::atomic<uint64_t> dropped;                      // Pushes refused because the ring was full
+    alignas(64) std::atomic<uint64_t> tail;             // Next record the consumer reads
+    std::atomic<uint32_t> consumerSleeping;
+    std::atomic<uint32_t> producerWakes;                // 1 while the attached producer has the eventfd
+    alignas(64) ScanRingRecord records[1];              // capacity records
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs address-free 64-bit atomics");
+
+// Producer side: the C++ client library (the C functions below wrap it for Python)
+class ScanRingProducer {
+public:
+    ScanRingProducer();
+    ~ScanRingProducer();
+
+    bool attach(const char *name, int wakeFd = -1); // wakeFd -1 reads RFID_SCAN_EVENTFD
+    bool attachFromEnvironment();                   // RFID_SCAN_RING and RFID_SCAN_EVENTFD
+    void detach();
+    bool isAttached() const { return ring != nullptr; }
+
+    // Never blocks; false (and counted in the ring) when the consumer is behind
+    bool push(const uint8_t *uid, int length, uint64_t reqaNs = 0, uint64_t selectedNs = 0);
+
+private:
+    void wake(); // Writes the eventfd, if this producer has one
+
+    ScanRingHeader *ring;
+    size_t mappedBytes;
+    int wakeFd;
+    uint32_t sequence;
+};
+
+// Consumer side, owned by the app
+class ScanRingConsumer {
+public:
+    ScanRingConsumer();
+    ~ScanRingConsumer(); // Unmaps and unlinks the shared memory
+
+    bool create(const char *name, uint32_t capacity);
+    bool pop(ScanRingRecord *record);
+    // Call before waiting on the eventfd; false if records arrived meanwhile (do not wait)
+    bool prepareToSleep();
+    uint64_t dropped() const { return ring ? ring->dropped.load(std::memory_order_relaxed) : 0; }
+    uint64_t depth() const;
+    // false until a producer with the eventfd attaches; such rings need the fallback poll
+    bool producerWakes() const { return ring && ring->producerWakes.load(std::memory_order_acquire); }
+    void forgetProducer() { ring->producerWakes.store(0, std::memory_order_release); } // It exited without detaching
+
+private:
+    ScanRingHeader *ring;
+    size_t mappedBytes;
+    uint32_t capacity; // As created; the shared header is writable by producers
+    char name[64];
+};
+
+extern "C" {
+// Minimal C ABI for ctypes (scanring.py); a null handle means attach failed
+void *scanring_attach(const char *name, int wakeFd);
+int scanring_push(void *ring, const uint8_t *uid, int length, uint64_t reqaNs, uint64_t selectedNs);
+void scanring_detach(void *ring);
+}
+
+#endif // SCANRING_H
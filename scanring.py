@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+# -*- coding: utf8 -*-
+#
+# Producer side of the shared-memory scan rings (scanring.h), through libscanring.so.
+#
+#   ring = scanring.attach_from_environment()  # RFID_SCAN_RING / RFID_SCAN_EVENTFD, None if unset
+#   if ring:
+#       ring.push(uid, reqa_ns, selected_ns)
+#
+# The library is looked up in RFID_SCANRING_LIB, next to this file, then on the loader path.
+
+import ctypes
+import os
+
+_lib = None
+
+
+def _load():
+    global _lib
+    if _lib is not None:
+        return _lib
+    here = os.path.dirname(os.path.abspath(__file__))
+    for path in (os.environ.get("RFID_SCANRING_LIB"), os.path.join(here, "libscanring.so"), "libscanring.so"):
+        if not path:
+            continue
+        try:
+            lib = ctypes.CDLL(path)
+        except OSError:
+            continue
+        lib.scanring_attach.argtypes = [ctypes.c_char_p, ctypes.c_int]
+        lib.scanring_attach.restype = ctypes.c_void_p
+        lib.scanring_push.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int,
+                                      ctypes.c_uint64, ctypes.c_uint64]
+        lib.scanring_push.restype = ctypes.c_int
+        lib.scanring_detach.argtypes = [ctypes.c_void_p]
+        lib.scanring_detach.restype = None
+        _lib = lib
+        return lib
+    return None
+
+
+class ScanRing:
+    def __init__(self, handle):
+        self._handle = handle
+
+    def push(self, uid, reqa_ns=0, selected_ns=0):
+        """Queues one UID (bytes or a list of ints). False when the app is behind."""
+        data = bytes(uid)
+        return _lib.scanring_push(self._handle, data, len(data), reqa_ns, selected_ns) == 1
+
+    def close(self):
+        if self._handle:
+            _lib.scanring_detach(self._handle)
+            self._handle = None
+
+
+def attach(name, wake_fd=-1):
+    lib = _load()
+    if lib is None:
+        return None
+    handle = lib.scanring_attach(name.encode(), wake_fd)
+    return ScanRing(handle) if handle else None
+
+
+def attach_from_environment():
+    name = os.environ.get("RFID_SCAN_RING")
+    return attach(name) if name else None
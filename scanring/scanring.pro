@@ -0,0 +1,16 @@
+# libscanring.so: the producer side of the shared-memory scan rings, for scanner processes.
+# C++ producers can link it or compile ../scanring.cpp directly; scanring.py loads it with ctypes.
+TEMPLATE = lib
+CONFIG += c++17 plugin
+CONFIG -= qt
+TARGET = scanring
+DESTDIR = ..
+LIBS += -lrt
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    ../scanring.cpp
+
+HEADERS += \
+    ../scanring.h
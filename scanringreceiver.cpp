@@ -0,0 +1,97 @@
+#include "scanringreceiver.h"
+#include "scantracer.h"
+#include <QFile>
+#include <QDebug>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+ScanRingReceiver::ScanRingReceiver(QObject *parent)
+    : QObject(parent)
+    , eventFd(eventfd(0, EFD_NONBLOCK)) // No EFD_CLOEXEC: the scanner process inherits it
+    , notifier(nullptr)
+    , pollTimer(new QTimer(this))
+    , records(0)
+{
+    if (eventFd == -1) {
+        qDebug() << "eventfd unavailable, scan rings are polled";
+    } else {
+        notifier = new QSocketNotifier(eventFd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &ScanRingReceiver::drain);
+    }
+    connect(pollTimer, &QTimer::timeout, this, &ScanRingReceiver::drain);
+}
+
+ScanRingReceiver::~ScanRingReceiver() {
+    if (eventFd != -1) {
+        close(eventFd);
+    }
+}
+
+bool ScanRingReceiver::addRing(const QString &name, quint32 capacity) {
+    std::unique_ptr<ScanRingConsumer> ring(new ScanRingConsumer);
+    if (!ring->create(QFile::encodeName(name).constData(), capacity)) {
+        qDebug() << "Cannot create scan ring" << name << "with" << capacity << "records";
+        return false;
+    }
+    ring->prepareToSleep(); // Empty: the first push wakes us
+    rings.push_back(std::move(ring));
+    names.append(name);
+    updatePolling();
+    qDebug() << "Scan ring" << name << "ready for" << capacity << "records";
+    return true;
+}
+
+quint64 ScanRingReceiver::dropped() const {
+    quint64 total = 0;
+    for (const std::unique_ptr<ScanRingConsumer> &ring : rings) {
+        total += ring->dropped();
+    }
+    return total;
+}
+
+void ScanRingReceiver::producerExited(const QString &name) {
+    int index = names.indexOf(name);
+    if (index >= 0) {
+        rings[index]->forgetProducer();
+        updatePolling();
+    }
+}
+
+// Polls every 20 ms while a ring's producer cannot wake us (none attached yet, or it has no
+// eventfd); stops once every producer writes the eventfd, so a woken consumer never spins
+void ScanRingReceiver::updatePolling() {
+    bool needed = eventFd == -1;
+    for (const std::unique_ptr<ScanRingConsumer> &ring : rings) {
+        needed = needed || !ring->producerWakes();
+    }
+    if (needed && !pollTimer->isActive()) {
+        pollTimer->start(20);
+    } else if (!needed && pollTimer->isActive()) {
+        pollTimer->stop();
+    }
+}
+
+void ScanRingReceiver::drain() {
+    if (eventFd != -1) {
+        eventfd_t wakeups;
+        eventfd_read(eventFd, &wakeups); // Resets the counter; EAGAIN when the poll got here first
+    }
+
+    // Keep draining until every ring is empty with its sleeping flag set, so no push is missed
+    bool idle = false;
+    while (!idle) {
+        idle = true;
+        for (const std::unique_ptr<ScanRingConsumer> &ring : rings) {
+            ScanRingRecord record;
+            while (ring->pop(&record)) {
+                ++records;
+                emit scanReceived(QByteArray(reinterpret_cast<const char *>(record.uid), record.uidLength),
+                                  qint64(record.reqaNs), qint64(record.selectedNs), ScanTracer::nowNs());
+            }
+            if (!ring->prepareToSleep()) {
+                idle = false;
+            }
+        }
+    }
+    updatePolling(); // Attach and detach wake us too
+}
@@ -0,0 +1,48 @@
+#ifndef SCANRINGRECEIVER_H
+#define SCANRINGRECEIVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+#include "scanring.h"
+
+// Owns the shared-memory scan rings and their eventfd, and turns records into scanReceived()
+// on the thread it lives in. One ring per external scanner process.
+class ScanRingReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScanRingReceiver(QObject *parent = nullptr);
+    ~ScanRingReceiver();
+
+    bool addRing(const QString &name, quint32 capacity = 4096); // name like /rfid-scans
+    QStringList ringNames() const { return names; }
+    int wakeFd() const { return eventFd; } // Inherited by child scanners as RFID_SCAN_EVENTFD
+    quint64 dropped() const;               // Records producers could not push
+    quint64 received() const { return records; }
+    void producerExited(const QString &name); // A producer that had the eventfd died without detaching
+
+signals:
+    void scanReceived(const QByteArray &uid, qint64 reqaNs, qint64 selectedNs, qint64 receivedNs);
+
+private slots:
+    void drain();
+
+private:
+    void updatePolling();
+
+    std::vector<std::unique_ptr<ScanRingConsumer>> rings;
+    QStringList names;
+    int eventFd;
+    QSocketNotifier *notifier;
+    QTimer *pollTimer; // Runs only while some ring has no producer that wakes us
+    quint64 records;
+};
+
+#endif // SCANRINGRECEIVER_H
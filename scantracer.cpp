@@ -0,0 +1,138 @@
+#include "scantracer.h"
+#include <QFile>
+#include <QTextStream>
+#include <time.h>
+
+ScanTracer::ScanTracer() {
+    for (Trace &trace : traces) {
+        for (std::atomic<qint64> &stamp : trace.stamps) {
+            stamp.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+qint64 ScanTracer::nowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+const char *ScanTracer::stageName(Stage stage) {
+    static const char *names[StageCount] = {"reqa", "selected", "received", "deduplicated", "decided",
+                                            "committed", "published"};
+    return names[stage];
+}
+
+ScanTracer::Stage ScanTracer::previous(Stage stage) {
+    switch (stage) {
+    case Committed:
+    case Published:
+        return Decided;
+    case Reqa:
+        return Reqa;
+    default:
+        return static_cast<Stage>(stage - 1);
+    }
+}
+
+void ScanTracer::begin(quint32 sequence, qint64 reqaNs, qint64 selectedNs, qint64 receivedNs) {
+    Trace &trace = traces[sequence % TRACE_SLOTS];
+    for (std::atomic<qint64> &stamp : trace.stamps) {
+        stamp.store(0, std::memory_order_relaxed);
+    }
+    trace.sequence.store(sequence, std::memory_order_release);
+    if (reqaNs > 0) {
+        mark(sequence, Reqa, reqaNs);
+    }
+    if (selectedNs > 0) {
+        mark(sequence, Selected, selectedNs);
+    }
+    mark(sequence, Received, receivedNs);
+}
+
+void ScanTracer::mark(quint32 sequence, Stage stage, qint64 ns) {
+    Trace &trace = traces[sequence % TRACE_SLOTS];
+    if (trace.sequence.load(std::memory_order_acquire) != sequence) {
+        return; // The slot has been reused by a newer scan
+    }
+    trace.stamps[stage].store(ns, std::memory_order_relaxed);
+
+    if (stage != Reqa) {
+        qint64 before = trace.stamps[previous(stage)].load(std::memory_order_relaxed);
+        if (before > 0) {
+            stages[stage].record(ns - before);
+        }
+    }
+    if (stage == Decided) {
+        // Tap to decision: from REQA when the scanner reported it, otherwise from the pipe
+        qint64 start = trace.stamps[Reqa].load(std::memory_order_relaxed);
+        if (start == 0) {
+            start = trace.stamps[Received].load(std::memory_order_relaxed);
+        }
+        endToEnd.record(ns - start);
+    }
+}
+
+QJsonObject ScanTracer::summary() const {
+    auto describe = [](const LatencyHistogram &histogram) {
+        QJsonObject stats{{"count", static_cast<qint64>(histogram.count())},
+                          {"max_us", histogram.max() / 1000.0}};
+        for (double quantile : LatencyHistogram::QUANTILES) {
+            stats.insert(QString("p%1_us").arg(quantile * 100), histogram.percentile(quantile) / 1000.0);
+        }
+        return stats;
+    };
+
+    QJsonObject result;
+    for (int stage = Selected; stage < StageCount; ++stage) {
+        result.insert(stageName(static_cast<Stage>(stage)), describe(stages[stage]));
+    }
+    result.insert("tap_to_decision", describe(endToEnd));
+    return result;
+}
+
+bool ScanTracer::dump(const QString &path) const {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+
+    out << "stage,count,p50_us,p90_us,p99_us,p999_us,max_us\n";
+    auto row = [&out](const char *name, const LatencyHistogram &histogram) {
+        out << name << ',' << histogram.count();
+        for (double quantile : LatencyHistogram::QUANTILES) {
+            out << ',' << histogram.percentile(quantile) / 1000.0;
+        }
+        out << ',' << histogram.max() / 1000.0 << '\n';
+    };
+    for (int stage = Selected; stage < StageCount; ++stage) {
+        row(stageName(static_cast<Stage>(stage)), stages[stage]);
+    }
+    row("tap_to_decision", endToEnd);
+
+    // Raw monotonic timestamps of the recent scans, 0 where a stage was not reached
+    out << "\nsequence";
+    for (int stage = 0; stage < StageCount; ++stage) {
+        out << ',' << stageName(static_cast<Stage>(stage)) << "_ns";
+    }
+    out << '\n';
+    for (const Trace &trace : traces) {
+        if (trace.stamps[Received].load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        out << trace.sequence.load(std::memory_order_relaxed);
+        for (const std::atomic<qint64> &stamp : trace.stamps) {
+            out << ',' << stamp.load(std::memory_order_relaxed);
+        }
+        out << '\n';
+    }
+    return true;
+}
+
+void ScanTracer::reset() {
+    for (LatencyHistogram &histogram : stages) {
+        histogram.reset();
+    }
+    endToEnd.reset();
+}
@@ -0,0 +1,57 @@
+#ifndef SCANTRACER_H
+#define SCANTRACER_H
+
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+
+#include "latencyhistogram.h"
+
+// Follows each scan through the pipeline with CLOCK_MONOTONIC timestamps, which the Python
+// scanner shares through time.monotonic_ns(). Every stage records the time since the stage
+// before it into its own histogram; DB commit and MQTT acknowledgement both follow the
+// decision because they run in parallel. Marks may come from any thread.
+class ScanTracer {
+public:
+    enum Stage {
+        Reqa,           // Tag answered REQA (scanner process)
+        Selected,       // Anticollision/select finished, UID known (scanner process)
+        Received,       // Line read from the scanner pipe
+        Deduplicated,   // Not a repeat of the card still on the reader
+        Decided,        // Access decision taken
+        Committed,      // Stored in scan_events
+        Published,      // Acknowledged by the broker
+        StageCount
+    };
+
+    ScanTracer();
+
+    static qint64 nowNs();
+    static const char *stageName(Stage stage);
+
+    // reqaNs and selectedNs are 0 when the scanner did not report them
+    void begin(quint32 sequence, qint64 reqaNs, qint64 selectedNs, qint64 receivedNs);
+    void mark(quint32 sequence, Stage stage, qint64 ns = nowNs());
+
+    const LatencyHistogram &histogram(Stage stage) const { return stages[stage]; }
+    const LatencyHistogram &tapToDecision() const { return endToEnd; }
+    QJsonObject summary() const;           // Count and p50/p90/p99/p999/max in microseconds
+    bool dump(const QString &path) const;  // CSV of the summary and the recent traces
+    void reset();
+
+private:
+    static constexpr int TRACE_SLOTS = 256;
+
+    struct Trace {
+        std::atomic<quint32> sequence{0};
+        std::atomic<qint64> stamps[StageCount];
+    };
+
+    static Stage previous(Stage stage);
+
+    Trace traces[TRACE_SLOTS]; // The most recent scans, slot = sequence % TRACE_SLOTS
+    LatencyHistogram stages[StageCount];
+    LatencyHistogram endToEnd;
+};
+
+#endif // SCANTRACER_H
@@ -0,0 +1,157 @@
+#include "segmentlog.h"
+#include <QDir>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+
+// Record layout (little-endian): payload length u32, topic length u16, qos u8, reserved u8,
+// enqueue time i64, then the topic and payload bytes
+static const int RECORD_HEADER_BYTES = 16;
+
+SegmentLog::SegmentLog(const QString &dir, qint64 maxBytes)
+    : directory(dir)
+    , maxSegmentBytes(maxBytes)
+    , pendingRecords(0)
+    , pendingBytes(0)
+{
+    QDir().mkpath(directory);
+
+    // Pick up whatever a previous run left behind, oldest segment first
+    const QStringList files = QDir(directory).entryList(QStringList() << "seg-*.log", QDir::Files);
+    for (const QString &name : files) {
+        bool ok = false;
+        quint64 id = name.mid(4, name.size() - 8).toULongLong(&ok);
+        if (ok) {
+            segments.append(id);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+
+    for (quint64 id : segments) {
+        QFile file(segmentPath(id));
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        SpilledMessage message;
+        qint64 recordBytes = 0;
+        while (readRecord(file, &message, &recordBytes)) {
+            ++pendingRecords;
+            pendingBytes += recordBytes;
+        }
+    }
+
+    if (pendingRecords > 0) {
+        qDebug() << "Recovered" << pendingRecords << "spilled messages from" << directory;
+    }
+}
+
+QString SegmentLog::segmentPath(quint64 id) const {
+    return QDir(directory).filePath(QString("seg-%1.log").arg(id, 8, 10, QChar('0')));
+}
+
+bool SegmentLog::openWriteSegment() {
+    writeFile.close();
+    quint64 id = segments.isEmpty() ? 1 : segments.last() + 1;
+    writeFile.setFileName(segmentPath(id));
+    if (!writeFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Unable to open spill segment" << writeFile.fileName() << writeFile.errorString();
+        return false;
+    }
+    segments.append(id);
+    return true;
+}
+
+bool SegmentLog::append(const SpilledMessage &message) {
+    if (!writeFile.isOpen() || writeFile.size() >= maxSegmentBytes) {
+        if (!openWriteSegment()) {
+            return false;
+        }
+    }
+
+    QByteArray topic = message.topic.toUtf8();
+    uchar header[RECORD_HEADER_BYTES];
+    qToLittleEndian<quint32>(message.payload.size(), header);
+    qToLittleEndian<quint16>(topic.size(), header + 4);
+    header[6] = message.qos;
+    header[7] = 0;
+    qToLittleEndian<qint64>(message.enqueuedMs, header + 8);
+
+    QByteArray record;
+    record.reserve(RECORD_HEADER_BYTES + topic.size() + message.payload.size());
+    record.append(reinterpret_cast<const char *>(header), RECORD_HEADER_BYTES);
+    record.append(topic);
+    record.append(message.payload);
+
+    // One write call per record keeps a crash from interleaving partial records
+    if (writeFile.write(record) != record.size() || !writeFile.flush()) {
+        qDebug() << "Spill write failed:" << writeFile.errorString();
+        return false;
+    }
+
+    ++pendingRecords;
+    pendingBytes += record.size();
+    return true;
+}
+
+bool SegmentLog::readRecord(QFile &file, SpilledMessage *message, qint64 *recordBytes) {
+    qint64 start = file.pos();
+    uchar header[RECORD_HEADER_BYTES];
+    if (file.read(reinterpret_cast<char *>(header), RECORD_HEADER_BYTES) != RECORD_HEADER_BYTES) {
+        file.seek(start);
+        return false;
+    }
+
+    quint32 payloadLength = qFromLittleEndian<quint32>(header);
+    quint16 topicLength = qFromLittleEndian<quint16>(header + 4);
+    QByteArray topic = file.read(topicLength);
+    QByteArray payload = file.read(payloadLength);
+    if (topic.size() != topicLength || payload.size() != static_cast<int>(payloadLength)) {
+        file.seek(start); // Torn tail, leave the position so a later read can retry
+        return false;
+    }
+
+    message->topic = QString::fromUtf8(topic);
+    message->payload = payload;
+    message->qos = header[6];
+    message->enqueuedMs = qFromLittleEndian<qint64>(header + 8);
+    *recordBytes = RECORD_HEADER_BYTES + topicLength + payloadLength;
+    return true;
+}
+
+void SegmentLog::dropReadSegment() {
+    readFile.close();
+    QFile::remove(segmentPath(segments.takeFirst()));
+}
+
+bool SegmentLog::readNext(SpilledMessage *message) {
+    while (pendingRecords > 0 && !segments.isEmpty()) {
+        if (!readFile.isOpen()) {
+            readFile.setFileName(segmentPath(segments.first()));
+            // Unbuffered so records appended after we hit the end are seen on the next read
+            if (!readFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+                segments.removeFirst();
+                continue;
+            }
+        }
+
+        qint64 recordBytes = 0;
+        if (readRecord(readFile, message, &recordBytes)) {
+            --pendingRecords;
+            pendingBytes -= recordBytes;
+            if (pendingRecords == 0) {
+                // Drained: remove every segment so the next spill starts from a clean directory
+                writeFile.close();
+                while (!segments.isEmpty()) {
+                    dropReadSegment();
+                }
+            }
+            return true;
+        }
+
+        if (segments.size() == 1 && writeFile.isOpen()) {
+            return false; // Caught up with the writer
+        }
+        dropReadSegment();
+    }
+    return false;
+}
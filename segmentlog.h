@@ -0,0 +1,46 @@
+#ifndef SEGMENTLOG_H
+#define SEGMENTLOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+// One message parked on disk while the broker is unreachable or the memory queue is full
+struct SpilledMessage {
+    QString topic;
+    QByteArray payload;
+    quint8 qos;
+    qint64 enqueuedMs; // Wall clock, so latency stays meaningful across restarts
+    quint32 tag = 0;   // Caller's tracking id, kept in memory only
+};
+
+// Append-only FIFO of messages split over fixed-size segment files (seg-<n>.log).
+// Fully read segments are deleted; a torn record at the tail after a crash is ignored.
+class SegmentLog {
+public:
+    explicit SegmentLog(const QString &directory, qint64 maxSegmentBytes = 1024 * 1024);
+
+    bool append(const SpilledMessage &message);
+    bool readNext(SpilledMessage *message); // false when the log is empty
+
+    bool isEmpty() const { return pendingRecords == 0; }
+    quint64 pending() const { return pendingRecords; }
+    quint64 pendingSize() const { return pendingBytes; }
+
+private:
+    QString segmentPath(quint64 id) const;
+    bool openWriteSegment();
+    void dropReadSegment();
+    static bool readRecord(QFile &file, SpilledMessage *message, qint64 *recordBytes);
+
+    QString directory;
+    qint64 maxSegmentBytes;
+    QList<quint64> segments; // Ids on disk, oldest first
+    QFile writeFile;
+    QFile readFile;
+    quint64 pendingRecords;
+    quint64 pendingBytes;
+};
+
+#endif // SEGMENTLOG_H
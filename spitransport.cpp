@@ -0,0 +1,102 @@
+#include "spitransport.h"
+#include <wiringPi.h>
+#include <wiringPiSPI.h>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include "logger.h"
+
+void SpiTransport::sleepMs(unsigned ms) {
+    timespec delay = {time_t(ms / 1000), long(ms % 1000) * 1000000L};
+    nanosleep(&delay, nullptr);
+}
+
+WiringPiSpiTransport::WiringPiSpiTransport(int channel, int speedHz, int resetPin)
+    : channel(channel)
+    , speedHz(speedHz)
+    , resetPin(resetPin)
+{
+}
+
+bool WiringPiSpiTransport::open() {
+    if (wiringPiSetupGpio() == -1) {
+        LOG_ERROR("Failed to initialize GPIO");
+        return false;
+    }
+    if (wiringPiSPISetup(channel, speedHz) == -1) {
+        LOG_ERROR("Failed to initialize SPI channel %d", channel);
+        return false;
+    }
+    pinMode(resetPin, OUTPUT);
+    digitalWrite(resetPin, HIGH); // Ensure the RC522 is powered on
+    return true;
+}
+
+bool WiringPiSpiTransport::transfer(uint8_t *data, int length) {
+    return wiringPiSPIDataRW(channel, data, length) != -1;
+}
+
+void WiringPiSpiTransport::hardReset() {
+    digitalWrite(resetPin, LOW);
+    delayMicroseconds(10); // Datasheet minimum is 100 ns
+    digitalWrite(resetPin, HIGH);
+    delayMicroseconds(PCD_OSC_STARTUP_US); // No register access until the crystal runs
+}
+
+bool WiringPiSpiTransport::reopen() {
+    // wiringPi has no teardown call; close its descriptor so setup opens the device afresh
+    int fd = wiringPiSPIGetFd(channel);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (wiringPiSPISetup(channel, speedHz) == -1) {
+        LOG_ERROR("Failed to reopen SPI channel %d", channel);
+        return false;
+    }
+    return true;
+}
+
+RecordingSpiTransport::RecordingSpiTransport(SpiTransport *inner, TraceWriter *trace)
+    : inner(inner)
+    , trace(trace)
+{
+}
+
+bool RecordingSpiTransport::transfer(uint8_t *data, int length) {
+    uint8_t sent[255];
+    int recorded = length < int(sizeof(sent)) ? length : int(sizeof(sent));
+    memcpy(sent, data, recorded);
+    bool ok = inner->transfer(data, length);
+    if (ok) {
+        trace->recordSpi(sent, data, recorded);
+    }
+    return ok;
+}
+
+ReplaySpiTransport::ReplaySpiTransport(TraceReader *trace, double speed)
+    : trace(trace)
+    , pacer(speed)
+    , replayed(0)
+    , diverged(0)
+    , exhausted(false)
+{
+}
+
+bool ReplaySpiTransport::transfer(uint8_t *data, int length) {
+    if (exhausted || !trace->next(TraceKind::Spi, &record)) {
+        exhausted = true;
+        memset(data, 0, length);
+        return false;
+    }
+    pacer.wait(record.timestampNs);
+
+    int replies = record.length < length ? record.length : length;
+    if (record.length != length || memcmp(record.data, data, replies) != 0) {
+        ++diverged;
+        LOG_WARN("Replay diverged at transfer %llu: sent 0x%02x, recorded 0x%02x", replayed, data[0], record.data[0]);
+    }
+    memset(data, 0, length);
+    memcpy(data, record.data + record.length, replies);
+    ++replayed;
+    return true;
+}
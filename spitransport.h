@@ -0,0 +1,81 @@
+#ifndef SPITRANSPORT_H
+#define SPITRANSPORT_H
+
+#include <cstdint>
+#include "rc522timing.h"
+#include "readertrace.h"
+
+// The RC522 bus as RFIDReader sees it: full-duplex transfers plus the driver's fixed waits.
+// Swapping the transport lets the same driver run on hardware, record, or replay a trace.
+class SpiTransport {
+public:
+    virtual ~SpiTransport() {}
+
+    virtual bool open() = 0;                           // Bring up the bus (and reset pin)
+    virtual bool transfer(uint8_t *data, int length) = 0; // data is sent and overwritten with the reply
+    virtual void sleepMs(unsigned ms);                 // Waits the driver does between transfers
+    virtual void hardReset() {}                        // Pulse the RST pin
+    virtual bool reopen() { return true; }             // Tear the bus down and set it up again
+};
+
+// wiringPi SPI channel and the RST pin on real hardware
+class WiringPiSpiTransport : public SpiTransport {
+public:
+    WiringPiSpiTransport(int channel, int speedHz, int resetPin);
+
+    bool open() override;
+    bool transfer(uint8_t *data, int length) override;
+    void hardReset() override;
+    bool reopen() override;
+
+private:
+    int channel;
+    int speedHz;
+    int resetPin;
+};
+
+// Forwards to another transport and writes every transfer to a trace. Only RFIDReader drives
+// a transport; the Qt app reads cards through the scanner process and captures Scan records only.
+class RecordingSpiTransport : public SpiTransport {
+public:
+    RecordingSpiTransport(SpiTransport *inner, TraceWriter *trace);
+
+    bool open() override { return inner->open(); }
+    bool transfer(uint8_t *data, int length) override;
+    void sleepMs(unsigned ms) override { inner->sleepMs(ms); }
+    void hardReset() override { inner->hardReset(); }
+    bool reopen() override { return inner->reopen(); }
+
+private:
+    SpiTransport *inner;
+    TraceWriter *trace;
+};
+
+/**
+ * Answers transfers from a recorded trace, paced like the capture (speed 1), N times faster,
+ * or as fast as the driver asks (speed 0). The driver's own waits are skipped because the
+ * pacing already reproduces them. Transfers whose sent bytes differ from the recording are
+ * counted: the driver took a different path than on the hardware and the run is not comparable.
+ */
+class ReplaySpiTransport : public SpiTransport {
+public:
+    ReplaySpiTransport(TraceReader *trace, double speed);
+
+    bool open() override { return true; }
+    bool transfer(uint8_t *data, int length) override; // false once the trace is exhausted
+    void sleepMs(unsigned) override {}
+
+    uint64_t transfers() const { return replayed; }
+    uint64_t mismatches() const { return diverged; }
+    bool finished() const { return exhausted; }
+
+private:
+    TraceReader *trace;
+    TracePacer pacer;
+    TraceRecord record;
+    uint64_t replayed;
+    uint64_t diverged;
+    bool exhausted;
+};
+
+#endif // SPITRANSPORT_H
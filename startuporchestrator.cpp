@@ -0,0 +1,138 @@
+#include "startuporchestrator.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+
+StartupOrchestrator::StartupOrchestrator(const QElapsedTimer &sinceLaunch, QObject *parent)
+    : QObject(parent)
+    , clock(sinceLaunch)
+    , remaining(0)
+    , allOk(true)
+{
+}
+
+StartupOrchestrator::~StartupOrchestrator() {
+    workers.waitForDone();
+}
+
+void StartupOrchestrator::addPhase(const QString &name, const QStringList &after, Where where,
+                                   std::function<bool()> run) {
+    Phase phase;
+    phase.name = name;
+    phase.after = after;
+    phase.where = where;
+    phase.run = std::move(run);
+    phases.push_back(std::move(phase));
+    ++remaining;
+}
+
+void StartupOrchestrator::start() {
+    for (const Phase &phase : phases) {
+        for (const QString &dependency : phase.after) {
+            if (indexOf(dependency) < 0) {
+                qDebug() << "Startup phase" << phase.name << "depends on unknown phase" << dependency;
+            }
+        }
+    }
+    schedule();
+}
+
+int StartupOrchestrator::indexOf(const QString &name) const {
+    for (size_t i = 0; i < phases.size(); ++i) {
+        if (phases[i].name == name) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+void StartupOrchestrator::schedule() {
+    // Repeat until nothing changes: skipping one phase can make its dependents skippable too
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < phases.size(); ++i) {
+            Phase &phase = phases[i];
+            if (phase.state != Pending) {
+                continue;
+            }
+            bool ready = true;
+            bool blocked = false;
+            for (const QString &dependency : phase.after) {
+                int index = indexOf(dependency);
+                State state = index < 0 ? Failed : phases[index].state;
+                ready = ready && state == Done;
+                blocked = blocked || state == Failed || state == Skipped;
+            }
+            if (blocked) {
+                phase.state = Skipped;
+                qDebug() << "Startup phase" << phase.name << "skipped, a dependency failed";
+                complete(int(i), false);
+                changed = true;
+            } else if (ready) {
+                launch(int(i));
+            }
+        }
+    }
+}
+
+void StartupOrchestrator::launch(int index) {
+    Phase &phase = phases[index];
+    phase.state = Running;
+    phase.startMs = clock.elapsed();
+
+    if (phase.where == WorkerThread) {
+        std::function<bool()> run = phase.run;
+        workers.start([this, index, run]() {
+            bool ok = run();
+            QMetaObject::invokeMethod(this, [this, index, ok]() { complete(index, ok); }, Qt::QueuedConnection);
+        });
+    } else {
+        // Queued, so a slow main-thread phase never delays launching the workers beside it
+        QMetaObject::invokeMethod(this, [this, index]() { complete(index, phases[index].run()); },
+                                  Qt::QueuedConnection);
+    }
+}
+
+void StartupOrchestrator::complete(int index, bool ok) {
+    Phase &phase = phases[index];
+    if (phase.state == Running) {
+        phase.state = ok ? Done : Failed;
+        phase.endMs = clock.elapsed();
+        qDebug().noquote() << QString("Startup phase %1 %2 in %3 ms (%4 ms after launch)")
+                                  .arg(phase.name, ok ? "done" : "failed")
+                                  .arg(phase.endMs - phase.startMs).arg(phase.endMs);
+    }
+    allOk = allOk && ok;
+    emit phaseFinished(phase.name, ok, phase.endMs >= 0 ? phase.endMs - phase.startMs : 0);
+
+    if (--remaining == 0) {
+        qDebug().noquote() << "Startup:" << QJsonDocument(report()).toJson(QJsonDocument::Compact);
+        emit finished(allOk);
+        return;
+    }
+    if (phase.state != Skipped) {
+        schedule();
+    }
+}
+
+void StartupOrchestrator::milestone(const QString &name) {
+    if (milestones.contains(name)) {
+        return;
+    }
+    qint64 at = clock.elapsed();
+    milestones.insert(name, at);
+    qDebug().noquote() << QString("Startup milestone %1 at %2 ms after launch").arg(name).arg(at);
+}
+
+QJsonObject StartupOrchestrator::report() const {
+    static const char *const STATES[] = {"pending", "running", "done", "failed", "skipped"};
+    QJsonArray list;
+    for (const Phase &phase : phases) {
+        list.append(QJsonObject{{"name", phase.name},
+                                {"state", STATES[phase.state]},
+                                {"start", phase.startMs},
+                                {"end", phase.endMs}});
+    }
+    return QJsonObject{{"phases", list}, {"milestones", milestones}};
+}
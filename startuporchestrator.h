@@ -0,0 +1,65 @@
+#ifndef STARTUPORCHESTRATOR_H
+#define STARTUPORCHESTRATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <functional>
+#include <vector>
+
+/**
+ * Brings subsystems up concurrently. Each phase names the phases it needs and where it runs:
+ * on the thread the orchestrator lives in (anything touching QObjects or the default database
+ * connection) or on a worker. A phase starts as soon as its dependencies are done; when one fails,
+ * everything that depends on it is skipped. Milestones record one-off events such as the first
+ * scan, so the report covers time-to-first-scan, not just time-to-window.
+ */
+class StartupOrchestrator : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Where { MainThread, WorkerThread };
+
+    explicit StartupOrchestrator(const QElapsedTimer &sinceLaunch, QObject *parent = nullptr);
+    ~StartupOrchestrator(); // Waits for worker phases still running
+
+    void addPhase(const QString &name, const QStringList &after, Where where, std::function<bool()> run);
+    void start();
+    void milestone(const QString &name); // Only the first call per name counts
+    bool isFinished() const { return remaining == 0; }
+    QJsonObject report() const;          // Per phase start/end in ms since launch, plus milestones
+
+signals:
+    void phaseFinished(const QString &name, bool ok, qint64 elapsedMs);
+    void finished(bool ok);
+
+private:
+    enum State { Pending, Running, Done, Failed, Skipped };
+
+    struct Phase {
+        QString name;
+        QStringList after;
+        Where where;
+        std::function<bool()> run;
+        State state = Pending;
+        qint64 startMs = -1;
+        qint64 endMs = -1;
+    };
+
+    void schedule();
+    void launch(int index);
+    void complete(int index, bool ok);
+    int indexOf(const QString &name) const;
+
+    QElapsedTimer clock;
+    std::vector<Phase> phases;
+    QJsonObject milestones;
+    QThreadPool workers;
+    int remaining;
+    bool allOk;
+};
+
+#endif // STARTUPORCHESTRATOR_H
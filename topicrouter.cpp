@@ -0,0 +1,73 @@
+#include "topicrouter.h"
+#include <QDebug>
+
+TopicRouter::TopicRouter()
+    : root(new Node)
+{
+}
+
+TopicRouter::~TopicRouter() = default;
+
+void TopicRouter::addRoute(const QString &filter, TopicHandler handler) {
+    const QStringList levels = filter.split('/');
+    Node *node = root.get();
+    for (int i = 0; i < levels.size(); ++i) {
+        const QString &level = levels.at(i);
+        if (level == "#") {
+            if (i != levels.size() - 1) {
+                qDebug() << "Ignoring topic filter with '#' before the last level:" << filter;
+                return;
+            }
+            node->multiLevel.push_back(std::move(handler));
+            registeredFilters.append(filter);
+            return;
+        }
+
+        std::unique_ptr<Node> &child = level == "+" ? node->singleLevel : node->children[level];
+        if (!child) {
+            child.reset(new Node);
+        }
+        node = child.get();
+    }
+    node->handlers.push_back(std::move(handler));
+    registeredFilters.append(filter);
+}
+
+int TopicRouter::dispatch(const Node *node, const QStringList &levels, int depth,
+                          const QMqttTopicName &topic, const QByteArray &payload) const {
+    // Wildcards never match topics starting with '$' (broker internals such as $SYS)
+    bool wildcardsAllowed = depth > 0 || !levels.first().startsWith('$');
+    int invoked = 0;
+
+    if (wildcardsAllowed) {
+        for (const TopicHandler &handler : node->multiLevel) {
+            handler(payload, topic);
+            ++invoked;
+        }
+    }
+    if (depth == levels.size()) {
+        for (const TopicHandler &handler : node->handlers) {
+            handler(payload, topic);
+            ++invoked;
+        }
+        return invoked;
+    }
+
+    // One hash lookup for the literal level plus the '+' branch, whatever the number of routes
+    auto literal = node->children.find(levels.at(depth));
+    if (literal != node->children.end()) {
+        invoked += dispatch(literal->second.get(), levels, depth + 1, topic, payload);
+    }
+    if (wildcardsAllowed && node->singleLevel) {
+        invoked += dispatch(node->singleLevel.get(), levels, depth + 1, topic, payload);
+    }
+    return invoked;
+}
+
+int TopicRouter::route(const QMqttTopicName &topic, const QByteArray &payload) const {
+    const QStringList levels = topic.levels();
+    if (levels.isEmpty()) {
+        return 0;
+    }
+    return dispatch(root.get(), levels, 0, topic, payload);
+}
@@ -0,0 +1,42 @@
+#ifndef TOPICROUTER_H
+#define TOPICROUTER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QtMqtt/QMqttTopicName>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using TopicHandler = std::function<void(const QByteArray &payload, const QMqttTopicName &topic)>;
+
+// Trie of topic filters, one node per level, with '+' and '#' children kept apart from the
+// literal ones. Routing a topic walks its levels once instead of testing every filter.
+class TopicRouter {
+public:
+    TopicRouter();
+    ~TopicRouter();
+
+    void addRoute(const QString &filter, TopicHandler handler);
+    QStringList filters() const { return registeredFilters; } // What to subscribe to
+    // Invokes every matching handler and returns how many ran. Handlers must not add routes.
+    int route(const QMqttTopicName &topic, const QByteArray &payload) const;
+
+private:
+    struct Node {
+        std::unordered_map<QString, std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> singleLevel;   // '+'
+        std::vector<TopicHandler> multiLevel; // '#', matches this level and everything below
+        std::vector<TopicHandler> handlers;   // Filters ending exactly here
+    };
+
+    int dispatch(const Node *node, const QStringList &levels, int depth,
+                 const QMqttTopicName &topic, const QByteArray &payload) const;
+
+    std::unique_ptr<Node> root;
+    QStringList registeredFilters;
+};
+
+#endif // TOPICROUTER_H
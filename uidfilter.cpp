@@ -0,0 +1,72 @@
+#include "uidfilter.h"
+#include <cmath>
+
+// Odd multipliers picking one bit per 64-bit word (same scheme as split block Bloom filters)
+static const quint32 SALT[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+UidFilter::UidFilter(quint32 expectedKeys, double falsePositiveRate)
+    : expected(qMax<quint32>(expectedKeys, 1))
+    , inserted(0)
+    , targetRate(clampRate(falsePositiveRate))
+{
+    // Bits for a classic filter with k = 8, plus ~20% to absorb the blocking penalty
+    double bits = -8.0 * expected / std::log(1.0 - std::pow(targetRate, 1.0 / 8.0));
+    size_t blockCount = static_cast<size_t>(std::ceil(bits * 1.2 / 512.0));
+    blocks.assign(qMax<size_t>(blockCount, 1), Block{{0}});
+}
+
+double UidFilter::clampRate(double falsePositiveRate) {
+    return qBound(1e-6, falsePositiveRate, 0.5);
+}
+
+quint64 UidFilter::hash(const UidKey &key) {
+    // murmur3 finalizer over both halves of the key
+    quint64 h = key.hi ^ (static_cast<quint64>(key.lo) * 0x9e3779b97f4a7c15ULL);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void UidFilter::blockMask(quint64 hash, quint64 mask[8]) {
+    quint32 low = static_cast<quint32>(hash);
+    for (int i = 0; i < 8; ++i) {
+        mask[i] = 1ULL << ((low * SALT[i]) >> 26);
+    }
+}
+
+const UidFilter::Block &UidFilter::blockFor(quint64 hash) const {
+    // Multiply-shift maps the high half onto [0, blocks) without a division
+    size_t index = static_cast<size_t>(((hash >> 32) * blocks.size()) >> 32);
+    return blocks[index];
+}
+
+void UidFilter::insert(const UidKey &key) {
+    quint64 h = hash(key);
+    quint64 mask[8];
+    blockMask(h, mask);
+
+    Block &block = const_cast<Block &>(blockFor(h));
+    for (int i = 0; i < 8; ++i) {
+        block.words[i] |= mask[i];
+    }
+    ++inserted;
+}
+
+bool UidFilter::mayContain(const UidKey &key) const {
+    quint64 h = hash(key);
+    quint64 mask[8];
+    blockMask(h, mask);
+
+    const Block &block = blockFor(h);
+    quint64 missing = 0;
+    for (int i = 0; i < 8; ++i) {
+        missing |= mask[i] & ~block.words[i];
+    }
+    return missing == 0;
+}
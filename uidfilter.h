@@ -0,0 +1,40 @@
+#ifndef UIDFILTER_H
+#define UIDFILTER_H
+
+#include <QtGlobal>
+#include <vector>
+
+#include "accesscontrol.h"
+
+// Cache-line blocked Bloom filter over enrolled UIDs. A negative answer is exact, so unknown
+// tags (transit cards, phones) can be rejected without touching the access set or SQLite.
+class UidFilter {
+public:
+    UidFilter(quint32 expectedKeys, double falsePositiveRate);
+
+    static double clampRate(double falsePositiveRate); // The range the filter actually builds for
+
+    void insert(const UidKey &key);
+    bool mayContain(const UidKey &key) const;
+
+    quint32 capacity() const { return expected; }
+    quint32 insertedKeys() const { return inserted; }
+    double falsePositiveRate() const { return targetRate; }
+    size_t sizeBytes() const { return blocks.size() * sizeof(Block); }
+
+private:
+    struct alignas(64) Block {
+        quint64 words[8]; // 512 bits, one cache line
+    };
+
+    static quint64 hash(const UidKey &key);
+    static void blockMask(quint64 hash, quint64 mask[8]);
+    const Block &blockFor(quint64 hash) const;
+
+    std::vector<Block> blocks;
+    quint32 expected;
+    quint32 inserted;
+    double targetRate;
+};
+
+#endif // UIDFILTER_H